@@ -27,8 +27,13 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <ostream>
 #include <set>
+#include <string>
+#include <unordered_map>
 #include <vector>
+#include <bitset>
+#include <functional>
 
 
 #ifndef USE_ELFIO 
@@ -41,6 +46,21 @@ namespace EHP
 using namespace std;
 
 using EHProgramInstructionByteVector_t = vector<uint8_t>;
+
+class OutputSink_t;
+
+// One operation of a DWARF expression (DW_OP_*), decoded and validated.  operand1 holds the
+// constant, register number, size or pick index; for DW_OP_bra and DW_OP_skip it holds the 
+// index of the target op.  operand2 holds the offset of DW_OP_breg*.
+struct EHPExpressionOp_t
+{
+	uint8_t opcode;
+	uint64_t operand1;
+	int64_t operand2;
+};
+
+using EHPExpressionOpVector_t = vector<EHPExpressionOp_t>;
+
 class EHProgramInstruction_t 
 {
 	protected:
@@ -57,6 +77,8 @@ class EHProgramInstruction_t
 	virtual bool isRememberState() const = 0;
 	virtual const EHProgramInstructionByteVector_t& getBytes() const = 0;
         virtual bool advance(uint64_t &cur_addr, uint64_t CAF)     const = 0;
+	// decode the expression operand of a *_expression instruction.  true if this is not one, or it is malformed.
+	virtual bool getExpression(EHPExpressionOpVector_t &ops) const = 0;
 
 };
 
@@ -92,7 +114,9 @@ class CIEContents_t
 	virtual string getAugmentation() const =0;
 	virtual uint8_t getLSDAEncoding() const =0;
 	virtual uint8_t getFDEEncoding() const =0;
+	virtual uint8_t getVersion() const =0;
 	virtual void print(const uint64_t startAddr) const =0;
+	virtual void print(OutputSink_t &out, const uint64_t startAddr) const =0;
 };
 
 class LSDACallSiteAction_t 
@@ -152,6 +176,7 @@ class LSDA_t
 	virtual uint8_t getTTEncoding() const =0;
 	virtual void print() const=0;
 	virtual uint64_t getLandingPadBaseAddress() const = 0;
+	virtual uint8_t getLandingPadBaseEncoding() const = 0;	// DW_EH_PE_omit if the base is the FDE's start address
 	virtual const CallSiteVector_t* getCallSites() const =0;
 	virtual uint64_t getCallSiteTableAddress() const = 0;
 	virtual uint64_t getCallSiteTableAddressLocation() const = 0;
@@ -165,6 +190,91 @@ class LSDA_t
 };
 
 
+// The result of executing a CIE's initial instructions and an FDE's program:
+// a table of rows, each giving the CFA rule and register rules for a PC range.
+using EHPCFARuleType_t = enum EHPCFARuleType 
+{ 
+	CFA_RULE_UNDEFINED,	// no CFA rule was established
+	CFA_RULE_REG_OFFSET,	// CFA = reg + offset
+	CFA_RULE_EXPRESSION	// CFA = value of expression #offset in getExpressions()
+} ;
+
+struct EHPCFARule_t
+{
+	EHPCFARuleType_t type;
+	uint32_t reg;
+	int64_t offset;
+};
+
+using EHPRegisterRuleType_t = enum EHPRegisterRuleType 
+{ 
+	REG_RULE_UNDEFINED,	// the caller's value is not recoverable
+	REG_RULE_SAME_VALUE,	// the caller's value is unchanged
+	REG_RULE_OFFSET,	// saved at CFA + operand
+	REG_RULE_VAL_OFFSET,	// the value is CFA + operand
+	REG_RULE_REGISTER,	// saved in register operand
+	REG_RULE_EXPRESSION,	// saved at the address computed by expression #operand
+	REG_RULE_VAL_EXPRESSION	// the value is computed by expression #operand
+} ;
+
+struct EHPRegisterRule_t
+{
+	uint32_t reg;
+	EHPRegisterRuleType_t type;
+	int64_t operand;	// already scaled by the data alignment factor
+};
+
+struct EHPCFARow_t
+{
+	uint64_t start_addr;	// first pc covered by this row
+	uint64_t end_addr;	// one past the last pc covered by this row
+	EHPCFARule_t cfa;
+	uint32_t first_rule;	// this row's rules are getRegisterRules()[first_rule, first_rule+rule_count)
+	uint32_t rule_count;	// registers without an explicit rule are not listed
+};
+
+using EHPCFARowVector_t = vector<EHPCFARow_t>;
+using EHPRegisterRuleVector_t = vector<EHPRegisterRule_t>;
+using EHPExpressionVector_t = vector<EHProgramInstructionByteVector_t>;
+using EHPCompiledExpressionVector_t = vector<EHPExpressionOpVector_t>;
+
+class CFATable_t
+{
+	protected:
+	CFATable_t() {}
+	CFATable_t(const CFATable_t&) {}
+	public:
+	virtual ~CFATable_t() {}
+	virtual const EHPCFARowVector_t* getRows() const =0;
+	virtual const EHPRegisterRuleVector_t* getRegisterRules() const =0;
+	virtual const EHPExpressionVector_t* getExpressions() const =0;
+	// parallel to getExpressions(), an entry is empty if its expression is malformed or unsupported.
+	virtual const EHPCompiledExpressionVector_t* getCompiledExpressions() const =0;
+	virtual const EHPCFARow_t* findRow(uint64_t pc) const =0;
+	virtual const EHPRegisterRule_t* findRegisterRule(const EHPCFARow_t& row, uint32_t reg) const =0;
+	// false if the program contained something the evaluator could not interpret.
+	virtual bool isComplete() const =0;
+};
+
+struct EHPSavedRegister_t
+{
+	uint32_t reg;
+	int64_t cfa_offset;	// where the caller's value is saved, relative to the CFA
+};
+
+using EHPSavedRegisterVector_t = vector<EHPSavedRegister_t>;
+
+// Facts about a function's frame, derived from its CFA table.
+struct EHPFrameSummary_t
+{
+	int64_t max_frame_size;		// largest CFA offset from the stack pointer
+	bool uses_frame_pointer;	// some row computes the CFA from the frame pointer
+	bool has_remember_restore;	// remember_state/restore_state, usually multiple epilogues
+	bool has_expressions;		// some rule is a DWARF expression
+	bool is_complete;		// false if the CFA table is not complete
+	EHPSavedRegisterVector_t saved_registers;	// saved at an offset from the CFA, sorted by register, excluding the return address
+};
+
 class FDEContents_t 
 {
 	protected:
@@ -186,14 +296,418 @@ class FDEContents_t
 	virtual uint64_t getEndAddressSize() const = 0;
 	virtual uint64_t getLSDAAddressPosition() const = 0;
 	virtual uint64_t getLSDAAddressSize() const = 0;
+	virtual const CFATable_t* getCFATable() const = 0; // evaluated on first use, then cached.
+	virtual const EHPFrameSummary_t& getFrameSummary() const = 0; // computed on first use, then cached.
 	virtual void print() const=0;	// move to ostream?  toString?
+	virtual void print(OutputSink_t &out) const=0;
 
 };
 
 
 using EHPEndianness_t = enum EHPEndianness { HOST, BIG, LITTLE } ;
+
+// In strict mode, parsing stops at the first malformed CIE/FDE.  In lenient mode, 
+// the malformed record is skipped using its length field, an error is recorded, 
+// and parsing continues with the next record.
+using EHPParseMode_t = enum EHPParseMode { PARSE_STRICT, PARSE_LENIENT } ;
+
+using EHPParseErrorKind_t = enum EHPParseErrorKind 
+{ 
+	PARSE_ERROR_CIE,	// a CIE record could not be parsed
+	PARSE_ERROR_FDE,	// an FDE record (or its CIE or LSDA) could not be parsed
+	PARSE_ERROR_LENGTH	// a record's length runs past the section, parsing cannot resync
+} ;
+
+struct EHPParseError_t 
+{
+	uint64_t position; // address of the malformed record
+	uint64_t length;   // value of the record's length field
+	EHPParseErrorKind_t kind;
+};
+
+using EHPParseErrorVector_t = vector<EHPParseError_t>;
+
+// A flat, sorted, fixed-width unwind table for the whole binary (in the style of ORC).
+// Each entry covers [start_addr, next entry's start_addr) and says how to find the
+// CFA, the return address and the frame pointer without evaluating any DWARF.
+using EHPUnwindFlags_t = enum EHPUnwindFlags
+{
+	UNWIND_NO_CFI       = 0x01,	// no FDE covers this range
+	UNWIND_NEEDS_DWARF  = 0x02,	// rules are not expressible here, use the FDE's CFATable_t
+	UNWIND_RA_UNDEFINED = 0x04,	// outermost frame, there is no caller
+	UNWIND_RA_AT_CFA    = 0x08,	// return address saved at CFA+ra_offset, else it is still in its register
+	UNWIND_FP_AT_CFA    = 0x10	// frame pointer saved at CFA+fp_offset, else it is unchanged
+} ;
+
+struct EHPUnwindEntry_t
+{
+	uint64_t start_addr;
+	int32_t  cfa_offset;	// CFA = cfa_reg + cfa_offset
+	int32_t  ra_offset;
+	int32_t  fp_offset;
+	uint16_t cfa_reg;	// DWARF register number
+	uint16_t flags;		// EHPUnwindFlags_t
+};
+
+using EHPUnwindTable_t = vector<EHPUnwindEntry_t>;
+
+// A flat, sorted list of the points where the CFA rule changes, for the whole binary.
+// From addr up to the next entry's addr, CFA = cfa_reg + cfa_offset.  Addresses not 
+// covered by any FDE have type CFA_RULE_UNDEFINED; rows with a CFA_RULE_EXPRESSION 
+// (see the FDE's CFATable_t) have cfa_reg and cfa_offset set to 0.
+struct EHPCFAOffsetEntry_t
+{
+	uint64_t addr;
+	int64_t cfa_offset;
+	uint32_t cfa_reg;
+	EHPCFARuleType_t type;
+};
+
+using EHPCFAOffsetTable_t = vector<EHPCFAOffsetEntry_t>;
+// One call site of some LSDA, in a flat index of every call site in the binary sorted by 
+// start address.  A pc is covered if start_addr <= pc < end_addr.
+struct EHPCallSiteIndexEntry_t
+{
+	uint64_t start_addr;
+	uint64_t end_addr;
+	uint64_t landing_pad_addr;	// 0 if there is no landing pad
+	int64_t first_action;		// type filter of the first action record, 0 if cleanup only
+	const LSDACallSite_t* call_site;
+	const FDEContents_t* fde;
+};
+
+using EHPCallSiteIndex_t = vector<EHPCallSiteIndexEntry_t>;
+using EHPCallSiteLookupVector_t = vector<const EHPCallSiteIndexEntry_t*>;
+
+using EHPExceptionEdgeKind_t = enum EHPExceptionEdgeKind
+{
+	EDGE_CLEANUP        = 0x1,	// the action chain has a cleanup (type filter 0)
+	EDGE_CATCH          = 0x2,	// the action chain has a catch clause (positive type filter)
+	EDGE_EXCEPTION_SPEC = 0x4	// the action chain has an exception specification (negative type filter)
+} ;
+
+// The exception control flow of the whole binary in compressed sparse row form.  Sources are 
+// call sites, in getCallSiteIndex() order, and targets are landing pads.  Index arrays have 
+// one more element than the nodes or edges they describe.
+struct EHPExceptionGraph_t
+{
+	vector<uint64_t> call_site_starts;	// sorted
+	vector<uint64_t> call_site_ends;
+	vector<uint64_t> landing_pads;		// sorted and unique, the code entry points
+
+	// call site i's edges are edge_targets[edge_offsets[i], edge_offsets[i+1])
+	vector<uint32_t> edge_offsets;
+	vector<uint32_t> edge_targets;		// indexes into landing_pads
+	vector<uint8_t>  edge_kinds;		// EHPExceptionEdgeKind_t bits
+
+	// edge e's action chain has type filters type_filters[filter_offsets[e], filter_offsets[e+1])
+	vector<uint32_t> filter_offsets;
+	vector<int64_t>  type_filters;
+
+	// landing pad j is reached from call sites pad_sources[pad_offsets[j], pad_offsets[j+1])
+	vector<uint32_t> pad_offsets;
+	vector<uint32_t> pad_sources;
+};
+
+// A call site whose action chain catches some type.
+struct EHPCatchSite_t
+{
+	uint64_t call_site_addr;
+	uint64_t landing_pad_addr;
+	int64_t type_filter;	// the action's filter, an index into the LSDA's type table
+	const LSDACallSite_t* call_site;
+	const FDEContents_t* fde;
+};
+
+using EHPCatchSiteVector_t = vector<EHPCatchSite_t>;
+// keyed by type info pointer, 0 is catch(...).  each vector is sorted by call site address.
+using EHPCatchIndex_t = unordered_map<uint64_t, EHPCatchSiteVector_t>;
+
+// [start, end)
+struct EHPAddressRange_t
+{
+	uint64_t start;
+	uint64_t end;
+};
+
+using EHPAddressRangeVector_t = vector<EHPAddressRange_t>;
+
+// One bit per byte of a set of executable ranges, set if an FDE covers that byte.
+struct EHPCoverageMap_t
+{
+	EHPAddressRangeVector_t ranges;		// sorted and disjoint
+	vector<uint64_t> range_first_bit;	// bit index of each range's start
+	vector<uint64_t> bits;
+
+	bool isCovered(const uint64_t addr) const
+	{
+		// executables have a handful of ranges, so a scan beats a search.
+		for(auto i=size_t(0); i < ranges.size(); i++)
+		{
+			if(addr < ranges[i].start)
+				return false;
+			if(addr < ranges[i].end)
+			{
+				const auto bit=range_first_bit[i]+(addr-ranges[i].start);
+				return (bits[bit/64] >> (bit%64)) & 1;
+			}
+		}
+		return false;
+	}
+};
+
+using EHPSymbolBinding_t = enum EHPSymbolBinding
+{
+	SYMBOL_GLOBAL,
+	SYMBOL_WEAK,
+	SYMBOL_LOCAL
+};
+
+// A defined function symbol.
+struct EHPSymbol_t
+{
+	string name;
+	uint64_t address;
+	uint64_t size;
+	EHPSymbolBinding_t binding;
+	bool is_dynamic;	// from .dynsym rather than .symtab
+};
+
+using EHPSymbolVector_t = vector<EHPSymbol_t>;
+
+static const uint64_t EHP_NO_SYMBOL=~uint64_t(0);
+
+// FDEs matched with the symbols naming them.  An FDE gets the symbol at its start address 
+// (globals before weaks before locals, sized before unsized), or failing that the symbol 
+// whose extent contains its start address.
+struct EHPSymbolJoin_t
+{
+	EHPSymbolVector_t symbols;		// sorted by address, .dynsym copies of .symtab symbols dropped
+	vector<uint64_t> fde_symbols;		// indexed like getFDEs(): an index into symbols, or EHP_NO_SYMBOL
+	vector<uint64_t> unnamed_fdes;		// indices into getFDEs() with no symbol
+	vector<uint64_t> uncovered_symbols;	// indices into symbols whose address no FDE covers
+};
+
+// An entry of the .eh_frame_hdr binary search table.
+struct EHPSearchTableEntry_t
+{
+	uint64_t initial_location;	// the FDE's start address
+	uint64_t fde_address;		// the FDE's address in .eh_frame
+};
+
+using EHPSearchTable_t = vector<EHPSearchTableEntry_t>;
+
+// What checkSearchTable() found wrong with a search table.
+using EHPSearchTableIssueKind_t = enum EHPSearchTableIssueKind
+{
+	SEARCH_TABLE_MISSING,		// an FDE has no entry
+	SEARCH_TABLE_EXTRA,		// an entry names no FDE, or one already listed
+	SEARCH_TABLE_MISORDERED		// an entry starts below the entry before it
+};
+
+struct EHPSearchTableIssue_t
+{
+	EHPSearchTableIssueKind_t kind;
+	uint64_t index;			// into the table, or into getFDEs() for a missing entry
+	EHPSearchTableEntry_t entry;	// the table's entry, or the entry the FDE should have
+};
+
+using EHPSearchTableIssueVector_t = vector<EHPSearchTableIssue_t>;
+
+// Where exported text goes.  Sinks buffer internally and flush when full and when destroyed.
+class OutputSink_t
+{
+	protected:
+	OutputSink_t() {}
+	OutputSink_t(const OutputSink_t&) {}
+	public:
+	virtual ~OutputSink_t() {}
+	virtual void write(const char* data, size_t size) =0;
+	virtual void flush() =0;
+
+	static unique_ptr<OutputSink_t> factory(ostream &out, size_t buffer_size=1<<20);
+	// writes to the descriptor with write(2), which the caller keeps.  throws runtime_error if a write fails.
+	static unique_ptr<OutputSink_t> factory(int fd, size_t buffer_size=1<<20);
+	// appends to out, which must outlive the sink.
+	static unique_ptr<OutputSink_t> factory(string &out);
+};
+
+using EHPJSONFormat_t = enum EHPJSONFormat 
+{ 
+	JSON_DOCUMENT,	// one object: {"cies":[...],"fdes":[...]}
+	JSON_LINES	// one CIE or FDE object per line (NDJSON)
+};
+
+// Fact relations for Datalog-style consumers, as exported by getFacts() and writeFacts().
+// Positions are addresses in .eh_frame or .gcc_except_table; an FDE or CIE is named by its position.
+//   cie(position, length, augmentation, code_alignment_factor, data_alignment_factor, return_register, 
+//       personality, personality_encoding, personality_position, lsda_encoding, fde_encoding)
+//   fde(position, length, cie, start, end, start_position, end_position, lsda_address, lsda_address_position)
+//   cfa_insn(owner, index, pc, op, operand1, operand2)	owner is a CIE or FDE, op and operands as decode()
+//   lsda(fde, landing_pad_base, call_site_table_address, call_site_table_encoding, type_table_address, type_table_encoding)
+//   call_site(fde, index, start, end, landing_pad, start_position, landing_pad_position)
+//   call_site_action(fde, call_site, index, action)
+//   type_entry(fde, index, type_info, encoding)
+// EHP_FACT_SCHEMA_VERSION changes whenever a relation or column is added, removed or reordered.
+static const uint32_t EHP_FACT_SCHEMA_VERSION=1;
+
+using EHPFactRelationKind_t = enum EHPFactRelationKind 
+{ 
+	FACT_CIE,
+	FACT_FDE,
+	FACT_CFA_INSN,
+	FACT_LSDA,
+	FACT_CALL_SITE,
+	FACT_CALL_SITE_ACTION,
+	FACT_TYPE_ENTRY,
+	FACT_RELATION_COUNT
+};
+
+using EHPFactColumnType_t = enum EHPFactColumnType 
+{ 
+	FACT_UNSIGNED,
+	FACT_SIGNED,	// stored two's complement in values
+	FACT_STRING
+};
+
+// One column of a relation: values for numbers, strings for strings, the other is empty.
+struct EHPFactColumn_t
+{
+	string name;
+	EHPFactColumnType_t type;
+	vector<uint64_t> values;
+	vector<string> strings;
+};
+
+// A relation as columns of equal length, one entry per tuple.
+struct EHPFactRelation_t
+{
+	string name;
+	uint64_t rows;
+	vector<EHPFactColumn_t> columns;
+};
+
+struct EHPFacts_t
+{
+	uint32_t schema_version;
+	vector<EHPFactRelation_t> relations;	// indexed by EHPFactRelationKind_t
+};
+
+// An editable copy of the EH sections, from getModel() and for encode().  Records hold 
+// addresses, not encoded fields; CIEs are shared by index.  Encodings are DW_EH_PE_* values.
+struct EHPModelCIE_t
+{
+	uint8_t version;
+	string augmentation;		// only "z" followed by P, L, R, S, B or G can be encoded
+	uint64_t code_alignment_factor;
+	int64_t data_alignment_factor;
+	uint64_t return_register;
+	uint8_t personality_encoding;	// used if augmentation has a P
+	uint64_t personality;		// the personality routine, or its pointer if the encoding is indirect
+	uint8_t lsda_encoding;		// used if augmentation has an L
+	uint8_t fde_encoding;		// used if augmentation has an R, else FDE addresses are absolute pointers
+	EHProgramInstructionByteVector_t program;	// initial instructions
+};
+
+struct EHPModelCallSite_t
+{
+	uint64_t start;
+	uint64_t end;
+	uint64_t landing_pad;		// 0 if none
+	vector<int64_t> actions;	// the type filters of the action chain, empty for none
+};
+
+struct EHPModelLSDA_t
+{
+	uint8_t landing_pad_base_encoding;	// DW_EH_PE_omit: call sites are relative to the FDE's start
+	uint64_t landing_pad_base;		// used unless the encoding is DW_EH_PE_omit
+	uint8_t call_site_encoding;
+	uint8_t type_table_encoding;		// DW_EH_PE_omit if there is no type table
+	vector<EHPModelCallSite_t> call_sites;
+	vector<uint64_t> type_table;		// type filter i > 0 is type_table[i-1], 0 for catch-all
+	EHProgramInstructionByteVector_t exception_specs;	// the lists negative filters index, from the type table base on
+};
+
+struct EHPModelFDE_t
+{
+	uint64_t cie;			// index into cies
+	uint64_t start;
+	uint64_t end;
+	EHProgramInstructionByteVector_t program;
+	bool has_lsda;
+	EHPModelLSDA_t lsda;
+};
+
+struct EHPSectionModel_t
+{
+	uint8_t ptrsize;
+	bool is_be;
+	vector<EHPModelCIE_t> cies;
+	vector<EHPModelFDE_t> fdes;
+};
+
+// Where encode() should place each section.
+struct EHPSectionAddresses_t
+{
+	uint64_t eh_frame_addr;
+	uint64_t eh_frame_hdr_addr;
+	uint64_t gcc_except_table_addr;
+};
+
+using EHPEncodeErrorKind_t = enum EHPEncodeErrorKind 
+{ 
+	ENCODE_ERROR_CIE,	// a CIE's augmentation, encodings or values cannot be encoded
+	ENCODE_ERROR_FDE,	// an FDE's CIE, encodings or values (or its LSDA's) cannot be encoded
+	ENCODE_ERROR_HDR	// an FDE, or .eh_frame itself, is too far from .eh_frame_hdr for the search table
+} ;
+
+struct EHPEncodeError_t 
+{
+	EHPEncodeErrorKind_t kind;
+	uint64_t index;		// into the model's cies for ENCODE_ERROR_CIE, else its fdes (the FDE count for .eh_frame)
+};
+
+// The encoded sections and where each record landed.
+struct EHPEncodedSections_t
+{
+	string eh_frame;
+	string eh_frame_hdr;
+	string gcc_except_table;
+	vector<uint64_t> cie_addresses;		// indexed like the model's cies
+	vector<uint64_t> fde_addresses;		// indexed like the model's fdes
+	vector<uint64_t> lsda_addresses;	// indexed like the model's fdes, 0 if the FDE has no LSDA
+	EHPEncodeError_t error;			// why encode() failed
+};
+
+// The new address for an address in the old layout, for patchAddresses().
+using EHPAddressMap_t = function<uint64_t(uint64_t)>;
+
+using EHPPatchFieldKind_t = enum EHPPatchFieldKind
+{
+	PATCH_FDE_START,
+	PATCH_FDE_RANGE,
+	PATCH_FDE_LSDA,
+	PATCH_PERSONALITY,
+	PATCH_CALL_SITE_START,
+	PATCH_CALL_SITE_LENGTH,
+	PATCH_LANDING_PAD,
+	PATCH_SHARED_LSDA	// FDEs sharing an LSDA need different call site offsets
+};
+
+// A field patchAddresses() could not rewrite, which is left as it was.
+struct EHPPatchError_t
+{
+	EHPPatchFieldKind_t field;
+	uint64_t position;	// the field's address (the FDE's LSDA pointer for PATCH_SHARED_LSDA)
+	uint64_t value;		// the new address or length that did not fit
+};
+
+using EHPPatchErrorVector_t = vector<EHPPatchError_t>;
+
 using FDEVector_t = vector<const FDEContents_t*>;
 using CIEVector_t = vector<const CIEContents_t*>;
+// Passes that work in parallel chunks use a thread per hardware thread, or EHP_THREADS threads 
+// if that is set in the environment.
 class EHFrameParser_t 
 {
 	protected:
@@ -203,23 +717,242 @@ class EHFrameParser_t
 	public:
 	virtual ~EHFrameParser_t() {}
 	virtual void print() const=0;
+	// same text as print(); FDEs are formatted in parallel chunks and written in order.
+	virtual void print(OutputSink_t &out) const=0;
 	virtual const FDEVector_t* getFDEs() const =0;
 	virtual const CIEVector_t* getCIEs() const =0;
 	virtual const FDEContents_t* findFDE(uint64_t addr) const =0; 
+	// records skipped by a PARSE_LENIENT parse.  empty unless overridden.
+	virtual const EHPParseErrorVector_t* getParseErrors() const;
+	// an estimate of the memory this parser holds: its sections or mapped image, the records 
+	// read from them, and the tables, CFA rows and frame summaries built on demand so far.  It 
+	// grows as more is built.
+	virtual uint64_t getMemoryUsage() const =0;
+	// built on first use from every FDE's CFA table.
+	virtual const EHPUnwindTable_t* getUnwindTable() const =0;
+	// nullptr if addr is not covered by any FDE.
+	virtual const EHPUnwindEntry_t* findUnwindEntry(uint64_t addr) const =0;
+	// built on first use, evaluating the FDEs' programs in parallel.
+	virtual const EHPCFAOffsetTable_t* getCFAOffsetTable() const =0;
+	// compute every FDE's frame summary in one parallel pass.
+	virtual void computeFrameSummaries() const =0;
+	// built on first use from every FDE's LSDA.
+	virtual const EHPCallSiteIndex_t* getCallSiteIndex() const =0;
+	// nullptr if no call site covers pc.
+	virtual const EHPCallSiteIndexEntry_t* findCallSite(uint64_t pc) const =0;
+	// results[i] is findCallSite(pcs[i]).  fastest when pcs is sorted, large batches run in parallel.
+	virtual void findCallSites(const vector<uint64_t>& pcs, EHPCallSiteLookupVector_t& results) const =0;
+	// built on first use from the call site index.
+	virtual const EHPExceptionGraph_t* getExceptionGraph() const =0;
+	// built on first use from the call site index and each LSDA's type table.
+	virtual const EHPCatchIndex_t* getCatchIndex() const =0;
+	// nullptr if nothing catches type_info_pointer (use 0 for catch(...)).
+	virtual const EHPCatchSiteVector_t* findCatchSites(uint64_t type_info_pointer) const =0;
+	// secondary FDE lookups, all built together in one pass on first use of any of them.
+	// nullptr if there is no match.  FDE lists are in address order.
+	virtual const FDEContents_t* findFDEByPosition(uint64_t position) const =0; // position as in FDEContents_t::getPosition()
+	virtual const FDEVector_t* findFDEsByLSDA(uint64_t lsda_addr) const =0;
+	virtual const FDEVector_t* findFDEsByPersonality(uint64_t personality) const =0; // 0 for FDEs whose CIE has none
+	// the executable ranges given to the factory (from the ELF segments when loading a file).
+	virtual const EHPAddressRangeVector_t* getExecutableRanges() const =0;
+	// the parts of ranges not covered by any FDE, sorted.
+	virtual void getCoverageGaps(const EHPAddressRangeVector_t& ranges, EHPAddressRangeVector_t& gaps) const =0;
+	virtual void getCoverageMap(const EHPAddressRangeVector_t& ranges, EHPCoverageMap_t& map) const =0;
+	// the symbols given to the factory (from .symtab and .dynsym when loading a file with load_symbols).
+	virtual const EHPSymbolVector_t* getSymbols() const =0;
+	// built on first use from getSymbols().
+	virtual const EHPSymbolJoin_t* getSymbolJoin() const =0;
+	virtual void joinSymbols(const EHPSymbolVector_t& symbols, EHPSymbolJoin_t& join) const =0;
+	// Save everything needed to answer queries to a file that loadImage can map and use without 
+	// parsing: the sections, and every CIE, CFA program and LSDA already decoded.  key identifies 
+	// the binary, see getBuildID() and computeImageKey().  The file is replaced atomically, and 
+	// concurrent writers of the same file are safe.  Returns true on error.
+	virtual bool writeImage(const string &filename, const string &key) const =0;
+	// Publish the same image in a sealed memfd, so worker processes on this host can share one 
+	// read-only copy: pass them the descriptor and have them call loadImage(fd, key).  Returns 
+	// the descriptor, which the caller owns, or -1 on error.
+	virtual int publishImage(const string &key) const =0;
+	// Write the CIEs and FDEs as JSON, with each program's decoded instructions and each FDE's 
+	// call sites, actions and type table.  Records are written as they are visited.
+	virtual void writeJSON(OutputSink_t &sink, EHPJSONFormat_t format=JSON_DOCUMENT) const =0;
+	// Fill the fact relations, a column at a time, with FDEs split across threads.
+	virtual void getFacts(EHPFacts_t &facts) const =0;
+	// Write the fact relations to directory, which must exist, as tab-separated <relation>.facts 
+	// files with one tuple per line and no header, plus schema_version.facts holding 
+	// EHP_FACT_SCHEMA_VERSION.  Tabs and newlines in strings are written as spaces.  Returns true on error.
+	virtual bool writeFacts(const string &directory) const =0;
+	// copy the CIEs, FDEs and LSDAs into an editable model for encode().
+	virtual void getModel(EHPSectionModel_t &model) const =0;
+	// the .eh_frame_hdr search table for the FDEs, sorted by start address.
+	virtual void getSearchTable(EHPSearchTable_t &table) const =0;
+	// compare table (from readSearchTable(), say) with getSearchTable() in one walk of both.  
+	// Issues with the table's entries come in table order, then missing FDEs in address order.  
+	// An out of order entry for an FDE is only reported as misordered.
+	virtual void checkSearchTable(const EHPSearchTable_t &table, EHPSearchTableIssueVector_t &issues) const =0;
+	// Rewrite, in eh_frame_data and gcc_except_table_data (copies of the sections this parser 
+	// read, at the same addresses), every FDE start and range, LSDA pointer, personality pointer, 
+	// and call site start, length and landing pad, to map's new addresses.  Each field keeps its 
+	// position, encoding and width, with leb128 values padded out to their old size.  An FDE's end 
+	// maps as map(end-1)+1.  Call sites stay relative to their landing pad base, whose own field is 
+	// not changed when the LSDA has one.  FDEs are patched in parallel chunks, so map must be safe 
+	// to call from several threads.  .eh_frame_hdr is left for encodeSearchTable().  Returns true 
+	// if the buffers are not the sections' sizes or any field is in errors.
+	virtual bool patchAddresses(const EHPAddressMap_t &map, string &eh_frame_data, string &gcc_except_table_data, EHPPatchErrorVector_t &errors) const =0;
 
 #if USE_ELFIO 
-	static unique_ptr<const EHFrameParser_t> factory(const string filename);
+	static unique_ptr<const EHFrameParser_t> factory(const string filename, const EHPParseMode_t parse_mode=PARSE_STRICT, const bool load_symbols=false);
+	// the hex NT_GNU_BUILD_ID of filename, or empty if it has none.
+	static string getBuildID(const string filename);
 #endif
 
+	// Map a file written by writeImage.  Only the file is checked up front: FDE contents, CIEs 
+	// and symbols are built from its records on first use.  nullptr if the file is missing, malformed, from 
+	// another library version or host byte order, or was written with a different key.
+	static unique_ptr<const EHFrameParser_t> loadImage(const string &filename, const string &key);
+	// the same for a descriptor from publishImage() (or an open image file), which the caller keeps.
+	static unique_ptr<const EHFrameParser_t> loadImage(const int fd, const string &key);
+
+	// a key for binaries without a build id, hashed from the sections.
+	static string computeImageKey(
+		const string &eh_frame_data, const uint64_t eh_frame_data_start_addr,
+		const string &eh_frame_hdr_data, const uint64_t eh_frame_hdr_data_start_addr,
+		const string &gcc_except_table_data, const uint64_t gcc_except_table_data_start_addr
+		);
+
 	static unique_ptr<const EHFrameParser_t> factory(
 		uint8_t ptrsize,
 		EHPEndianness_t endian_style,
 		const string eh_frame_data, const uint64_t eh_frame_data_start_addr,
 		const string eh_frame_hdr_data, const uint64_t eh_frame_hdr_data_start_addr,
-		const string gcc_except_table_data, const uint64_t gcc_except_table_data_start_addr
+		const string gcc_except_table_data, const uint64_t gcc_except_table_data_start_addr,
+		const EHPParseMode_t parse_mode=PARSE_STRICT,
+		const EHPAddressRangeVector_t &executable_ranges=EHPAddressRangeVector_t(),
+		const EHPSymbolVector_t &symbols=EHPSymbolVector_t()
+		);
+
+	// Decode only the .eh_frame_hdr search table, without parsing .eh_frame.  Entries are in 
+	// table order, which the producer sorted by initial location.  Returns true if the section 
+	// is malformed or has no table.
+	static bool readSearchTable(
+		uint8_t ptrsize,
+		EHPEndianness_t endian_style,
+		const string &eh_frame_hdr_data, const uint64_t eh_frame_hdr_data_start_addr,
+		EHPSearchTable_t &table
+		);
+
+	// Write table (from getSearchTable(), say) as an .eh_frame_hdr at eh_frame_hdr_addr for an 
+	// .eh_frame at eh_frame_addr, with 4-byte entries relative to the header as linkers write 
+	// them.  Returns true if an address does not fit.
+	static bool encodeSearchTable(
+		uint8_t ptrsize,
+		EHPEndianness_t endian_style,
+		const EHPSearchTable_t &table,
+		const uint64_t eh_frame_addr,
+		const uint64_t eh_frame_hdr_addr,
+		string &eh_frame_hdr_data
+		);
+
+	// Encode model as .eh_frame (CIEs, then FDEs, then a zero terminator), .eh_frame_hdr (sorted 
+	// by start address) and .gcc_except_table, for loading at addresses.  Each pointer is written 
+	// with its CIE's or LSDA's encoding.  FDEs whose LSDAs would encode the same share one, and 
+	// action chains within an LSDA share common tails.  Records are sized first, then written into 
+	// buffers of exactly that size.  Returns true, with sections.error set, if something cannot be encoded.
+	static bool encode(const EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, EHPEncodedSections_t &sections);
+	// Shrink model and encode it as encode() does.  Identical CIEs are merged, DW_CFA_nop 
+	// instructions are dropped, landing pad bases equal to the FDE's start are omitted, call site 
+	// tables get their smallest encoding, and other pointers the narrowest fixed-size encoding that 
+	// fits wherever the compacted records land.  Absolute (DW_EH_PE_absptr) pointers are only 
+	// narrowed if narrow_absolute is set, as their relocations are sized for the original fields.  
+	// Returns true, with sections.error set, on failure; model is only changed on success.
+	static bool compact(EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, EHPEncodedSections_t &sections, const bool narrow_absolute=false);
+};
+
+using EHPArchitecture_t = enum EHPArchitecture { ARCH_X86_64, ARCH_I386, ARCH_AARCH64 } ;
+
+// Registers are indexed by DWARF register number for the architecture.  This covers
+// the integer and vector registers of all three supported architectures.
+static const uint32_t EHP_UNWIND_REGISTER_COUNT=96;
+
+struct EHPRegisterSet_t
+{
+	uint64_t pc;
+	bool pc_is_return_address;	// false for the innermost (or an interrupted) frame
+	uint64_t regs[EHP_UNWIND_REGISTER_COUNT];
+	bitset<EHP_UNWIND_REGISTER_COUNT> valid;	// regs[i] is only meaningful if valid[i]
+};
+
+struct EHPFrame_t
+{
+	uint64_t pc;
+	uint64_t cfa;	// 0 for the last frame if it could not be unwound
+};
+
+using EHPFrameVector_t = vector<EHPFrame_t>;
+
+// Read size bytes of the target's memory at addr into buffer.  Return true on error.
+using EHPMemoryReader_t = function<bool(uint64_t addr, uint8_t* buffer, size_t size)>;
+
+class Unwinder_t
+{
+	protected:
+	Unwinder_t() {}
+	Unwinder_t(const Unwinder_t&) {}
+	public:
+	virtual ~Unwinder_t() {}
+	// Replace regs with the caller's registers and set cfa to the unwound frame's CFA.
+	// Returns true if there is no caller or it cannot be computed, regs are then unchanged.
+	virtual bool step(EHPRegisterSet_t& regs, uint64_t& cfa, const EHPMemoryReader_t& read_memory) const =0;
+	// Step from initial until max_frames frames are in frames or a step fails.
+	virtual void unwind(const EHPRegisterSet_t& initial, const EHPMemoryReader_t& read_memory, EHPFrameVector_t& frames, size_t max_frames) const =0;
+
+	// The parser must outlive the unwinder.  All CFA tables are evaluated here, so stepping does not allocate.
+	static unique_ptr<const Unwinder_t> factory(
+		const EHFrameParser_t& parser,
+		EHPArchitecture_t arch,
+		EHPEndianness_t memory_endian=HOST
 		);
 };
 
+struct EHPParserCacheStats_t
+{
+	uint64_t hits;		// includes callers that waited for another caller's parse
+	uint64_t misses;
+	uint64_t evictions;
+	uint64_t entries;
+	uint64_t memory_bytes;	// the cached parsers' getMemoryUsage(), as of the last call to get()
+};
+
+using EHPParserLoader_t = function<unique_ptr<const EHFrameParser_t>(const string& filename)>;
+
+// A process-wide cache of parsers, keyed by the file's device, inode, modification time and 
+// size, so a replaced file is parsed again.  Safe for concurrent callers: each file is parsed 
+// once, and callers asking for a file that is being parsed wait for that parse.  The parsers 
+// handed out may be used from any number of threads.
+class EHFrameParserCache_t
+{
+	protected:
+	EHFrameParserCache_t() {}
+	EHFrameParserCache_t(const EHFrameParserCache_t&) {}
+	public:
+	virtual ~EHFrameParserCache_t() {}
+	// Throws invalid_argument if filename cannot be stat'd, and whatever the loader throws.
+	// A failed parse is not cached.
+	virtual shared_ptr<const EHFrameParser_t> get(const string &filename) =0;
+	virtual EHPParserCacheStats_t getStats() const =0;
+	// Drop every parser; handles already returned stay valid.
+	virtual void clear() =0;
+
+	// Least recently used parsers are dropped once the cached parsers' getMemoryUsage() totals 
+	// more than max_memory_bytes.  Parsers grow as tables are built on them, so each get() 
+	// measures them all again before evicting.  The most recently used parser is kept even if 
+	// it alone is over budget.
+	static unique_ptr<EHFrameParserCache_t> factory(uint64_t max_memory_bytes, const EHPParserLoader_t &loader);
+#if USE_ELFIO 
+	// loads with EHFrameParser_t::factory(filename).
+	static unique_ptr<EHFrameParserCache_t> factory(uint64_t max_memory_bytes);
+#endif
+};
+
 // e.g.
 // const auto &ehparser=EHFrameParse_t::factory("a.out");
 // for(const auto &fde : ehparser->getFDES()) { ... } 
@@ -20,53 +20,10 @@
 
 // @HEADER_END
 
-// Get windows specific headers needed for byte-swapping
-#ifdef _WIN32 
-#  include <windows.h>
-#  undef max
-#  undef min
-#endif // _WIN32 
-
-// Sort Windows/Apple specific byte swapping macros.
-#if defined(_WIN32) || defined(__APPLE__)
-#  if defined(_MSC_VER)
-#    define htobe16(x) _byteswap_ushort(x)
-#    define htole16(x) (x)
-#    define be16toh(x) _byteswap_ushort(x)
-#    define le16toh(x) (x)
-
-#    define htobe32(x) _byteswap_ulong(x)
-#    define htole32(x) (x)
-#    define be32toh(x) _byteswap_ulong(x)
-#    define le32toh(x) (x)
-
-#    define htobe64(x) _byteswap_uint64(x)
-#    define htole64(x) (x)
-#    define be64toh(x) _byteswap_uint64(x)
-#    define le64toh(x) (x)
-#  elif defined(__GNUC__) || defined(__clang__)
-
-#    define htobe16(x) __builtin_bswap16(x)
-#    define htole16(x) (x)
-#    define be16toh(x) __builtin_bswap16(x)
-#    define le16toh(x) (x)
-
-#    define htobe32(x) __builtin_bswap32(x)
-#    define htole32(x) (x)
-#    define be32toh(x) __builtin_bswap32(x)
-#    define le32toh(x) (x)
-
-#    define htobe64(x) __builtin_bswap64(x)
-#    define htole64(x) (x)
-#    define be64toh(x) __builtin_bswap64(x)
-#    define le64toh(x) (x)
-
-#  endif // _MSC_VER
-#endif // _WIN32 || __APPLE__
-
 #include <iostream>
 #include <iomanip>
 #include <fstream>
+#include <sstream>
 #include <limits>
 #include <stdlib.h>
 #include <string.h>
@@ -78,6 +35,9 @@
 #include "throw_assert.h"
 #include "ehp_priv.hpp"
 #include "scoop_replacement.hpp"
+#include "ehp_unwind.hpp"
+#include "ehp_expression.hpp"
+#include "ehp_parallel.hpp"
 
 #ifndef USE_ELFIO
 #define USE_ELFIO 1
@@ -100,45 +60,12 @@ template <int ptrsize>
 template <class T> 
 bool eh_frame_util_t<ptrsize>::read_type(T &value, uint64_t &position, const uint8_t* const data, const uint64_t max, const bool is_be)
 {
-	if(position + sizeof(T) > max) return true;
-
-	
-	// typecast to the right type
-	const auto ptr=reinterpret_cast<const T*>(&data[position]);
+	auto cursor=eh_record_cursor_t(data, position, max, is_be);
+	if(cursor.read_type(value))
+		return true;
 
 	// set output parameters
-	position+=sizeof(T);
-	value=*ptr;
-	switch (sizeof(T))
-	{
-		case 1:
-			break;
-		case 2:
-		{
-			const auto in  = static_cast<uint16_t>(value);
-			const auto out = is_be ? be16toh(in) : le16toh(in);
-			value = static_cast<T>(out);
-			break;
-		}
-		case 4:
-		{
-			const auto in  = static_cast<uint32_t>(value);
-			const auto out = is_be ? be32toh(in) : le32toh(in);
-			value = static_cast<T>(out);
-			break;
-		}
-		case 8:
-		{
-			const auto in  = static_cast<uint64_t>(value);
-			const auto out = is_be ? be64toh(in) : le64toh(in);
-			value = static_cast<T>(out);
-			break;
-		}
-		default:
-			throw invalid_argument("Unknown integer size");
-	}
-
-
+	position=cursor.getPosition();
 	return false;
 	
 }
@@ -152,7 +79,21 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 	const uint64_t section_start_addr, 
         const bool is_be)
 {
-	auto orig_position=position;
+	auto cursor=eh_record_cursor_t(data, position, max, is_be);
+	if(eh_frame_util_t<ptrsize>::read_type_with_encoding(encoding, value, cursor, section_start_addr))
+		return true;
+	position=cursor.getPosition();
+	return false;
+}
+
+template <int ptrsize>
+template <class T, bool checked> 
+bool eh_frame_util_t<ptrsize>::read_type_with_encoding
+	(const uint8_t encoding, T &value, 
+	eh_record_cursor_t &cursor,
+	const uint64_t section_start_addr)
+{
+	auto orig_position=cursor.getPosition();
 	auto encoding_lower8=encoding&0xf;
 	auto encoding_upper8=encoding&0xf0;
 	value=0;
@@ -163,7 +104,7 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 		case DW_EH_PE_uleb128:
 		{
 			auto newval=uint64_t(0);
-			if(eh_frame_util_t<ptrsize>::read_uleb128(newval,position,data,max))
+			if(cursor.read_uleb128(newval))
 				return true;
 			value=newval;
 			break;
@@ -171,7 +112,7 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 		case DW_EH_PE_sleb128:
 		{
 			auto newval=int64_t(0);
-			if(eh_frame_util_t<ptrsize>::read_sleb128(newval,position,data,max))
+			if(cursor.read_sleb128(newval))
 				return true;
 			value=newval;
 			break;
@@ -179,7 +120,7 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 		case DW_EH_PE_udata2 :
 		{
 			auto newval=uint16_t(0);
-			if(eh_frame_util_t<ptrsize>::read_type(newval,position,data,max, is_be))
+			if(cursor.read_fixed<uint16_t, checked>(newval))
 				return true;
 			value=newval;
 			break;
@@ -187,7 +128,7 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 		case DW_EH_PE_udata4 :
 		{
 			auto newval=uint32_t(0);
-			if(eh_frame_util_t<ptrsize>::read_type(newval,position,data,max, is_be))
+			if(cursor.read_fixed<uint32_t, checked>(newval))
 				return true;
 			value=newval;
 			break;
@@ -195,7 +136,7 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 		case DW_EH_PE_udata8 :
 		{
 			auto newval=uint64_t(0);
-			if(eh_frame_util_t<ptrsize>::read_type(newval,position,data,max, is_be))
+			if(cursor.read_fixed<uint64_t, checked>(newval))
 				return true;
 			value=newval;
 			break;
@@ -204,23 +145,23 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 		{
 			if(ptrsize==8)
 			{
-				if(eh_frame_util_t<ptrsize>::read_type_with_encoding(DW_EH_PE_udata8, value, position, data, max, section_start_addr, is_be))
+				if(eh_frame_util_t<ptrsize>::template read_type_with_encoding<T, checked>(DW_EH_PE_udata8, value, cursor, section_start_addr))
 					return true;
 			}
 			else if(ptrsize==4)
 			{
-				if(eh_frame_util_t<ptrsize>::read_type_with_encoding(DW_EH_PE_udata4, value, position, data, max, section_start_addr, is_be))
+				if(eh_frame_util_t<ptrsize>::template read_type_with_encoding<T, checked>(DW_EH_PE_udata4, value, cursor, section_start_addr))
 					return true;
 			}
 			else
-				throw invalid_argument("Cannot detect pointer size");
+				return true; // cannot detect pointer size
 			break;
 				
 		}
 		case DW_EH_PE_sdata2 :
 		{
 			auto newval=int16_t(0);
-			if(eh_frame_util_t<ptrsize>::read_type(newval,position,data,max, is_be))
+			if(cursor.read_fixed<int16_t, checked>(newval))
 				return true;
 			value=newval;
 			break;
@@ -228,7 +169,7 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 		case DW_EH_PE_sdata4 :
 		{
 			auto newval=int32_t(0);
-			if(eh_frame_util_t<ptrsize>::read_type(newval,position,data,max, is_be))
+			if(cursor.read_fixed<int32_t, checked>(newval))
 				return true;
 			value=newval;
 			break;
@@ -236,7 +177,7 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 		case DW_EH_PE_sdata8 :
 		{
 			auto newval=int64_t(0);
-			if(read_type(newval,position,data,max, is_be))
+			if(cursor.read_fixed<int64_t, checked>(newval))
 				return true;
 			value=newval;
 			break;
@@ -244,7 +185,9 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 
 		case DW_EH_PE_signed :
 		default:
-			throw invalid_argument("Cannot detect encoding of requested value");
+			// cannot detect encoding of requested value.  
+			// report it like any other malformed field so callers can skip the record.
+			return true;
 	};
 
 	switch(encoding_upper8)
@@ -260,7 +203,7 @@ bool eh_frame_util_t<ptrsize>::read_type_with_encoding
 		case DW_EH_PE_aligned:
 		case DW_EH_PE_indirect:
 		default:
-			throw invalid_argument("Cannot detect encoding of requested value");
+			// no section base is available for these encodings.
 			return true;
 	}
 	return false;
@@ -273,14 +216,11 @@ bool eh_frame_util_t<ptrsize>::read_string
 	const uint8_t* const data, 
 	const uint64_t max)
 {
-	while(data[position]!='\0' && position < max)
-	{
-		s+=data[position];	
-		position++;
-	}
-
-	position++;
-	return (position>max);
+	auto cursor=eh_record_cursor_t(data, position, max, false);
+	if(cursor.read_string(s))
+		return true;
+	position=cursor.getPosition();
+	return false;
 }
 
 
@@ -292,18 +232,11 @@ bool eh_frame_util_t<ptrsize>::read_uleb128
 	const uint8_t* const data, 
 	const uint64_t max)
 {
-	result = 0;
-	auto shift = 0;
-	while( position < max )
-	{
-		auto byte = data[position];
-		position++;
-		result |= ( ( byte & 0x7f ) << shift);
-		if ( ( byte & 0x80) == 0)
-			break;
-		shift += 7;
-	}
-	return ( position > max );
+	auto cursor=eh_record_cursor_t(data, position, max, false);
+	if(cursor.read_uleb128(result))
+		return true;
+	position=cursor.getPosition();
+	return false;
 
 }
 // see https://en.wikipedia.org/wiki/LEB128
@@ -314,25 +247,11 @@ bool eh_frame_util_t<ptrsize>::read_sleb128 (
 	const uint8_t* const data, 
 	const uint64_t max)
 {
-	result = 0;
-	auto shift = 0;
-	auto size = 64;  // number of bits in signed integer;
-	auto byte=uint8_t(0);
-	do
-	{
-		if ( position > max )
-			return true;
-		byte = data [position]; 
-		result |= ((byte & 0x7f)<< shift);
-		shift += 7;
-		position++;
-	} while( (byte & 0x80) != 0);
-
-	/* sign bit of byte is second high order bit (0x40) */
-	if ((shift < size) && ( (byte & 0x40) !=0 /* sign bit of byte is set */))
-		/* sign extend */
-		result |= - (1 << shift);
-	return ( position > max );
+	auto cursor=eh_record_cursor_t(data, position, max, false);
+	if(cursor.read_sleb128(result))
+		return true;
+	position=cursor.getPosition();
+	return false;
 
 }
 
@@ -364,15 +283,59 @@ bool eh_frame_util_t<ptrsize>::read_length(
 }
 
 template <int ptrsize>
-eh_program_insn_t<ptrsize>::eh_program_insn_t() { }
+eh_program_insn_t<ptrsize>::eh_program_insn_t() : is_be(false), address_encoding(DW_EH_PE_absptr), operand_addr(0) { }
 
 template <int ptrsize>
-eh_program_insn_t<ptrsize>::eh_program_insn_t(const string &s) 
-	: program_bytes(s.begin(), next(s.begin(), s.size()))
+eh_program_insn_t<ptrsize>::eh_program_insn_t(const string &s, const bool p_is_be) 
+	: program_bytes(s.begin(), next(s.begin(), s.size())), is_be(p_is_be), address_encoding(DW_EH_PE_absptr), operand_addr(0)
 { }
 
 template <int ptrsize>
-void eh_program_insn_t<ptrsize>::print(uint64_t &pc, int64_t caf) const
+bool eh_program_insn_t<ptrsize>::read_address_operand(uint64_t &addr) const
+{
+	// set_loc's operand is encoded like the FDE's own pointers.  a pc-relative one is relative 
+	// to where the operand was parsed from, one byte past the opcode.
+	auto cursor=eh_record_cursor_t(program_bytes.data(), 1, program_bytes.size(), is_be);
+	return eh_frame_util_t<ptrsize>::read_type_with_encoding(address_encoding, addr, cursor, operand_addr-1);
+}
+
+template <int ptrsize>
+bool eh_program_insn_t<ptrsize>::read_advance_operand(uint64_t &delta) const
+{
+	// the unscaled delta of an advance_loc1/2/4. 
+	auto cursor=eh_record_cursor_t(program_bytes.data(), 1, program_bytes.size(), is_be);
+	switch(program_bytes[0])
+	{
+		case DW_CFA_advance_loc1:
+		{
+			auto loc=uint8_t(0);
+			if(cursor.read_type(loc))
+				return true;
+			delta=loc;
+			return false;
+		}
+		case DW_CFA_advance_loc2:
+		{
+			auto loc=uint16_t(0);
+			if(cursor.read_type(loc))
+				return true;
+			delta=loc;
+			return false;
+		}
+		case DW_CFA_advance_loc4:
+		{
+			auto loc=uint32_t(0);
+			if(cursor.read_type(loc))
+				return true;
+			delta=loc;
+			return false;
+		}
+	}
+	return true;
+}
+
+template <int ptrsize>
+void eh_program_insn_t<ptrsize>::print(ostream &out, uint64_t &pc, int64_t caf) const
 {
 	// make sure uint8_t is an unsigned char.	
 	static_assert(is_same<unsigned char, uint8_t>::value, "uint8_t is not unsigned char");
@@ -390,7 +353,7 @@ void eh_program_insn_t<ptrsize>::print(uint64_t &pc, int64_t caf) const
 		{
 			// case DW_CFA_advance_loc:
 			pc+=(opcode_lower6*caf);
-			cout<<"				cfa_advance_loc "<<dec<<+opcode_lower6<<" to "<<hex<<pc<<endl;
+			out<<"				cfa_advance_loc "<<dec<<+opcode_lower6<<" to "<<hex<<pc<<'\n';
 			break;
 		}
 		case 2:
@@ -399,13 +362,13 @@ void eh_program_insn_t<ptrsize>::print(uint64_t &pc, int64_t caf) const
 			if(eh_frame_util_t<ptrsize>::read_uleb128(uleb, pos, (const uint8_t* const)data.data(), max))
 				return;
 			// case DW_CFA_offset:
-			cout<<"				cfa_offset "<<dec<<uleb<<endl;
+			out<<"				cfa_offset "<<dec<<uleb<<'\n';
 			break;
 		}
 		case 3:
 		{
 			// case DW_CFA_restore (register #):
-			cout<<"				cfa_restore"<<endl;
+			out<<"				cfa_restore"<<'\n';
 			break;
 		}
 		case 0:
@@ -414,107 +377,108 @@ void eh_program_insn_t<ptrsize>::print(uint64_t &pc, int64_t caf) const
 			{
 			
 				case DW_CFA_nop:
-					cout<<"				nop" <<endl;
+					out<<"				nop" <<'\n';
 					break;
 				case DW_CFA_remember_state:
-					cout<<"				remember_state" <<endl;
+					out<<"				remember_state" <<'\n';
 					break;
 				case DW_CFA_restore_state:
-					cout<<"				restore_state" <<endl;
+					out<<"				restore_state" <<'\n';
 					break;
 
 				// takes single uleb128
 				case DW_CFA_undefined:
-					cout<<"				undefined" ;
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max); 
-					cout<<endl;
+					out<<"				undefined" ;
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max); 
+					out<<'\n';
 					break;
 		
 				case DW_CFA_same_value:
-					cout<<"				same_value ";
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max); 
-					cout<<endl;
+					out<<"				same_value ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max); 
+					out<<'\n';
 					break;
 				case DW_CFA_restore_extended:
-					cout<<"				restore_extended ";
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max); 
-					cout<<endl;
+					out<<"				restore_extended ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max); 
+					out<<'\n';
 					break;
 				case DW_CFA_def_cfa_register:
-					cout<<"				def_cfa_register ";
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max); 
-					cout<<endl;
+					out<<"				def_cfa_register ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max); 
+					out<<'\n';
 					break;
 				case DW_CFA_GNU_args_size:
-					cout<<"				GNU_arg_size ";
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max); 
-					cout<<endl;
+					out<<"				GNU_arg_size ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max); 
+					out<<'\n';
 					break;
 				case DW_CFA_def_cfa_offset:
-					cout<<"				def_cfa_offset "; 
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max); 
-					cout<<endl;
+					out<<"				def_cfa_offset "; 
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max); 
+					out<<'\n';
 					break;
 
 				case DW_CFA_set_loc:
 				{
-					auto arg=uintptr_t(0xDEADBEEF);
-					switch(ptrsize)
-					{
-						case 4:
-							arg=*(uint32_t*)&data.data()[pos]; break;
-						case 8:
-							arg=*(uint64_t*)&data.data()[pos]; break;
-					}
-					cout<<"				set_loc "<<hex<<arg<<endl;
+					auto arg=uint64_t(0xDEADBEEF);
+					if(read_address_operand(arg))
+						return;
+					out<<"				set_loc "<<hex<<arg<<'\n';
 					break;
 				}
 				case DW_CFA_advance_loc1:
 				{
-					auto loc=*(uint8_t*)(&data.data()[pos]);
+					auto loc=uint64_t(0);
+					if(read_advance_operand(loc))
+						return;
 					pc+=(loc*caf);
-					cout<<"				advance_loc1 "<<+loc<<" to " <<pc << endl;
+					out<<"				advance_loc1 "<<+loc<<" to " <<pc << '\n';
 					break;
 				}
 
 				case DW_CFA_advance_loc2:
 				{
-					auto loc=*(uint16_t*)(&data.data()[pos]);
+					auto loc=uint64_t(0);
+					if(read_advance_operand(loc))
+						return;
 					pc+=(loc*caf);
-					cout<<"				advance_loc2 "<<+loc<<" to " <<pc << endl;
+					out<<"				advance_loc2 "<<+loc<<" to " <<pc << '\n';
 					break;
 				}
 
 				case DW_CFA_advance_loc4:
 				{
-					auto loc=*(uint32_t*)(&data.data()[pos]);
+					auto loc=uint64_t(0);
+					if(read_advance_operand(loc))
+						return;
 					pc+=(loc*caf);
-					cout<<"				advance_loc4 "<<+loc<<" to " <<pc << endl;
+					out<<"				advance_loc4 "<<+loc<<" to " <<pc << '\n';
 					break;
 				}
 				case DW_CFA_offset_extended:
-					cout<<"				offset_extended ";
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max);
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max);
-					cout<<endl;
+					out<<"				offset_extended ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					out<<'\n';
 					break;
 				case DW_CFA_register:
-					cout<<"				register ";
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max);
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max);
-					cout<<endl;
+					out<<"				register ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					out<<'\n';
 					break;
 				case DW_CFA_def_cfa:
-					cout<<"				def_cfa ";
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max);
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max);
-					cout<<endl;
+					out<<"				def_cfa ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					out<<'\n';
 					break;
 				case DW_CFA_def_cfa_sf:
-					cout<<"				def_cfa_sf ";
-					print_uleb_operand(pos,(const uint8_t* const)data.data(),max);
-					print_sleb_operand(pos,(const uint8_t* const)data.data(),max);
-					cout<<endl;
+					out<<"				def_cfa_sf ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					print_sleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					out<<'\n';
 					break;
 
 				case DW_CFA_def_cfa_expression:
@@ -522,7 +486,7 @@ void eh_program_insn_t<ptrsize>::print(uint64_t &pc, int64_t caf) const
 					auto uleb=uint64_t(0);
 					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb, pos, (const uint8_t* const)data.data(), max))
 						return ;
-					cout<<"				def_cfa_expression "<<dec<<uleb<<endl;
+					out<<"				def_cfa_expression "<<dec<<uleb<<'\n';
 					break;
 				}
 				case DW_CFA_expression:
@@ -533,7 +497,7 @@ void eh_program_insn_t<ptrsize>::print(uint64_t &pc, int64_t caf) const
 						return ;
 					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb2, pos, (const uint8_t* const)data.data(), max))
 						return ;
-					cout<<"                              expression "<<dec<<uleb1<<" "<<uleb2<<endl;
+					out<<"                              expression "<<dec<<uleb1<<" "<<uleb2<<'\n';
 					break;
 				}
 				case DW_CFA_val_expression:
@@ -544,7 +508,7 @@ void eh_program_insn_t<ptrsize>::print(uint64_t &pc, int64_t caf) const
 						return ;
 					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb2, pos, (const uint8_t* const)data.data(), max))
 						return ;
-					cout<<"                              val_expression "<<dec<<uleb1<<" "<<uleb2<<endl;
+					out<<"                              val_expression "<<dec<<uleb1<<" "<<uleb2<<'\n';
 					break;
 				}
 				case DW_CFA_def_cfa_offset_sf:
@@ -552,7 +516,7 @@ void eh_program_insn_t<ptrsize>::print(uint64_t &pc, int64_t caf) const
 					auto leb=int64_t(0);
 					if(eh_frame_util_t<ptrsize>::read_sleb128(leb, pos, (const uint8_t* const)data.data(), max))
 						return ;
-					cout<<"					def_cfa_offset_sf "<<dec<<leb;
+					out<<"					def_cfa_offset_sf "<<dec<<leb;
 					break;
 				}
 				case DW_CFA_offset_extended_sf:
@@ -563,19 +527,37 @@ void eh_program_insn_t<ptrsize>::print(uint64_t &pc, int64_t caf) const
 						return ;
 					if(eh_frame_util_t<ptrsize>::read_sleb128(sleb2, pos, (const uint8_t* const)data.data(), max))
 						return ;
-					cout<<"                              offset_extended_sf "<<dec<<uleb1<<" "<<sleb2<<endl;
+					out<<"                              offset_extended_sf "<<dec<<uleb1<<" "<<sleb2<<'\n';
 					break;
 				}
+				case DW_CFA_val_offset:
+					out<<"				val_offset ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					out<<'\n';
+					break;
+				case DW_CFA_val_offset_sf:
+					out<<"				val_offset_sf ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					print_sleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					out<<'\n';
+					break;
+				case DW_CFA_GNU_negative_offset_extended:
+					out<<"				GNU_negative_offset_extended ";
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					print_uleb_operand(out,pos,(const uint8_t* const)data.data(),max);
+					out<<'\n';
+					break;
+				case DW_CFA_GNU_window_save:
+					out<<"				GNU_window_save" <<'\n';
+					break;
 
 
 				/* SGI/MIPS specific */
 				case DW_CFA_MIPS_advance_loc8:
 
-				/* GNU extensions */
-				case DW_CFA_GNU_window_save:
-				case DW_CFA_GNU_negative_offset_extended:
 				default:
-					cout<<"Unhandled opcode cannot print. opcode="<<opcode<<endl;
+					out<<"Unhandled opcode cannot print. opcode="<<opcode<<'\n';
 			}
 			break;
 		}
@@ -649,33 +631,18 @@ tuple<string, int64_t, int64_t> eh_program_insn_t<ptrsize>::decode() const
                     return make_tuple("def_cfa_offset", uleb, 0);
                 case DW_CFA_set_loc:
                 {
-                    auto arg = uintptr_t(0xDEADBEEF);
-                    switch(ptrsize)
-                    {
-                        case 4:
-                            arg = *(uint32_t*)&data.data()[pos];
-                            break;
-                        case 8:
-                            arg = *(uint64_t*)&data.data()[pos];
-                            break;
-                    }
+                    auto arg = uint64_t(0xDEADBEEF);
+                    if(read_address_operand(arg))
+                        return make_tuple("unexpected_error", 0, 0);
                     return make_tuple("set_loc", arg, 0);
                 }
                 case DW_CFA_advance_loc1:
-                {
-                    auto loc = *(uint8_t*)(&data.data()[pos]);
-                    return make_tuple("advance_loc", loc, 0);
-                }
-
                 case DW_CFA_advance_loc2:
-                {
-                    auto loc = *(uint16_t*)(&data.data()[pos]);
-                    return make_tuple("advance_loc", loc, 0);
-                }
-
                 case DW_CFA_advance_loc4:
                 {
-                    auto loc = *(uint32_t*)(&data.data()[pos]);
+                    auto loc = uint64_t(0);
+                    if(read_advance_operand(loc))
+                        return make_tuple("unexpected_error", 0, 0);
                     return make_tuple("advance_loc", loc, 0);
                 }
                 case DW_CFA_offset_extended:
@@ -729,16 +696,51 @@ tuple<string, int64_t, int64_t> eh_program_insn_t<ptrsize>::decode() const
                         return make_tuple("unexpected_error", 0, 0);
                     return make_tuple("offset_extended_sf", uleb, sleb);
                 }
+                case DW_CFA_val_offset:
+                    if(eh_frame_util_t<ptrsize>::read_uleb128(
+                           uleb, pos, (const uint8_t* const)data.data(), max))
+                        return make_tuple("unexpected_error", 0, 0);
+                    if(eh_frame_util_t<ptrsize>::read_uleb128(
+                           uleb2, pos, (const uint8_t* const)data.data(), max))
+                        return make_tuple("unexpected_error", 0, 0);
+                    return make_tuple("val_offset", uleb, uleb2);
+                case DW_CFA_val_offset_sf:
+                    if(eh_frame_util_t<ptrsize>::read_uleb128(
+                           uleb, pos, (const uint8_t* const)data.data(), max))
+                        return make_tuple("unexpected_error", 0, 0);
+                    if(eh_frame_util_t<ptrsize>::read_sleb128(
+                           sleb, pos, (const uint8_t* const)data.data(), max))
+                        return make_tuple("unexpected_error", 0, 0);
+                    return make_tuple("val_offset_sf", uleb, sleb);
+                case DW_CFA_GNU_negative_offset_extended:
+                    if(eh_frame_util_t<ptrsize>::read_uleb128(
+                           uleb, pos, (const uint8_t* const)data.data(), max))
+                        return make_tuple("unexpected_error", 0, 0);
+                    if(eh_frame_util_t<ptrsize>::read_uleb128(
+                           uleb2, pos, (const uint8_t* const)data.data(), max))
+                        return make_tuple("unexpected_error", 0, 0);
+                    return make_tuple("GNU_negative_offset_extended", uleb, uleb2);
+                case DW_CFA_GNU_window_save:
+                    return make_tuple("GNU_window_save", 0, 0);
 
                 case DW_CFA_def_cfa_expression:
+                    if(eh_frame_util_t<ptrsize>::read_uleb128(
+                           uleb, pos, (const uint8_t* const)data.data(), max))
+                        return make_tuple("unexpected_error", 0, 0);
+                    return make_tuple("def_cfa_expression", uleb, 0);
                 case DW_CFA_expression:
                 case DW_CFA_val_expression:
+                    if(eh_frame_util_t<ptrsize>::read_uleb128(
+                           uleb, pos, (const uint8_t* const)data.data(), max))
+                        return make_tuple("unexpected_error", 0, 0);
+                    if(eh_frame_util_t<ptrsize>::read_uleb128(
+                           uleb2, pos, (const uint8_t* const)data.data(), max))
+                        return make_tuple("unexpected_error", 0, 0);
+                    return make_tuple(opcode_lower6==DW_CFA_expression ? "expression" : "val_expression", uleb, uleb2);
                 /* SGI/MIPS specific */
                 case DW_CFA_MIPS_advance_loc8:
                 /* GNU extensions */
 				case DW_CFA_GNU_args_size:
-                case DW_CFA_GNU_window_save:
-                case DW_CFA_GNU_negative_offset_extended:
                 default:
                     return make_tuple("unhandled_instruction", 0, 0);
             }
@@ -747,42 +749,152 @@ tuple<string, int64_t, int64_t> eh_program_insn_t<ptrsize>::decode() const
     }
 }
 
+template <int ptrsize>
+bool eh_program_insn_t<ptrsize>::getExpression(EHPExpressionOpVector_t &ops) const
+{
+	ops.clear();
+	if(program_bytes.size()==0)
+		return true;
+
+	auto cursor=eh_record_cursor_t(program_bytes.data(), 1, program_bytes.size(), is_be);
+	auto reg=uint64_t(0);
+	auto len=uint64_t(0);
+	switch(program_bytes[0])
+	{
+		case DW_CFA_def_cfa_expression:
+			break;
+		case DW_CFA_expression:
+		case DW_CFA_val_expression:
+			if(cursor.read_uleb128(reg))
+				return true;
+			break;
+		default:
+			return true;
+	}
+	if(cursor.read_uleb128(len) || len > cursor.remaining())
+		return true;
+
+	const auto expr_start=&program_bytes[cursor.getPosition()];
+	return compile_expression(expr_start, expr_start+len, is_be, ptrsize, ops);
+}
+
+template <int ptrsize>
+eh_frame_hdr_t<ptrsize>::eh_frame_hdr_t()
+	:
+	version(0),
+	eh_frame_ptr_encoding(DW_EH_PE_omit),
+	fde_count_encoding(DW_EH_PE_omit),
+	table_encoding(DW_EH_PE_omit),
+	eh_frame_ptr(0),
+	fde_count(0),
+	table_position(0)
+{
+}
+
+template <int ptrsize>
+bool eh_frame_hdr_t<ptrsize>::parse(
+	const uint8_t* const data, 
+	const uint64_t max, 
+	const uint64_t hdr_addr, 
+	const bool is_be, 
+	EHPSearchTable_t *table
+	)
+{
+	auto cursor=eh_record_cursor_t(data, 0, max, is_be);
+	if(cursor.read_type(version) || version!=1)
+		return true;
+	if(cursor.read_type(eh_frame_ptr_encoding) || cursor.read_type(fde_count_encoding) || cursor.read_type(table_encoding))
+		return true;
+
+	// table entries are usually relative to the start of this section, which the generic decoder does not know.
+	const auto read_encoded=[&](const uint8_t encoding, uint64_t &value) -> bool
+	{
+		if((encoding & 0x70)!=DW_EH_PE_datarel)
+			return eh_frame_util_t<ptrsize>::read_type_with_encoding(encoding, value, cursor, hdr_addr);
+		if(eh_frame_util_t<ptrsize>::read_type_with_encoding(encoding & 0x0f, value, cursor, hdr_addr))
+			return true;
+		value+=hdr_addr;
+		return false;
+	};
+
+	if(read_encoded(eh_frame_ptr_encoding, eh_frame_ptr))
+		return true;
+	if(fde_count_encoding==DW_EH_PE_omit || table_encoding==DW_EH_PE_omit)
+		return true;
+	if(read_encoded(fde_count_encoding, fde_count))
+		return true;
+	table_position=cursor.getPosition();
+
+	// every entry is at least two bytes, so a larger count cannot be right.
+	if(fde_count > cursor.remaining()/2)
+		return true;
+	if(table==nullptr)
+		return false;
+
+	table->clear();
+	table->reserve(fde_count);
+
+	// the table is almost always 4-byte signed offsets from this section, decode those without the generic path.
+	if(table_encoding==(DW_EH_PE_datarel | DW_EH_PE_sdata4))
+	{
+		if(cursor.remaining() < fde_count*8)
+			return true;
+		for(auto i=uint64_t(0); i < fde_count; i++)
+		{
+			const auto initial_location=cursor.read_unchecked<int32_t>();
+			const auto fde_address=cursor.read_unchecked<int32_t>();
+			table->push_back({hdr_addr+initial_location, hdr_addr+fde_address});
+		}
+		return false;
+	}
+
+	for(auto i=uint64_t(0); i < fde_count; i++)
+	{
+		auto entry=EHPSearchTableEntry_t({0, 0});
+		if(read_encoded(table_encoding, entry.initial_location) || read_encoded(table_encoding, entry.fde_address))
+			return true;
+		table->push_back(entry);
+	}
+	return false;
+}
+
 template <int ptrsize>
 void eh_program_insn_t<ptrsize>::push_byte(uint8_t c) { program_bytes.push_back(c); }
 
 template <int ptrsize>
 void eh_program_insn_t<ptrsize>::print_uleb_operand(
+	ostream &out,
 	uint64_t pos,
 	const uint8_t* const data, 
 	const uint64_t max)
 {
 	auto uleb=uint64_t(0xdeadbeef);
 	eh_frame_util_t<ptrsize>::read_uleb128(uleb, pos, data, max);
-	cout<<" "<<dec<<uleb;
+	out<<" "<<dec<<uleb;
 }
 
 template <int ptrsize>
 void eh_program_insn_t<ptrsize>::print_sleb_operand(
+	ostream &out,
 	uint64_t pos,
 	const uint8_t* const data, 
 	const uint64_t max)
 {
 	auto leb=int64_t(0xdeadbeef);
 	eh_frame_util_t<ptrsize>::read_sleb128(leb, pos, data, max);
-	cout<<" "<<dec<<leb;
+	out<<" "<<dec<<leb;
 }
 
 template <int ptrsize>
 bool eh_program_insn_t<ptrsize>::parse_insn(
 	uint8_t opcode, 
-	uint64_t &pos,
-	const uint8_t* const data, 
-	const uint64_t &max, 
-	const bool is_be
+	eh_record_cursor_t &cursor,
+	const uint8_t p_address_encoding,
+	const uint64_t section_addr
 	)
 {
 	auto &eh_insn = *this;
-	auto insn_start=pos-1;
+	auto insn_start=cursor.getPosition()-1;
 	auto opcode_upper2=(uint8_t)(opcode >> 6);
 	auto opcode_lower6=(uint8_t)(opcode & (0x3f));
 
@@ -797,7 +909,7 @@ bool eh_program_insn_t<ptrsize>::parse_insn(
 		case 2:
 		{
 			auto uleb=uint64_t(0);
-			if(eh_frame_util_t<ptrsize>::read_uleb128(uleb, pos, data, max))
+			if(cursor.read_uleb128(uleb))
 				return true;
 			// case DW_CFA_offset:
 			break;
@@ -826,44 +938,51 @@ bool eh_program_insn_t<ptrsize>::parse_insn(
 				case DW_CFA_def_cfa_offset:
 				{
 					auto uleb=uint64_t(0);
-					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb, pos, data, max))
+					if(cursor.read_uleb128(uleb))
 						return true;
 					break;
 				}
 
 				case DW_CFA_set_loc:
-					pos+=ptrsize;
-					if(pos>max)
+				{
+					// the operand's size depends on its encoding.  without an 'R' augmentation, 
+					// addresses are absolute.
+					const auto encoding = p_address_encoding==DW_EH_PE_omit ? uint8_t(DW_EH_PE_absptr) : p_address_encoding;
+					const auto operand_position=cursor.getPosition();
+					auto addr=uint64_t(0);
+					if(eh_frame_util_t<ptrsize>::read_type_with_encoding(encoding, addr, cursor, section_addr))
 						return true;
+					eh_insn.address_encoding=encoding;
+					eh_insn.operand_addr=section_addr+operand_position;
 					break;
+				}
 
 				case DW_CFA_advance_loc1:
-					pos+=1;
-					if(pos>max)
+					if(cursor.skip(1))
 						return true;
 					break;
 
 				case DW_CFA_advance_loc2:
-					pos+=2;
-					if(pos>max)
+					if(cursor.skip(2))
 						return true;
 					break;
 
 				case DW_CFA_advance_loc4:
-					pos+=4;
-					if(pos>max)
+					if(cursor.skip(4))
 						return true;
 					break;
 
 				case DW_CFA_offset_extended:
 				case DW_CFA_register:
 				case DW_CFA_def_cfa:
+				case DW_CFA_val_offset:
+				case DW_CFA_GNU_negative_offset_extended:
 				{
 					auto uleb1=uint64_t(1);
 					auto uleb2=uint64_t(0);
-					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb1, pos, data, max))
+					if(cursor.read_uleb128(uleb1))
 						return true;
-					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb2, pos, data, max))
+					if(cursor.read_uleb128(uleb2))
 						return true;
 					break;
 				}
@@ -871,9 +990,9 @@ bool eh_program_insn_t<ptrsize>::parse_insn(
 				{
 					auto leb1=uint64_t(0);
 					auto leb2=int64_t(0);
-					if(eh_frame_util_t<ptrsize>::read_uleb128(leb1, pos, data, max))
+					if(cursor.read_uleb128(leb1))
 						return true;
-					if(eh_frame_util_t<ptrsize>::read_sleb128(leb2, pos, data, max))
+					if(cursor.read_sleb128(leb2))
 						return true;
 					break;
 				}
@@ -881,10 +1000,9 @@ bool eh_program_insn_t<ptrsize>::parse_insn(
 				case DW_CFA_def_cfa_expression:
 				{
 					auto uleb=uint64_t(0);
-					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb, pos, data, max))
+					if(cursor.read_uleb128(uleb))
 						return true;
-					pos+=uleb;
-					if(pos>max)
+					if(cursor.skip(uleb))
 						return true;
 					break;
 				}
@@ -893,43 +1011,39 @@ bool eh_program_insn_t<ptrsize>::parse_insn(
 				{
 					auto uleb1=uint64_t(0);
 					auto uleb2=uint64_t(0);
-					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb1, pos, data, max))
+					if(cursor.read_uleb128(uleb1))
 						return true;
-					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb2, pos, data, max))
+					if(cursor.read_uleb128(uleb2))
 						return true;
-					pos+=uleb2;
-					if(pos>max)
+					if(cursor.skip(uleb2))
 						return true;
 					break;
 				}
 				case DW_CFA_def_cfa_offset_sf:
 				{
 					auto leb=int64_t(0);
-					if(eh_frame_util_t<ptrsize>::read_sleb128(leb, pos, data, max))
+					if(cursor.read_sleb128(leb))
 						return true;
 					break;
 				}
 				case DW_CFA_offset_extended_sf:
+				case DW_CFA_val_offset_sf:
 				{
 					auto uleb1=uint64_t(0);
 					auto sleb2=int64_t(0);
-					if(eh_frame_util_t<ptrsize>::read_uleb128(uleb1, pos, data, max))
+					if(cursor.read_uleb128(uleb1))
 						return true;
-					if(eh_frame_util_t<ptrsize>::read_sleb128(sleb2, pos, data, max))
+					if(cursor.read_sleb128(sleb2))
 						return true;
 					break;
 				}
-				/* Dwarf 2.1 */
-				case DW_CFA_val_offset:
-				case DW_CFA_val_offset_sf:
 
+				/* GNU extensions.  aarch64 uses window_save as negate_ra_state. */
+				case DW_CFA_GNU_window_save:
+					break;
 
 				/* SGI/MIPS specific */
 				case DW_CFA_MIPS_advance_loc8:
-
-				/* GNU extensions */
-				case DW_CFA_GNU_window_save:
-				case DW_CFA_GNU_negative_offset_extended:
 				default:
 					// Unhandled opcode cannot xform this eh-frame
 					cout<<"No decoder for opcode "<<+opcode<<endl;
@@ -943,11 +1057,10 @@ bool eh_program_insn_t<ptrsize>::parse_insn(
 	}
 
 	// insert bytes into the instruction.
-	auto insn_end=pos;
-	for_each( &data[insn_start], &data[insn_end], [&](const uint8_t c)
-	{
-		eh_insn.push_byte(c);
-	});
+	const auto data=cursor.getData();
+	auto insn_end=cursor.getPosition();
+	eh_insn.program_bytes.assign(&data[insn_start], &data[insn_end]);
+	eh_insn.is_be=cursor.isBigEndian();
 	return false;
 }
 
@@ -1017,12 +1130,9 @@ bool eh_program_insn_t<ptrsize>::advance(uint64_t &cur_addr, uint64_t CAF) const
 	// make sure uint8_t is an unsigned char.	
 	static_assert(is_same<unsigned char, uint8_t>::value, "uint8_t is not unsigned char");
 
-	auto &data=program_bytes;
 	auto opcode=program_bytes[0];
 	auto opcode_upper2=(uint8_t)(opcode >> 6);
 	auto opcode_lower6=(uint8_t)(opcode & (0x3f));
-	auto pos=uint64_t(1);
-	//auto max=program_bytes.size();
 
 	switch(opcode_upper2)
 	{
@@ -1038,26 +1148,19 @@ bool eh_program_insn_t<ptrsize>::advance(uint64_t &cur_addr, uint64_t CAF) const
 			{
 				case DW_CFA_set_loc:
 				{
-					throw_assert(0);
+					auto addr=uint64_t(0);
+					if(read_address_operand(addr))
+						return false;
+					cur_addr=addr;
 					return true;
 				}
 				case DW_CFA_advance_loc1:
-				{
-					auto loc=*(uint8_t*)(&data.data()[pos]);
-					cur_addr+=(loc*CAF);
-					return true;
-				}
-
 				case DW_CFA_advance_loc2:
-				{
-					auto loc=*(uint16_t*)(&data.data()[pos]);
-					cur_addr+=(loc*CAF);
-					return true;
-				}
-
 				case DW_CFA_advance_loc4:
 				{
-					auto loc=*(uint32_t*)(&data.data()[pos]);
+					auto loc=uint64_t(0);
+					if(read_advance_operand(loc))
+						return false;
 					cur_addr+=(loc*CAF);
 					return true;
 				}
@@ -1088,34 +1191,27 @@ template <int ptrsize>
 void eh_program_t<ptrsize>::push_insn(const eh_program_insn_t<ptrsize> &i) { instructions.push_back(i); }
 
 template <int ptrsize>
-void eh_program_t<ptrsize>::print(const uint64_t start_addr, const int64_t caf) const
+void eh_program_t<ptrsize>::print(ostream &out, const uint64_t start_addr, const int64_t caf) const
 {
 	auto pc=start_addr;
-	cout << "			Program:                  " << endl ;
+	out << "			Program:                  " << '\n' ;
 	for (const auto &i : instructions) 
 	{ 
-		i.print(pc,caf);
+		i.print(out,pc,caf);
 	}
 }
 
 template <int ptrsize>
-bool eh_program_t<ptrsize>::parse_program(
-	const uint64_t& program_start_position,
-	const uint8_t* const data, 
-	const uint64_t &max_program_pos,
-	const bool is_be
-	)
+bool eh_program_t<ptrsize>::parse_program(eh_record_cursor_t &cursor, const uint8_t address_encoding, const uint64_t section_addr)
 {
 	eh_program_t &eh_pgm=*this;
-	auto max=max_program_pos;
-	auto pos=program_start_position;
-	while(pos < max_program_pos)
+	position=cursor.getPosition();
+	while(cursor.remaining() > 0)
 	{
-		auto opcode=uint8_t(0);
-		if(eh_frame_util_t<ptrsize>::read_type(opcode,pos,data,max, is_be))
-			return true;
+		// at least one byte remains, so the opcode itself needs no check.
+		auto opcode=cursor.read_unchecked<uint8_t>();
 		eh_program_insn_t<ptrsize> eh_insn;
-		if(eh_insn.parse_insn(opcode,pos,data,max, is_be))
+		if(eh_insn.parse_insn(opcode,cursor,address_encoding,section_addr))
 			return true;
 
 		eh_pgm.push_insn(eh_insn);
@@ -1188,24 +1284,18 @@ bool cie_contents_t<ptrsize>::parse_cie(
 	const bool is_be)
 {
 	auto &c=*this;
-	const auto eh_frame_scoop_data= data;
-	auto position=cie_position;
+	auto cursor=eh_record_cursor_t();
 	auto length= uint64_t(0);
 
-	if(this->read_length(length, position, eh_frame_scoop_data, max, is_be))
-		return true;
-
-	auto end_pos=position+length;
-	if(end_pos > max)
+	// validate the record extent once, all further reads are bounded by the CIE itself.
+	if(eh_record_cursor_t::open_record(cursor, length, cie_position, data, max, is_be))
 		return true;
 
-	auto cie_id=uint32_t(0);
-	if(this->read_type(cie_id, position, eh_frame_scoop_data, max, is_be))
-		return true;
-
-	auto cie_version=uint8_t(0);
-	if(this->read_type(cie_version, position, eh_frame_scoop_data, max, is_be))
+	// open_record guarantees room for the id, check for the version with it.
+	if(cursor.remaining() < sizeof(uint32_t)+sizeof(uint8_t))
 		return true;
+	auto cie_id=cursor.read_unchecked<uint32_t>();
+	auto cie_version=cursor.read_unchecked<uint8_t>();
 
 	if(cie_version==1) 
 	{ } // OK
@@ -1216,15 +1306,15 @@ bool cie_contents_t<ptrsize>::parse_cie(
 		return true;	
 
 	auto augmentation=string();
-	if(this->read_string(augmentation, position, eh_frame_scoop_data, max))
+	if(cursor.read_string(augmentation))
 		return true;
 
 	auto code_alignment_factor=uint64_t(0);
-	if(this->read_uleb128(code_alignment_factor, position, eh_frame_scoop_data, max))
+	if(cursor.read_uleb128(code_alignment_factor))
 		return true;
 	
 	auto data_alignment_factor=int64_t(0);
-	if(this->read_sleb128(data_alignment_factor, position, eh_frame_scoop_data, max))
+	if(cursor.read_sleb128(data_alignment_factor))
 		return true;
 
 	// type depends on version info.  can always promote to 64 bits.
@@ -1232,14 +1322,14 @@ bool cie_contents_t<ptrsize>::parse_cie(
 	if(cie_version==1)
 	{
 		auto return_address_register_column_8=uint8_t(0);
-		if(this->read_type(return_address_register_column_8, position, eh_frame_scoop_data, max, is_be))
+		if(cursor.read_type(return_address_register_column_8))
 			return true;
 		return_address_register_column=return_address_register_column_8;
 	}
 	else if(cie_version==3)
 	{
 		auto return_address_register_column_64=uint64_t(0);
-		if(this->read_uleb128(return_address_register_column_64, position, eh_frame_scoop_data, max))
+		if(cursor.read_uleb128(return_address_register_column_64))
 			return true;
 		return_address_register_column=return_address_register_column_64;
 	}
@@ -1249,7 +1339,7 @@ bool cie_contents_t<ptrsize>::parse_cie(
 	auto augmentation_data_length=uint64_t(0);
 	if(augmentation.find("z") != string::npos)
 	{
-		if(this->read_uleb128(augmentation_data_length, position, eh_frame_scoop_data, max))
+		if(cursor.read_uleb128(augmentation_data_length))
 			return true;
 	}
 	auto personality_encoding=uint8_t(DW_EH_PE_omit);
@@ -1258,32 +1348,32 @@ bool cie_contents_t<ptrsize>::parse_cie(
 	auto personality_pointer_size=uint64_t(0);
 	if(augmentation.find("P") != string::npos)
 	{
-		if(this->read_type(personality_encoding, position, eh_frame_scoop_data, max, is_be))
+		if(cursor.read_type(personality_encoding))
 			return true;
-		personality_pointer_position=position;
+		personality_pointer_position=cursor.getPosition();
 
 		// indirect is OK as a personality encoding, but we don't need to go that far.
 		// we just need to record what's in the CIE, regardless of whether it's the actual
 		// personality routine or it's the pointer to the personality routine.
 		auto personality_encoding_sans_indirect = personality_encoding&(~DW_EH_PE_indirect);
-		if(this->read_type_with_encoding(personality_encoding_sans_indirect, personality, position, eh_frame_scoop_data, max, eh_addr, is_be))
+		if(this->read_type_with_encoding(personality_encoding_sans_indirect, personality, cursor, eh_addr))
 			return true;
-		personality_pointer_size=position - personality_pointer_position;
+		personality_pointer_size=cursor.getPosition() - personality_pointer_position;
 	}
 
 	auto lsda_encoding=uint8_t(DW_EH_PE_omit);
 	if(augmentation.find("L") != string::npos)
 	{
-		if(this->read_type(lsda_encoding, position, eh_frame_scoop_data, max, is_be))
+		if(cursor.read_type(lsda_encoding))
 			return true;
 	}
 	auto fde_encoding=uint8_t(DW_EH_PE_omit);
 	if(augmentation.find("R") != string::npos)
 	{
-		if(this->read_type(fde_encoding, position, eh_frame_scoop_data, max, is_be))
+		if(cursor.read_type(fde_encoding))
 			return true;
 	}
-	if(eh_pgm.parse_program(position, eh_frame_scoop_data, end_pos, is_be))
+	if(eh_pgm.parse_program(cursor, fde_encoding, eh_addr))
 		return true;
 
 
@@ -1308,23 +1398,23 @@ bool cie_contents_t<ptrsize>::parse_cie(
 }
 
 template <int ptrsize>
-void cie_contents_t<ptrsize>::print(const uint64_t startAddr) const 
-{
-	cout << "["<<setw(6)<<hex<<cie_position<<"] CIE length="<<dec<<length<<endl;
-	cout << "   CIE_id:                   " << +cie_id << endl;
-	cout << "   version:                  " << +cie_version << endl;
-	cout << "   augmentation:             \"" << augmentation << "\"" << endl;
-	cout << "   code_alignment_factor:    " << code_alignment_factor << endl;
-	cout << "   data_alignment_factor:    " << dec << data_alignment_factor << endl;
-	cout << "   return_address_register:  " << dec << return_address_register_column << endl;
-	cout << "   Augmentation data:        " << endl ;
-	cout << "                             aug data len:         " << hex << +augmentation_data_length << endl;
-	cout << "                             personality_encoding: " << hex << +personality_encoding << endl;
-	cout << "                             personality:          " << hex << +personality << endl;
-	cout << "                             lsda_encoding:        " << hex << +lsda_encoding << endl;
-	cout << "                             fde_encoding:         " << hex << +fde_encoding << endl;
-	cout << "   Program:        " << endl ;
-	eh_pgm.print(startAddr,getCAF());
+void cie_contents_t<ptrsize>::print(ostream &out, const uint64_t startAddr) const
+{
+	out << "["<<setw(6)<<hex<<cie_position<<"] CIE length="<<dec<<length<<'\n';
+	out << "   CIE_id:                   " << +cie_id << '\n';
+	out << "   version:                  " << +cie_version << '\n';
+	out << "   augmentation:             \"" << augmentation << "\"" << '\n';
+	out << "   code_alignment_factor:    " << code_alignment_factor << '\n';
+	out << "   data_alignment_factor:    " << dec << data_alignment_factor << '\n';
+	out << "   return_address_register:  " << dec << return_address_register_column << '\n';
+	out << "   Augmentation data:        " << '\n' ;
+	out << "                             aug data len:         " << hex << +augmentation_data_length << '\n';
+	out << "                             personality_encoding: " << hex << +personality_encoding << '\n';
+	out << "                             personality:          " << hex << +personality << '\n';
+	out << "                             lsda_encoding:        " << hex << +lsda_encoding << '\n';
+	out << "                             fde_encoding:         " << hex << +fde_encoding << '\n';
+	out << "   Program:        " << '\n' ;
+	eh_pgm.print(out,startAddr,getCAF());
 	
 }
 
@@ -1359,9 +1449,9 @@ bool lsda_call_site_action_t<ptrsize>::parse_lcsa(uint64_t &pos, const uint8_t*
 }
 
 template <int ptrsize>
-void lsda_call_site_action_t<ptrsize>::print() const
+void lsda_call_site_action_t<ptrsize>::print(ostream &out) const
 {
-	cout<<"					"<<action<<endl;
+	out<<"					"<<action<<'\n';
 }
 
 template <int ptrsize>
@@ -1372,7 +1462,7 @@ bool operator< (const lsda_call_site_action_t <ptrsize> &lhs, const lsda_call_si
 
 template <int ptrsize>
 lsda_type_table_entry_t<ptrsize>::lsda_type_table_entry_t() : 
-	pointer_to_typeinfo(0), tt_encoding(0)
+	pointer_to_typeinfo(0), tt_encoding(0), tt_encoding_size(0)
 {}
 
 
@@ -1403,6 +1493,10 @@ bool lsda_type_table_entry_t<ptrsize>::parse(
 	const auto has_pcrel = (tt_encoding & DW_EH_PE_pcrel) == DW_EH_PE_pcrel;
 	switch(tt_encoding & 0xf) // get just the size field
 	{
+		case DW_EH_PE_udata2:
+		case DW_EH_PE_sdata2:
+			tt_encoding_size=2;
+			break;
 		case DW_EH_PE_udata4:
 		case DW_EH_PE_sdata4:
 			tt_encoding_size=4;
@@ -1415,8 +1509,11 @@ bool lsda_type_table_entry_t<ptrsize>::parse(
 			tt_encoding_size=ptrsize;
 			break;
 		default:
-			throw_assert(0);
+			return true;
 	}
+	// the type table is indexed backwards from its base, make sure the entry is inside the section.
+	if(index*tt_encoding_size > tt_pos)
+		return true;
 	const auto orig_act_pos=uint64_t(tt_pos+(-static_cast<int64_t>(index)*tt_encoding_size));
 	auto act_pos=uint64_t(tt_pos+(-static_cast<int64_t>(index)*tt_encoding_size));
 	if(this->read_type_with_encoding(tt_encoding_sans_indir_sans_pcrel, pointer_to_typeinfo, act_pos, data, max, data_addr, is_be))
@@ -1431,9 +1528,9 @@ bool lsda_type_table_entry_t<ptrsize>::parse(
 
 
 template <int ptrsize>
-void lsda_type_table_entry_t<ptrsize>::print() const
+void lsda_type_table_entry_t<ptrsize>::print(ostream &out) const
 {
-	cout<<"				pointer_to_typeinfo: 0x"<<hex<<pointer_to_typeinfo<<endl;
+	out<<"				pointer_to_typeinfo: 0x"<<hex<<pointer_to_typeinfo<<'\n';
 }
 
 
@@ -1462,6 +1559,13 @@ const LSDACallSiteActionVector_t* lsda_call_site_t<ptrsize>::getActionTable() co
 	return &action_table_cache;
 }
 
+template <int ptrsize>
+void lsda_call_site_t<ptrsize>::build_caches() const
+{
+	action_table_cache.clear();
+	transform(ALLOF(action_table), back_inserter(action_table_cache), [](const lsda_call_site_action_t<ptrsize> &a) { return &a;});
+}
+
 
 
 
@@ -1520,6 +1624,10 @@ bool lsda_call_site_t<ptrsize>::parse_lcs(
 			if(lcsa.parse_lcsa(act_table_pos, data, gcc_except_table_max, end, is_be))  /* expect action table after cs_max */
 				return true;
 			action_table.push_back(lcsa);
+
+			// each action record is at least 2 bytes, so a longer chain must be a cycle.
+			if(action_table.size() > gcc_except_table_max/2)
+				return true;
 			
 		}
 	}
@@ -1537,22 +1645,22 @@ bool lsda_call_site_t<ptrsize>::parse_lcs(
 
 
 template <int ptrsize>
-void lsda_call_site_t<ptrsize>::print() const
+void lsda_call_site_t<ptrsize>::print(ostream &out) const
 {
-	cout<<"				CS Offset        : 0x"<<hex<<call_site_offset<<endl;
-	cout<<"				CS len           : 0x"<<hex<<call_site_length<<endl;
-	cout<<"				landing pad off. : 0x"<<hex<<landing_pad_offset<<endl;
-	cout<<"				action (1+addr)  : 0x"<<hex<<action<<endl;
-	cout<<"				---interpreted---"<<endl;
-	cout<<"				CS Addr          : 0x"<<hex<<call_site_addr<<endl;
-	cout<<"				CS End Addr      : 0x"<<hex<<call_site_end_addr<<endl;
-	cout<<"				landing pad addr : 0x"<<hex<<landing_pad_addr<<endl;
-	cout<<"				act-tab off      : 0x"<<hex<<action_table_offset<<endl;
-	cout<<"				act-tab addr     : 0x"<<hex<<action_table_addr<<endl;
-	cout<<"				act-tab 	 : "<<endl;
+	out<<"				CS Offset        : 0x"<<hex<<call_site_offset<<'\n';
+	out<<"				CS len           : 0x"<<hex<<call_site_length<<'\n';
+	out<<"				landing pad off. : 0x"<<hex<<landing_pad_offset<<'\n';
+	out<<"				action (1+addr)  : 0x"<<hex<<action<<'\n';
+	out<<"				---interpreted---"<<'\n';
+	out<<"				CS Addr          : 0x"<<hex<<call_site_addr<<'\n';
+	out<<"				CS End Addr      : 0x"<<hex<<call_site_end_addr<<'\n';
+	out<<"				landing pad addr : 0x"<<hex<<landing_pad_addr<<'\n';
+	out<<"				act-tab off      : 0x"<<hex<<action_table_offset<<'\n';
+	out<<"				act-tab addr     : 0x"<<hex<<action_table_addr<<'\n';
+	out<<"				act-tab 	 : "<<'\n';
 	for_each(action_table.begin(), action_table.end(), [&](const lsda_call_site_action_t<ptrsize>& p)
 	{
-		p.print();
+		p.print(out);
 	});
 }
 
@@ -1578,44 +1686,43 @@ lsda_t<ptrsize>::lsda_t() :
 template <int ptrsize>
 bool lsda_t<ptrsize>::parse_lsda(
                                  const uint64_t lsda_addr, 
-                                 //const DataScoop_t* gcc_except_scoop, 
-                                 const ScoopReplacement_t *gcc_except_scoop, 
+                                 const image_section_t &gcc_except_table, 
                                  const uint64_t fde_region_start,
 				 const bool is_be
                                 )
 {
-	// make sure there's a scoop and that we're in the range.
-	if(!gcc_except_scoop)
+	// make sure there's a section and that we're in the range.
+	if(gcc_except_table.data==nullptr || gcc_except_table.size==0)
 		return true;
-	if(lsda_addr<gcc_except_scoop->getStart())
+	if(lsda_addr<gcc_except_table.addr)
 		return true;
-	if(lsda_addr>=gcc_except_scoop->getEnd())
+	if(lsda_addr>=gcc_except_table.addr+gcc_except_table.size-1)
 		return true;
 
-	const auto &data=gcc_except_scoop->getContents();
-	const auto data_addr=gcc_except_scoop->getStart();
-	const auto max=gcc_except_scoop->getContents().size();
+	const auto data=gcc_except_table.data;
+	const auto data_addr=gcc_except_table.addr;
+	const auto max=gcc_except_table.size;
 	auto pos=uint64_t(lsda_addr-data_addr);
 	auto start_pos=pos;
 
-	if(this->read_type(landing_pad_base_encoding, pos, (const uint8_t* const)data.data(), max, is_be))
+	if(this->read_type(landing_pad_base_encoding, pos, data, max, is_be))
 		return true;
 	if(landing_pad_base_encoding!=DW_EH_PE_omit)
 	{
-		if(this->read_type_with_encoding(landing_pad_base_encoding,landing_pad_base_addr, pos, (const uint8_t* const)data.data(), max, data_addr, is_be))
+		if(this->read_type_with_encoding(landing_pad_base_encoding,landing_pad_base_addr, pos, data, max, data_addr, is_be))
 			return true;
 	}
 	else
 		landing_pad_base_addr=fde_region_start;
 
-	if(this->read_type(type_table_encoding, pos, (const uint8_t* const)data.data(), max, is_be))
+	if(this->read_type(type_table_encoding, pos, data, max, is_be))
 		return true;
 
 	auto type_table_pos=uint64_t(0);
 	if(type_table_encoding!=DW_EH_PE_omit)
 	{
 		type_table_addr_location = pos + data_addr;
-		if(this->read_uleb128(type_table_offset, pos, (const uint8_t* const)data.data(), max))
+		if(this->read_uleb128(type_table_offset, pos, data, max))
 			return true;
 		type_table_addr=lsda_addr+type_table_offset+(pos-start_pos);
 		type_table_pos=pos+type_table_offset;
@@ -1626,11 +1733,11 @@ bool lsda_t<ptrsize>::parse_lsda(
 		type_table_addr_location=0;
 	}
 
-	if(this->read_type(cs_table_encoding, pos, (const uint8_t* const)data.data(), max, is_be))
+	if(this->read_type(cs_table_encoding, pos, data, max, is_be))
 		return true;
 
 	cs_table_start_addr_location = pos + data_addr;
-	if(this->read_uleb128(cs_table_length, pos, (const uint8_t* const)data.data(), max))
+	if(this->read_uleb128(cs_table_length, pos, data, max))
 		return true;
 
 	auto cs_table_end=pos+cs_table_length;
@@ -1641,7 +1748,8 @@ bool lsda_t<ptrsize>::parse_lsda(
 
 	// action table comes immediately after the call site table.
 	action_table_start_addr=cs_table_start_addr+cs_table_length;
-	while(1)
+	// an empty call site table is legal (e.g., a function whose only calls cannot throw).
+	while(pos<cs_table_end)
 	{
 		lsda_call_site_t<ptrsize> lcs;
 		if(lcs.parse_lcs(
@@ -1649,7 +1757,7 @@ bool lsda_t<ptrsize>::parse_lsda(
 			cs_table_start_addr,
 			cs_table_encoding, 
 			pos, 
-			reinterpret_cast<const uint8_t* const>(data.data()), 
+			data, 
 			cs_table_end, data_addr, 
 			landing_pad_base_addr, 
 			max, 
@@ -1661,9 +1769,6 @@ bool lsda_t<ptrsize>::parse_lsda(
 		}
 
 		call_site_table.push_back(lcs);
-		
-		if(pos>=cs_table_end)
-			break;	
 	}
 
 	if(type_table_encoding!=DW_EH_PE_omit)
@@ -1678,7 +1783,7 @@ bool lsda_t<ptrsize>::parse_lsda(
 					// cout<<"Parsing TypeTable at -"<<index<<endl;
 					// 1-based indexing because of odd backwards indexing of type table.
 					lsda_type_table_entry_t <ptrsize> ltte;
-					if(ltte.parse(type_table_encoding, type_table_pos, index, (const uint8_t* const)data.data(), max, data_addr, is_be ))
+					if(ltte.parse(type_table_encoding, type_table_pos, index, data, max, data_addr, is_be ))
 						return true;
 					type_table.resize(std::max((size_t)index,(size_t)type_table.size()));
 					type_table.at(index-1)=ltte;
@@ -1716,32 +1821,32 @@ bool lsda_t<ptrsize>::parse_lsda(
 }
 
 template <int ptrsize>
-void lsda_t<ptrsize>::print() const
+void lsda_t<ptrsize>::print(ostream &out) const
 {
-	cout<<"		LSDA:"<<endl;
-	cout<<"			LP base encoding   : 0x"<<hex<<+landing_pad_base_encoding<<endl;
-	cout<<"			LP base addr	   : 0x"<<hex<<+landing_pad_base_addr<<endl;
-	cout<<"			TypeTable encoding : 0x"<<hex<<+type_table_encoding<<endl;
-	cout<<"			TypeTable offset   : 0x"<<hex<<type_table_offset<<endl;
-	cout<<"			TypeTable addr     : 0x"<<hex<<+type_table_addr<<endl;
-	cout<<"			CS tab encoding    : 0x"<<hex<<+cs_table_encoding<<endl;
-	cout<<"			CS tab addr        : 0x"<<hex<<+cs_table_start_addr<<endl;
-	cout<<"			CS tab offset      : 0x"<<hex<<+cs_table_start_offset<<endl;
-	cout<<"			CS tab length      : 0x"<<hex<<+cs_table_length<<endl;
-	cout<<"			CS tab end addr    : 0x"<<hex<<+cs_table_end_addr<<endl;
-	cout<<"			Act tab start_addr : 0x"<<hex<<+action_table_start_addr<<endl;
-	cout<<"			CS tab :"<<endl;
+	out<<"		LSDA:"<<'\n';
+	out<<"			LP base encoding   : 0x"<<hex<<+landing_pad_base_encoding<<'\n';
+	out<<"			LP base addr	   : 0x"<<hex<<+landing_pad_base_addr<<'\n';
+	out<<"			TypeTable encoding : 0x"<<hex<<+type_table_encoding<<'\n';
+	out<<"			TypeTable offset   : 0x"<<hex<<type_table_offset<<'\n';
+	out<<"			TypeTable addr     : 0x"<<hex<<+type_table_addr<<'\n';
+	out<<"			CS tab encoding    : 0x"<<hex<<+cs_table_encoding<<'\n';
+	out<<"			CS tab addr        : 0x"<<hex<<+cs_table_start_addr<<'\n';
+	out<<"			CS tab offset      : 0x"<<hex<<+cs_table_start_offset<<'\n';
+	out<<"			CS tab length      : 0x"<<hex<<+cs_table_length<<'\n';
+	out<<"			CS tab end addr    : 0x"<<hex<<+cs_table_end_addr<<'\n';
+	out<<"			Act tab start_addr : 0x"<<hex<<+action_table_start_addr<<'\n';
+	out<<"			CS tab :"<<'\n';
 	int i=0;
 	for_each(call_site_table.begin(), call_site_table.end(), [&](const lsda_call_site_t<ptrsize>& p)
 	{
-		cout<<"			[ "<<hex<<i++<<"] call site table entry "<<endl;
-		p.print();
+		out<<"			[ "<<hex<<i++<<"] call site table entry "<<'\n';
+		p.print(out);
 	});
 	i=0;
 	for_each(type_table.begin(), type_table.end(), [&](const lsda_type_table_entry_t<ptrsize>& p)
 	{
-		cout<<"			[ -"<<dec<<++i<<"] Type table entry "<<endl;
-		p.print();
+		out<<"			[ -"<<dec<<++i<<"] Type table entry "<<'\n';
+		p.print(out);
 	});
 }
 
@@ -1754,7 +1859,8 @@ fde_contents_t<ptrsize>::fde_contents_t() :
 	fde_start_addr(0),
 	fde_end_addr(0),
 	fde_range_len(0),
-	lsda_addr(0)
+	lsda_addr(0),
+	memory_usage(nullptr)
 {}
 
 
@@ -1777,61 +1883,65 @@ bool fde_contents_t<ptrsize>::parse_fde(
 	const uint8_t* const data, 
 	const uint64_t max,
 	const uint64_t eh_addr,
-	const ScoopReplacement_t* gcc_except_scoop,
+	const image_section_t &gcc_except_table,
 	const bool is_be
 	)
 {
 	auto &c=*this;
-	const auto eh_frame_scoop_data=data;
 
 	if(cie_info.parse_cie(cie_position, data, max, eh_addr, is_be))
 		return true;
 
-	auto pos=fde_position;
+	// validate the record extent once, all further reads are bounded by the FDE itself.
+	auto cursor=eh_record_cursor_t();
 	auto length=uint64_t(0);
-	if(this->read_length(length, pos, eh_frame_scoop_data, max, is_be))
+	if(eh_record_cursor_t::open_record(cursor, length, fde_position, data, max, is_be))
 		return true;
 
-	auto end_pos=pos+length;
-	if(end_pos > max)
-		return true;
+	// open_record guarantees room for the id.
+	cursor.read_unchecked<uint32_t>();
 
-	auto cie_id=uint32_t(0);
-	if(this->read_type(cie_id, pos, eh_frame_scoop_data, max, is_be))
-		return true;
+	// the start and range are usually fixed-size, so one check covers both.
+	const auto fde_encoding=c.getCIE().getFDEEncoding();
+	const auto fde_pointer_size=encoded_size(fde_encoding, ptrsize);
+	const auto fde_pointers_fit = fde_pointer_size > 0 && cursor.remaining() >= 2*fde_pointer_size;
 
 	auto fde_start_addr=uint64_t(0);
-	auto fde_start_addr_position = pos;
-	if(this->read_type_with_encoding(c.getCIE().getFDEEncoding(),fde_start_addr, pos, eh_frame_scoop_data, max, eh_addr, is_be))
+	auto fde_start_addr_position = cursor.getPosition();
+	if(fde_pointers_fit ? 
+	   this->template read_type_with_encoding<uint64_t, false>(fde_encoding, fde_start_addr, cursor, eh_addr) : 
+	   this->read_type_with_encoding(fde_encoding, fde_start_addr, cursor, eh_addr))
 		return true;
 
 	auto fde_range_len=uint64_t(0);
-	auto fde_end_addr_position = pos;
-	if(this->read_type_with_encoding(c.getCIE().getFDEEncoding() & 0xf /* drop pc-rel bits */,fde_range_len, pos, eh_frame_scoop_data, max, eh_addr, is_be))
+	auto fde_end_addr_position = cursor.getPosition();
+	if(fde_pointers_fit ? 
+	   this->template read_type_with_encoding<uint64_t, false>(fde_encoding & 0xf /* drop pc-rel bits */, fde_range_len, cursor, eh_addr) : 
+	   this->read_type_with_encoding(fde_encoding & 0xf /* drop pc-rel bits */, fde_range_len, cursor, eh_addr))
 		return true;
 
 	auto fde_end_addr=fde_start_addr+fde_range_len;
-	auto fde_end_addr_size = pos - fde_end_addr_position;
+	auto fde_end_addr_size = cursor.getPosition() - fde_end_addr_position;
 	auto augmentation_data_length=uint64_t(0);
 	if(c.getCIE().getAugmentation().find("z") != string::npos)
 	{
-		if(this->read_uleb128(augmentation_data_length, pos, eh_frame_scoop_data, max))
+		if(cursor.read_uleb128(augmentation_data_length))
 			return true;
 	}
 	auto lsda_addr=uint64_t(0);
-	auto fde_lsda_addr_position = pos;
+	auto fde_lsda_addr_position = cursor.getPosition();
 	auto fde_lsda_addr_size = uint64_t(0);
 	if(c.getCIE().getLSDAEncoding()!= DW_EH_PE_omit)
 	{
-		if(this->read_type_with_encoding(c.getCIE().getLSDAEncoding(), lsda_addr, pos, eh_frame_scoop_data, max, eh_addr, is_be))
+		if(this->read_type_with_encoding(c.getCIE().getLSDAEncoding(), lsda_addr, cursor, eh_addr))
 			return true;
-		fde_lsda_addr_size = pos - fde_lsda_addr_position;
+		fde_lsda_addr_size = cursor.getPosition() - fde_lsda_addr_position;
 		if(lsda_addr!=0)
-			if(c.lsda.parse_lsda(lsda_addr,gcc_except_scoop, fde_start_addr, is_be))
+			if(c.lsda.parse_lsda(lsda_addr, gcc_except_table, fde_start_addr, is_be))
 				return true;
 	}
 
-	if(c.eh_pgm.parse_program(pos, eh_frame_scoop_data, end_pos, is_be))
+	if(c.eh_pgm.parse_program(cursor, fde_encoding, eh_addr))
 		return true;
 
 	c.fde_position = fde_position + eh_addr;
@@ -1852,22 +1962,73 @@ bool fde_contents_t<ptrsize>::parse_fde(
 }
 
 template <int ptrsize>
-void fde_contents_t<ptrsize>::print() const
+void fde_contents_t<ptrsize>::build_caches() const
+{
+	cie_info.build_caches();
+	eh_pgm.build_caches();
+	lsda.build_caches();
+}
+
+template <int ptrsize>
+const CFATable_t* fde_contents_t<ptrsize>::getCFATable() const
+{
+	// racing threads may each evaluate the table, but only the first one stored is kept and returned.
+	auto table=atomic_load(&cfa_table);
+	if(!table)
+	{
+		auto new_table=make_shared<cfa_table_t>();
+		new_table->evaluate(
+			*cie_info.getProgram().getInstructions(), 
+			*eh_pgm.getInstructions(), 
+			cie_info.getCAF(), 
+			cie_info.getDAF(), 
+			fde_start_addr, 
+			fde_end_addr);
+		if(atomic_compare_exchange_strong(&cfa_table, &table, new_table))
+		{
+			table=new_table;
+			if(memory_usage!=nullptr)
+				*memory_usage+=sizeof(cfa_table_t)+table->getMemoryUsage();
+		}
+	}
+	return table.get();
+}
+
+template <int ptrsize>
+const EHPFrameSummary_t& fde_contents_t<ptrsize>::getFrameSummary() const
+{
+	auto summary=atomic_load(&frame_summary);
+	if(!summary)
+	{
+		auto new_summary=make_shared<EHPFrameSummary_t>();
+		summarize_frame(*this, *new_summary);
+		if(atomic_compare_exchange_strong(&frame_summary, &summary, new_summary))
+		{
+			summary=new_summary;
+			if(memory_usage!=nullptr)
+				*memory_usage+=sizeof(EHPFrameSummary_t)+vector_bytes(summary->saved_registers);
+		}
+	}
+	return *summary;
+}
+
+template <int ptrsize>
+void fde_contents_t<ptrsize>::print(ostream &out) const
 {
 	const auto caf=cie_info.getCAF();
 
-	cout << "["<<setw(6)<<hex<<fde_position<<"] FDE length="<<dec<<length;
-	cout <<" cie=["<<setw(6)<<hex<<cie_position<<"]"<<endl;
-	cout<<"		FDE len addr:		"<<dec<<length<<endl;
-	cout<<"		FDE Start addr:		"<<hex<<fde_start_addr<<endl;
-	cout<<"		FDE End addr:		"<<hex<<fde_end_addr<<endl;
-	cout<<"		FDE len:		"<<dec<<fde_range_len<<endl;
-	cout<<"		FDE LSDA:		"<<hex<<lsda_addr<<endl;
-	eh_pgm.print(fde_start_addr, caf);
+	out << "["<<setw(6)<<hex<<fde_position<<"] FDE length="<<dec<<length;
+	out <<" cie=["<<setw(6)<<hex<<cie_position<<"]"<<'\n';
+	out<<"		FDE len addr:		"<<dec<<length<<'\n';
+	out<<"		FDE Start addr:		"<<hex<<fde_start_addr<<'\n';
+	out<<"		FDE End addr:		"<<hex<<fde_end_addr<<'\n';
+	out<<"		FDE len:		"<<dec<<fde_range_len<<'\n';
+	out<<"		FDE LSDA:		"<<hex<<lsda_addr<<'\n';
+	eh_pgm.print(out, fde_start_addr, caf);
 	if(getCIE().getLSDAEncoding()!= DW_EH_PE_omit && lsda_addr!=0 /* indicator of nullptr for lsda */)
-		lsda.print();
+		lsda.print(out);
 	else
-		cout<<"		No LSDA for this FDE."<<endl;
+		out<<"		No LSDA for this FDE."<<'\n';
 }
 
 
@@ -1875,6 +2036,15 @@ void fde_contents_t<ptrsize>::print() const
 
 
 
+template <int ptrsize>
+bool split_eh_frame_impl_t<ptrsize>::record_parse_error(const EHPParseErrorKind_t kind, const uint64_t position, const uint64_t length)
+{
+	parse_errors.push_back({position, length, kind});
+
+	// strict mode stops at the first error, lenient mode moves on to the next record.
+	return parse_mode==PARSE_STRICT;
+}
+
 template <int ptrsize>
 bool split_eh_frame_impl_t<ptrsize>::iterate_fdes(const bool is_be)
 {
@@ -1884,6 +2054,7 @@ bool split_eh_frame_impl_t<ptrsize>::iterate_fdes(const bool is_be)
 	auto eh_addr= eh_frame_scoop->getStart();
 	auto max=eh_frame_scoop->getContents().size();
 	auto position=uint64_t(0);
+	const auto gcc_except_table=scoop_section(*gcc_except_table_scoop);
 
 	//cout << "----------------------------------------"<<endl;
 	while(1)
@@ -1899,7 +2070,15 @@ bool split_eh_frame_impl_t<ptrsize>::iterate_fdes(const bool is_be)
 		if(act_length==0 || act_length==0xffffffff || act_length == decltype(act_length)(-1))
 			break;
 
+		// a record that runs off the end of the section (or can't hold a CIE id)
+		// leaves us no way to find the next record.
 		auto next_position=position + act_length;
+		if(next_position > max || next_position < position || act_length < sizeof(uint32_t))
+		{
+			record_parse_error(PARSE_ERROR_LENGTH, old_position+eh_addr, act_length);
+			return true;
+		}
+
 		auto cie_offset=uint32_t(0);
 		auto cie_offset_position=position;
 
@@ -1907,34 +2086,38 @@ bool split_eh_frame_impl_t<ptrsize>::iterate_fdes(const bool is_be)
 			break;
 
 		//cout << " [ " << setw(6) << hex << old_position << "] " ;
-		if(act_length==0)
-		{
-			//cout << "Zero terminator " << endl;
-			break;
-		}
-		else if(cie_offset==0)
+		if(cie_offset==0)
 		{
 			//cout << "CIE length="<< dec << act_length << endl;
 			cie_contents_t<ptrsize> c;
 			if(c.parse_cie(old_position, data, max, eh_addr, is_be))
-				return true;
-			cies.push_back(c);
+			{
+				if(record_parse_error(PARSE_ERROR_CIE, old_position+eh_addr, act_length))
+					return true;
+			}
+			else
+				cies.push_back(c);
 		}
 		else
 		{
 			fde_contents_t<ptrsize> f;
 			auto cie_position = cie_offset_position - cie_offset;
 			//cout << "FDE length="<< dec << act_length << " cie=[" << setw(6) << hex << cie_position << "]" << endl;
-			if(f.parse_fde(old_position, cie_position, data, max, eh_addr, gcc_except_table_scoop.get(), is_be))
-				return true;
-			//const auto old_fde_size=fdes.size();
-			fdes.insert(f);
-		}
-		//cout << "----------------------------------------"<<endl;
+			if(cie_offset > cie_offset_position || f.parse_fde(old_position, cie_position, data, max, eh_addr, gcc_except_table, is_be))
+			{
+				if(record_parse_error(PARSE_ERROR_FDE, old_position+eh_addr, act_length))
+					return true;
+			}
+			else
+			{
+				f.setMemoryAccount(&memory_usage);
+				fdes.insert(f);
+			}
+		}
+		//cout << "----------------------------------------"<<endl;
 		
 
 		// next CIE/FDE
-		throw_assert(position<=next_position); 	// so we don't accidentally over-read a CIE/FDE
 		position=next_position;
 	}
 	return false;
@@ -1947,25 +2130,28 @@ bool split_eh_frame_impl_t<ptrsize>::parse(const bool is_be)
 	if(eh_frame_scoop==NULL)
 		return true; // no frame info in this binary
 
-
-	if(iterate_fdes(is_be))
-		return true;
-
-	return false;
-}
-
-
-template <int ptrsize>
-void split_eh_frame_impl_t<ptrsize>::print() const
-{
-	for_each(cies.begin(), cies.end(), [&](const cie_contents_t<ptrsize>  &p)
-	{
-		p.print(0 /* cie has no start address on its own */);
-	});
-	for_each(fdes.begin(), fdes.end(), [&](const fde_contents_t<ptrsize>  &p)
-	{
-		p.print();
-	});
+	data_is_be=is_be;
+
+	// the factory hands the parser out even if parsing stopped early, with the records read 
+	// before the error.  it may be shared between threads once it is returned, so fill every 
+	// pointer cache here rather than on first use, whether or not parsing finished.
+	const auto failed=iterate_fdes(is_be);
+	for(const auto &c : cies)
+		c.build_caches();
+	transform(ALLOF(cies), back_inserter(cies_cache), [](const cie_contents_t<ptrsize> &a) { return &a; });
+	for(const auto &f : fdes)
+		f.build_caches();
+	transform(ALLOF(fdes), back_inserter(fdes_cache), [](const fde_contents_t<ptrsize> &a) { return &a; });
+
+	auto bytes=string_bytes(eh_frame_scoop->getContents())+string_bytes(eh_frame_hdr_scoop->getContents())+string_bytes(gcc_except_table_scoop->getContents());
+	bytes+=vector_bytes(cies)+vector_bytes(cies_cache)+set_bytes(fdes)+vector_bytes(fdes_cache)+vector_bytes(parse_errors);
+	for(const auto &c : cies)
+		bytes+=c.getMemoryUsage();
+	for(const auto &f : fdes)
+		bytes+=f.getMemoryUsage();
+	memory_usage+=bytes;
+
+	return failed;
 }
 
 
@@ -1979,6 +2165,22 @@ const EHProgramInstructionVector_t* eh_program_t<ptrsize>::getInstructions() con
 	return &instructions_cache;
 }
 
+template <int ptrsize>
+uint64_t eh_program_t<ptrsize>::getMemoryUsage() const
+{
+	auto bytes=vector_bytes(instructions)+vector_bytes(instructions_cache);
+	for(const auto &insn : instructions)
+		bytes+=insn.getMemoryUsage();
+	return bytes;
+}
+
+template <int ptrsize>
+void eh_program_t<ptrsize>::build_caches() const
+{
+	instructions_cache.clear();
+	transform(ALLOF(instructions), back_inserter(instructions_cache), [](const eh_program_insn_t<ptrsize> &a) { return &a;});
+}
+
 template <int ptrsize>
 const TypeTableVector_t* lsda_t<ptrsize>::getTypeTable() const 
 {
@@ -2000,24 +2202,36 @@ const CallSiteVector_t* lsda_t<ptrsize>::getCallSites() const
 	return &call_site_table_cache;
 }
 
+template <int ptrsize>
+uint64_t lsda_t<ptrsize>::getMemoryUsage() const
+{
+	auto bytes=vector_bytes(call_site_table)+vector_bytes(call_site_table_cache)+vector_bytes(type_table)+vector_bytes(type_table_cache);
+	for(const auto &cs : call_site_table)
+		bytes+=cs.getMemoryUsage();
+	return bytes;
+}
+
+template <int ptrsize>
+void lsda_t<ptrsize>::build_caches() const
+{
+	call_site_table_cache.clear();
+	transform(ALLOF(call_site_table), back_inserter(call_site_table_cache), [](const lsda_call_site_t<ptrsize> &a) { return &a;});
+	for(const auto &cs : call_site_table)
+		cs.build_caches();
+	type_table_cache.clear();
+	transform(ALLOF(type_table), back_inserter(type_table_cache), [](const lsda_type_table_entry_t<ptrsize> &a) { return &a; });
+}
+
 
 template <int ptrsize>
 const FDEVector_t*  split_eh_frame_impl_t<ptrsize>::getFDEs() const
 {
-	if(fdes_cache.size()==0)
-	{
-		transform(ALLOF(fdes), back_inserter(fdes_cache), [](const fde_contents_t<ptrsize> &a) { return &a; });
-	}
 	return &fdes_cache;
 }
 
 template <int ptrsize>
 const CIEVector_t*  split_eh_frame_impl_t<ptrsize>::getCIEs() const
 {
-	if(cies_cache.size()==0)
-	{
-		transform(ALLOF(cies), back_inserter(cies_cache), [](const cie_contents_t<ptrsize> &a) { return &a; });
-	}
 	return &cies_cache;
 }
 
@@ -2031,8 +2245,758 @@ const FDEContents_t* split_eh_frame_impl_t<ptrsize>::findFDE(uint64_t addr) cons
 	return raw_ret_ptr;
 }
 
+const EHPUnwindTable_t* eh_frame_tables_t::getUnwindTable() const
+{
+	call_once(unwind_table_once, [&]() 
+		{ 
+			build_unwind_table(*getFDEs(), unwind_table_cache); 
+			memory_usage+=vector_bytes(unwind_table_cache);
+		});
+	return &unwind_table_cache;
+}
+
+const EHPUnwindEntry_t* eh_frame_tables_t::findUnwindEntry(uint64_t addr) const
+{
+	return find_unwind_entry(*getUnwindTable(), addr);
+}
+
+const EHPCFAOffsetTable_t* eh_frame_tables_t::getCFAOffsetTable() const
+{
+	call_once(cfa_offset_table_once, [&]() 
+		{ 
+			build_cfa_offset_table(*getFDEs(), cfa_offset_table_cache); 
+			memory_usage+=vector_bytes(cfa_offset_table_cache);
+		});
+	return &cfa_offset_table_cache;
+}
+
+void eh_frame_tables_t::computeFrameSummaries() const
+{
+	// each FDE caches its own summary, so chunks touch disjoint state.
+	const auto &fde_ptrs=*getFDEs();
+	parallel_for_chunks(fde_ptrs.size(), parallel_chunk_count(fde_ptrs.size()), 
+		[&](const size_t, const size_t begin, const size_t end)
+		{
+			for(auto i=begin; i < end; i++)
+				fde_ptrs[i]->getFrameSummary();
+		});
+}
+
+const EHPCallSiteIndex_t* eh_frame_tables_t::getCallSiteIndex() const
+{
+	call_once(call_site_index_once, [&]() 
+		{ 
+			build_call_site_index(*getFDEs(), call_site_index_cache); 
+			memory_usage+=table_bytes(call_site_index_cache);
+		});
+	return &call_site_index_cache.entries;
+}
+
+const EHPCallSiteIndexEntry_t* eh_frame_tables_t::findCallSite(uint64_t pc) const
+{
+	getCallSiteIndex();
+	return find_call_site(call_site_index_cache, pc);
+}
+
+void eh_frame_tables_t::findCallSites(const vector<uint64_t>& pcs, EHPCallSiteLookupVector_t& results) const
+{
+	getCallSiteIndex();
+	find_call_sites(call_site_index_cache, pcs, results);
+}
+
+const EHPExceptionGraph_t* eh_frame_tables_t::getExceptionGraph() const
+{
+	call_once(exception_graph_once, [&]() 
+		{ 
+			build_exception_graph(*getCallSiteIndex(), exception_graph_cache); 
+			memory_usage+=table_bytes(exception_graph_cache);
+		});
+	return &exception_graph_cache;
+}
+
+const EHPCatchIndex_t* eh_frame_tables_t::getCatchIndex() const
+{
+	call_once(catch_index_once, [&]() 
+		{ 
+			build_catch_index(*getCallSiteIndex(), catch_index_cache); 
+			memory_usage+=table_bytes(catch_index_cache);
+		});
+	return &catch_index_cache;
+}
+
+const EHPCatchSiteVector_t* eh_frame_tables_t::findCatchSites(uint64_t type_info_pointer) const
+{
+	const auto &catches=*getCatchIndex();
+	const auto it=catches.find(type_info_pointer);
+	return it==catches.end() ? nullptr : &it->second;
+}
+
+const fde_index_t& eh_frame_tables_t::getFDEIndex() const
+{
+	call_once(fde_index_once, [&]() 
+		{ 
+			build_fde_index(*getFDEs(), fde_index_cache); 
+			memory_usage+=table_bytes(fde_index_cache);
+		});
+	return fde_index_cache;
+}
+
+const FDEContents_t* eh_frame_tables_t::findFDEByPosition(uint64_t position) const
+{
+	return find_fde_by_position(getFDEIndex(), position);
+}
+
+const FDEVector_t* eh_frame_tables_t::findFDEsByLSDA(uint64_t lsda_addr) const
+{
+	return find_fde_list(getFDEIndex().by_lsda, lsda_addr);
+}
+
+const FDEVector_t* eh_frame_tables_t::findFDEsByPersonality(uint64_t personality) const
+{
+	return find_fde_list(getFDEIndex().by_personality, personality);
+}
+
+void eh_frame_tables_t::getCoverageGaps(const EHPAddressRangeVector_t& ranges, EHPAddressRangeVector_t& gaps) const
+{
+	find_coverage_gaps(*getFDEs(), ranges, gaps);
+}
+
+void eh_frame_tables_t::getCoverageMap(const EHPAddressRangeVector_t& ranges, EHPCoverageMap_t& map) const
+{
+	build_coverage_map(*getFDEs(), ranges, map);
+}
+
+const EHPSymbolJoin_t* eh_frame_tables_t::getSymbolJoin() const
+{
+	call_once(symbol_join_once, [&]() 
+		{ 
+			join_symbols(*getFDEs(), *getSymbols(), symbol_join_cache); 
+			memory_usage+=table_bytes(symbol_join_cache);
+		});
+	return &symbol_join_cache;
+}
+
+void eh_frame_tables_t::joinSymbols(const EHPSymbolVector_t& p_symbols, EHPSymbolJoin_t& join) const
+{
+	join_symbols(*getFDEs(), p_symbols, join);
+}
+
+bool eh_frame_tables_t::writeImage(const string &filename, const string &key) const
+{
+	return withImageContents([&](const image_contents_t &contents) { return write_image(filename, key, contents); });
+}
+
+void eh_frame_tables_t::writeJSON(OutputSink_t &sink, EHPJSONFormat_t format) const
+{
+	write_json(*this, sink, format);
+}
+
+void eh_frame_tables_t::getFacts(EHPFacts_t &facts) const
+{
+	build_facts(*this, facts);
+}
+
+bool eh_frame_tables_t::writeFacts(const string &directory) const
+{
+	auto facts=EHPFacts_t();
+	build_facts(*this, facts);
+	return write_facts(facts, directory);
+}
+
+void eh_frame_tables_t::getModel(EHPSectionModel_t &model) const
+{
+	withImageContents([&](const image_contents_t &contents) 
+		{ 
+			build_model(*this, contents, model); 
+			return false; 
+		});
+}
+
+void eh_frame_tables_t::getSearchTable(EHPSearchTable_t &table) const
+{
+	build_search_table(*getFDEs(), table);
+}
+
+void eh_frame_tables_t::checkSearchTable(const EHPSearchTable_t &table, EHPSearchTableIssueVector_t &issues) const
+{
+	check_search_table(*getFDEs(), table, issues);
+}
+
+bool eh_frame_tables_t::patchAddresses(const EHPAddressMap_t &map, string &eh_frame_data, string &gcc_except_table_data, EHPPatchErrorVector_t &errors) const
+{
+	return withImageContents([&](const image_contents_t &contents) 
+		{ 
+			return patch_addresses(*this, contents, map, eh_frame_data, gcc_except_table_data, errors); 
+		});
+}
+
+template <int ptrsize>
+static bool remove_nops(const bool is_be, const uint8_t address_encoding, EHProgramInstructionByteVector_t &program, bool &sets_location)
+{
+	// only the operands' sizes matter here, not where they are.
+	auto cursor=eh_record_cursor_t(program.data(), 0, program.size(), is_be);
+	auto decoded=eh_program_t<ptrsize>();
+	if(decoded.parse_program(cursor, address_encoding, 0))
+		return true;
+	auto kept=EHProgramInstructionByteVector_t();
+	sets_location=false;
+	for(const auto &insn : decoded.getInstructionsInternal())
+	{
+		if(insn.isNop())
+			continue;
+		const auto &bytes=insn.getBytes();
+		if(bytes[0]==DW_CFA_set_loc)
+			sets_location=true;
+		kept.insert(kept.end(), bytes.begin(), bytes.end());
+	}
+	program.swap(kept);
+	return false;
+}
+
+bool EHP::remove_cfa_nops(const uint8_t ptrsize, const bool is_be, const uint8_t address_encoding, EHProgramInstructionByteVector_t &program, bool &sets_location)
+{
+	if(ptrsize==4)
+		return remove_nops<4>(is_be, address_encoding, program, sets_location);
+	else if(ptrsize==8)
+		return remove_nops<8>(is_be, address_encoding, program, sets_location);
+	else
+		throw out_of_range("ptrsize must be 4 or 8");
+}
+
+void eh_frame_tables_t::print() const
+{
+	const auto out=OutputSink_t::factory(cout);
+	print(*out);
+}
+
+void eh_frame_tables_t::print(OutputSink_t &out) const
+{
+	for(const auto c : *getCIEs())
+		c->print(out, 0 /* cie has no start address on its own */);
+
+	// an FDE's text depends only on that FDE, so chunks are formatted concurrently and 
+	// written in order.  the first chunk runs on this thread and writes straight to out, 
+	// the rest go to their own strings.  a window at a time bounds the text held.
+	const auto &fdes=*getFDEs();
+	const auto window=size_t(1<<14);
+	for(auto window_begin=size_t(0); window_begin < fdes.size(); window_begin+=window)
+	{
+		const auto count=min(window, fdes.size()-window_begin);
+		const auto chunks=parallel_chunk_count(count, 64);
+		auto text=vector<string>(chunks);
+		parallel_for_chunks(count, chunks, [&](const size_t chunk, const size_t begin, const size_t end)
+			{
+				string_sink_t chunk_text(text[chunk]);
+				auto &chunk_out = chunk==0 ? out : static_cast<OutputSink_t&>(chunk_text);
+				for(auto i=window_begin+begin; i < window_begin+end; i++)
+					fdes[i]->print(chunk_out);
+			});
+		for(auto chunk=size_t(1); chunk < chunks; chunk++)
+			out.write(text[chunk].data(), text[chunk].size());
+	}
+	out.flush();
+}
+
+int eh_frame_tables_t::publishImage(const string &key) const
+{
+	auto fd=-1;
+	withImageContents([&](const image_contents_t &contents) 
+		{ 
+			fd=publish_image(key, contents); 
+			return fd < 0;
+		});
+	return fd;
+}
+
+template <int ptrsize>
+void eh_program_insn_t<ptrsize>::restore(const image_section_t &eh_frame, const uint64_t position, const uint64_t size, const bool p_is_be, const uint8_t p_address_encoding)
+{
+	program_bytes.assign(eh_frame.data+position, eh_frame.data+position+size);
+	is_be=p_is_be;
+	// as in parse_insn, only set_loc's operand has an encoding and address.
+	if(program_bytes[0]==DW_CFA_set_loc)
+	{
+		address_encoding = p_address_encoding==DW_EH_PE_omit ? uint8_t(DW_EH_PE_absptr) : p_address_encoding;
+		operand_addr=eh_frame.addr+position+1;
+	}
+}
+
+template <int ptrsize>
+void eh_program_t<ptrsize>::describe(image_program_t &record, image_records_t &records) const
+{
+	record.position=position;
+	record.size=0;
+	record.first_insn=records.insn_sizes.size();
+	record.insn_count=instructions.size();
+	for(const auto &insn : instructions)
+	{
+		records.insn_sizes.push_back(static_cast<uint32_t>(insn.getSize()));
+		record.size+=insn.getSize();
+	}
+}
+
+template <int ptrsize>
+void eh_program_t<ptrsize>::restore(const image_program_t &record, const image_contents_t &contents, const uint8_t address_encoding)
+{
+	position=record.position;
+	instructions.assign(record.insn_count, eh_program_insn_t<ptrsize>());
+	auto insn_position=record.position;
+	for(auto i=uint64_t(0); i < record.insn_count; i++)
+	{
+		const auto size=contents.insn_sizes[record.first_insn+i];
+		instructions[i].restore(contents.eh_frame, insn_position, size, contents.is_be, address_encoding);
+		insn_position+=size;
+	}
+}
+
+template <int ptrsize>
+void cie_contents_t<ptrsize>::describe(image_cie_t &record, image_records_t &records) const
+{
+	record=image_cie_t();
+	record.position=cie_position;
+	record.length=length;
+	record.code_alignment_factor=code_alignment_factor;
+	record.data_alignment_factor=data_alignment_factor;
+	record.return_address_register_column=return_address_register_column;
+	record.augmentation_data_length=augmentation_data_length;
+	record.personality=personality;
+	record.personality_pointer_position=personality_pointer_position;
+	record.personality_pointer_size=personality_pointer_size;
+	record.augmentation_offset=records.augmentations.size();
+	record.augmentation_length=augmentation.size();
+	records.augmentations+=augmentation;
+	eh_pgm.describe(record.program, records);
+	record.cie_id=cie_id;
+	record.version=cie_version;
+	record.personality_encoding=personality_encoding;
+	record.lsda_encoding=lsda_encoding;
+	record.fde_encoding=fde_encoding;
+}
+
+template <int ptrsize>
+void cie_contents_t<ptrsize>::restore(const image_cie_t &record, const image_contents_t &contents)
+{
+	cie_position=record.position;
+	length=record.length;
+	cie_id=record.cie_id;
+	cie_version=record.version;
+	augmentation.assign(contents.augmentations+record.augmentation_offset, record.augmentation_length);
+	code_alignment_factor=record.code_alignment_factor;
+	data_alignment_factor=record.data_alignment_factor;
+	return_address_register_column=record.return_address_register_column;
+	augmentation_data_length=record.augmentation_data_length;
+	personality_encoding=record.personality_encoding;
+	personality=record.personality;
+	personality_pointer_position=record.personality_pointer_position;
+	personality_pointer_size=record.personality_pointer_size;
+	lsda_encoding=record.lsda_encoding;
+	fde_encoding=record.fde_encoding;
+	eh_pgm.restore(record.program, contents, fde_encoding);
+}
+
+template <int ptrsize>
+void lsda_type_table_entry_t<ptrsize>::describe(image_type_entry_t &record) const
+{
+	record.pointer_to_typeinfo=pointer_to_typeinfo;
+	record.encoding=tt_encoding;
+	record.encoding_size=tt_encoding_size;
+}
+
+template <int ptrsize>
+void lsda_type_table_entry_t<ptrsize>::restore(const image_type_entry_t &record)
+{
+	pointer_to_typeinfo=record.pointer_to_typeinfo;
+	tt_encoding=record.encoding;
+	tt_encoding_size=record.encoding_size;
+}
+
+template <int ptrsize>
+void lsda_call_site_t<ptrsize>::describe(image_call_site_t &record, image_records_t &records) const
+{
+	record.call_site_offset=call_site_offset;
+	record.call_site_addr=call_site_addr;
+	record.call_site_addr_position=call_site_addr_position;
+	record.call_site_length=call_site_length;
+	record.call_site_end_addr=call_site_end_addr;
+	record.call_site_end_addr_position=call_site_end_addr_position;
+	record.landing_pad_offset=landing_pad_offset;
+	record.landing_pad_addr=landing_pad_addr;
+	record.landing_pad_addr_position=landing_pad_addr_position;
+	record.landing_pad_addr_end_position=landing_pad_addr_end_position;
+	record.action=action;
+	record.action_table_offset=action_table_offset;
+	record.action_table_addr=action_table_addr;
+	record.first_action=records.actions.size();
+	record.action_count=action_table.size();
+	for(const auto &a : action_table)
+		records.actions.push_back(a.getAction());
+}
+
+template <int ptrsize>
+void lsda_call_site_t<ptrsize>::restore(const image_call_site_t &record, const image_contents_t &contents)
+{
+	call_site_offset=record.call_site_offset;
+	call_site_addr=record.call_site_addr;
+	call_site_addr_position=record.call_site_addr_position;
+	call_site_length=record.call_site_length;
+	call_site_end_addr=record.call_site_end_addr;
+	call_site_end_addr_position=record.call_site_end_addr_position;
+	landing_pad_offset=record.landing_pad_offset;
+	landing_pad_addr=record.landing_pad_addr;
+	landing_pad_addr_position=record.landing_pad_addr_position;
+	landing_pad_addr_end_position=record.landing_pad_addr_end_position;
+	action=record.action;
+	action_table_offset=record.action_table_offset;
+	action_table_addr=record.action_table_addr;
+	action_table.assign(record.action_count, lsda_call_site_action_t<ptrsize>());
+	for(auto i=uint64_t(0); i < record.action_count; i++)
+		action_table[i].restore(contents.actions[record.first_action+i]);
+}
+
+template <int ptrsize>
+void lsda_t<ptrsize>::describe(image_lsda_t &record, image_records_t &records) const
+{
+	record=image_lsda_t();
+	record.landing_pad_base_addr=landing_pad_base_addr;
+	record.type_table_offset=type_table_offset;
+	record.type_table_addr=type_table_addr;
+	record.type_table_addr_location=type_table_addr_location;
+	record.cs_table_start_offset=cs_table_start_offset;
+	record.cs_table_start_addr=cs_table_start_addr;
+	record.cs_table_start_addr_location=cs_table_start_addr_location;
+	record.cs_table_length=cs_table_length;
+	record.cs_table_end_addr=cs_table_end_addr;
+	record.action_table_start_addr=action_table_start_addr;
+	record.landing_pad_base_encoding=landing_pad_base_encoding;
+	record.type_table_encoding=type_table_encoding;
+	record.cs_table_encoding=cs_table_encoding;
+
+	// the call sites only add actions, so theirs stay contiguous.
+	record.first_call_site=records.call_sites.size();
+	record.call_site_count=call_site_table.size();
+	for(const auto &cs : call_site_table)
+	{
+		auto cs_record=image_call_site_t();
+		cs.describe(cs_record, records);
+		records.call_sites.push_back(cs_record);
+	}
+	record.first_type_entry=records.type_entries.size();
+	record.type_entry_count=type_table.size();
+	for(const auto &entry : type_table)
+	{
+		auto entry_record=image_type_entry_t();
+		entry.describe(entry_record);
+		records.type_entries.push_back(entry_record);
+	}
+}
+
+template <int ptrsize>
+void lsda_t<ptrsize>::restore(const image_lsda_t &record, const image_contents_t &contents)
+{
+	landing_pad_base_encoding=record.landing_pad_base_encoding;
+	landing_pad_base_addr=record.landing_pad_base_addr;
+	type_table_encoding=record.type_table_encoding;
+	type_table_offset=record.type_table_offset;
+	type_table_addr=record.type_table_addr;
+	type_table_addr_location=record.type_table_addr_location;
+	cs_table_encoding=record.cs_table_encoding;
+	cs_table_start_offset=record.cs_table_start_offset;
+	cs_table_start_addr=record.cs_table_start_addr;
+	cs_table_start_addr_location=record.cs_table_start_addr_location;
+	cs_table_length=record.cs_table_length;
+	cs_table_end_addr=record.cs_table_end_addr;
+	action_table_start_addr=record.action_table_start_addr;
+	call_site_table.assign(record.call_site_count, lsda_call_site_t<ptrsize>());
+	for(auto i=uint64_t(0); i < record.call_site_count; i++)
+		call_site_table[i].restore(contents.call_sites[record.first_call_site+i], contents);
+	type_table.assign(record.type_entry_count, lsda_type_table_entry_t<ptrsize>());
+	for(auto i=uint64_t(0); i < record.type_entry_count; i++)
+		type_table[i].restore(contents.type_entries[record.first_type_entry+i]);
+}
+
+template <int ptrsize>
+void fde_contents_t<ptrsize>::describe(image_fde_t &record, image_records_t &records) const
+{
+	record=image_fde_t();
+	record.position=fde_position;
+	record.cie_offset=cie_position;
+	record.length=length;
+	record.start_addr=fde_start_addr;
+	record.end_addr=fde_end_addr;
+	record.lsda_addr=lsda_addr;
+	record.start_addr_position=fde_start_addr_position;
+	record.end_addr_position=fde_end_addr_position;
+	record.end_addr_size=fde_end_addr_size;
+	record.lsda_addr_position=fde_lsda_addr_position;
+	record.lsda_addr_size=fde_lsda_addr_size;
+	record.lsda=image_no_lsda;
+	// without an LSDA address, the LSDA was never parsed and is left empty.
+	if(lsda_addr!=0)
+	{
+		auto lsda_record=image_lsda_t();
+		lsda.describe(lsda_record, records);
+		record.lsda=records.lsdas.size();
+		records.lsdas.push_back(lsda_record);
+	}
+	eh_pgm.describe(record.program, records);
+}
+
+template <int ptrsize>
+void fde_contents_t<ptrsize>::restore(const image_fde_t &record, const image_contents_t &contents)
+{
+	fde_position=record.position;
+	cie_position=record.cie_offset;
+	length=record.length;
+	fde_start_addr=record.start_addr;
+	fde_end_addr=record.end_addr;
+	fde_range_len=record.end_addr-record.start_addr;
+	lsda_addr=record.lsda_addr;
+	fde_start_addr_position=record.start_addr_position;
+	fde_end_addr_position=record.end_addr_position;
+	fde_end_addr_size=record.end_addr_size;
+	fde_lsda_addr_position=record.lsda_addr_position;
+	fde_lsda_addr_size=record.lsda_addr_size;
+	cie_info.restore(contents.cies[record.cie], contents);
+	eh_pgm.restore(record.program, contents, cie_info.getFDEEncoding());
+	if(record.lsda!=image_no_lsda)
+		lsda.restore(contents.lsdas[record.lsda], contents);
+}
+
+template <int ptrsize>
+bool split_eh_frame_impl_t<ptrsize>::withImageContents(const function<bool(const image_contents_t&)> &use) const
+{
+	auto records=image_records_t();
+	auto cie_indexes=map<uint64_t, uint64_t>();
+	const auto add_cie=[&](const cie_contents_t<ptrsize> &c, const bool listed) -> uint64_t
+	{
+		auto record=image_cie_t();
+		c.describe(record, records);
+		record.listed=listed ? 1 : 0;
+		cie_indexes[c.getPosition()]=records.cies.size();
+		records.cies.push_back(record);
+		return records.cies.size()-1;
+	};
+	for(const auto &c : cies)
+		add_cie(c, true);
+	records.fdes.reserve(fdes.size());
+	for(const auto &f : fdes)
+	{
+		// an FDE can point at a CIE the walk over the section never reached.
+		const auto cie=cie_indexes.find(f.getCIE().getPosition());
+		auto record=image_fde_t();
+		f.describe(record, records);
+		record.cie = cie==cie_indexes.end() ? add_cie(f.getCIE(), false) : cie->second;
+		records.fdes.push_back(record);
+	}
+
+	auto contents=image_contents_t();
+	contents.ptrsize=ptrsize;
+	contents.is_be=data_is_be;
+	contents.eh_frame=scoop_section(*eh_frame_scoop);
+	contents.eh_frame_hdr=scoop_section(*eh_frame_hdr_scoop);
+	contents.gcc_except_table=scoop_section(*gcc_except_table_scoop);
+	records.describe(contents);
+	contents.parse_errors=&parse_errors;
+	contents.executable_ranges=&executable_ranges;
+	contents.symbols=&symbols;
+	return use(contents);
+}
+
+template <int ptrsize>
+const fde_contents_t<ptrsize>& image_fde_proxy_t<ptrsize>::getContents() const
+{
+	call_once(contents_once, [&]() { contents=owner->restoreFDE(*record); });
+	return *contents;
+}
+
+template <int ptrsize>
+image_eh_frame_impl_t<ptrsize>::image_eh_frame_impl_t(unique_ptr<mapped_image_t> p_image)
+	:
+	eh_frame_tables_t(EHPAddressRangeVector_t(), EHPSymbolVector_t()),
+	image(move(p_image)),
+	contents()
+{
+	image->getContents(contents);
+	const auto count=contents.fde_count;
+	fde_proxies.reset(new image_fde_proxy_t<ptrsize>[count]);
+	fdes.reserve(count);
+	for(auto i=uint64_t(0); i < count; i++)
+	{
+		fde_proxies[i].init(&contents.fdes[i], this);
+		fdes.push_back(&fde_proxies[i]);
+	}
+
+	const auto errors=image->getRecords<image_parse_error_t>(IMAGE_PARSE_ERRORS);
+	for(auto i=uint64_t(0); i < image->getRecordCount<image_parse_error_t>(IMAGE_PARSE_ERRORS); i++)
+		parse_errors.push_back({errors[i].position, errors[i].length, static_cast<EHPParseErrorKind_t>(errors[i].kind)});
+
+	const auto ranges=image->getRecords<EHPAddressRange_t>(IMAGE_EXECUTABLE_RANGES);
+	executable_ranges.assign(ranges, ranges+image->getRecordCount<EHPAddressRange_t>(IMAGE_EXECUTABLE_RANGES));
+
+	// the mapping counts in full, though pages nothing has touched are not resident yet.
+	memory_usage+=image->getSize()+count*sizeof(image_fde_proxy_t<ptrsize>)+vector_bytes(fdes)+vector_bytes(parse_errors)+vector_bytes(executable_ranges);
+}
+
+template <int ptrsize>
+unique_ptr<fde_contents_t<ptrsize> > image_eh_frame_impl_t<ptrsize>::restoreFDE(const image_fde_t &record) const
+{
+	// mapped_image_t::open checked the record's indexes, so this cannot fail.
+	auto fde=unique_ptr<fde_contents_t<ptrsize> >(new fde_contents_t<ptrsize>());
+	fde->restore(record, contents);
+	fde->build_caches();
+	fde->setMemoryAccount(&memory_usage);
+	memory_usage+=sizeof(fde_contents_t<ptrsize>)+fde->getMemoryUsage();
+	return fde;
+}
+
+template <int ptrsize>
+const CIEVector_t* image_eh_frame_impl_t<ptrsize>::getCIEs() const
+{
+	call_once(cies_once, [&]()
+		{
+			for(auto i=uint64_t(0); i < contents.cie_count; i++)
+			{
+				if(!contents.cies[i].listed)
+					continue;
+				cies.push_back(cie_contents_t<ptrsize>());
+				cies.back().restore(contents.cies[i], contents);
+			}
+			for(const auto &c : cies)
+				c.build_caches();
+			transform(ALLOF(cies), back_inserter(cies_cache), [](const cie_contents_t<ptrsize> &a) { return &a; });
+
+			memory_usage+=vector_bytes(cies)+vector_bytes(cies_cache);
+			for(const auto &c : cies)
+				memory_usage+=c.getMemoryUsage();
+		});
+	return &cies_cache;
+}
+
+template <int ptrsize>
+const FDEContents_t* image_eh_frame_impl_t<ptrsize>::findFDE(uint64_t addr) const
+{
+	const auto it=upper_bound(ALLOF(fdes), addr, 
+		[](const uint64_t addr, const FDEContents_t* fde) { return addr < fde->getStartAddress(); });
+	if(it==fdes.begin())
+		return nullptr;
+	const auto fde=*prev(it);
+	return addr < fde->getEndAddress() ? fde : nullptr;
+}
+
+template <int ptrsize>
+const EHPSymbolVector_t* image_eh_frame_impl_t<ptrsize>::getSymbols() const
+{
+	call_once(symbols_once, [&]()
+		{
+			const auto records=image->getRecords<image_symbol_t>(IMAGE_SYMBOLS);
+			const auto names=reinterpret_cast<const char*>(image->getPart(IMAGE_SYMBOL_NAMES));
+			for(auto i=uint64_t(0); i < image->getRecordCount<image_symbol_t>(IMAGE_SYMBOLS); i++)
+			{
+				const auto &r=records[i];
+				image_symbols.push_back({string(names+r.name_offset, r.name_length), r.address, r.size, static_cast<EHPSymbolBinding_t>(r.binding), r.is_dynamic!=0});
+				memory_usage+=string_bytes(image_symbols.back().name);
+			}
+			memory_usage+=vector_bytes(image_symbols);
+		});
+	return &image_symbols;
+}
+
+template <int ptrsize>
+bool image_eh_frame_impl_t<ptrsize>::withImageContents(const function<bool(const image_contents_t&)> &use) const
+{
+	auto image_contents=contents;
+	image_contents.parse_errors=&parse_errors;
+	image_contents.executable_ranges=&executable_ranges;
+	image_contents.symbols=getSymbols();
+	return use(image_contents);
+}
+
+static unique_ptr<const EHFrameParser_t> image_parser_factory(unique_ptr<mapped_image_t> image)
+{
+	if(image->getHeader().ptrsize==4)
+		return unique_ptr<const EHFrameParser_t>(new image_eh_frame_impl_t<4>(move(image)));
+	else
+		return unique_ptr<const EHFrameParser_t>(new image_eh_frame_impl_t<8>(move(image)));
+}
+
+const EHPParseErrorVector_t* EHFrameParser_t::getParseErrors() const
+{
+	static const auto no_errors=EHPParseErrorVector_t();
+	return &no_errors;
+}
+
+unique_ptr<const EHFrameParser_t> EHFrameParser_t::loadImage(const string &filename, const string &key)
+{
+	auto image=unique_ptr<mapped_image_t>(new mapped_image_t());
+	if(image->open(filename, key))
+		return unique_ptr<const EHFrameParser_t>();
+	return image_parser_factory(move(image));
+}
+
+unique_ptr<const EHFrameParser_t> EHFrameParser_t::loadImage(const int fd, const string &key)
+{
+	auto image=unique_ptr<mapped_image_t>(new mapped_image_t());
+	if(image->open(fd, key))
+		return unique_ptr<const EHFrameParser_t>();
+	return image_parser_factory(move(image));
+}
+
+string EHFrameParser_t::computeImageKey(
+	const string &eh_frame_data, const uint64_t eh_frame_data_start_addr,
+	const string &eh_frame_hdr_data, const uint64_t eh_frame_hdr_data_start_addr,
+	const string &gcc_except_table_data, const uint64_t gcc_except_table_data_start_addr
+	)
+{
+	const auto section=[](const string &data, const uint64_t addr) -> image_section_t
+	{
+		return {reinterpret_cast<const uint8_t*>(data.data()), data.size(), addr};
+	};
+	return compute_image_key(
+		section(eh_frame_data, eh_frame_data_start_addr), 
+		section(eh_frame_hdr_data, eh_frame_hdr_data_start_addr), 
+		section(gcc_except_table_data, gcc_except_table_data_start_addr));
+}
+
 #if USE_ELFIO
-unique_ptr<const EHFrameParser_t> EHFrameParser_t::factory(const string filename)
+string EHFrameParser_t::getBuildID(const string filename)
+{
+	auto elfiop=unique_ptr<elfio>(new elfio);
+	if(!elfiop->load(filename))
+		throw invalid_argument(string() + "Cannot open file: " + filename);
+	const auto is_be=elfiop->get_encoding() == ELFDATA2MSB;
+
+	// walk the notes by hand: namesz, descsz, type, then the name and descriptor, each padded to 4 bytes.
+	for(auto i=0u; i < elfiop->sections.size(); i++)
+	{
+		const auto sec=elfiop->sections[i];
+		if(sec->get_type()!=SHT_NOTE || sec->get_data()==nullptr)
+			continue;
+		const auto data=reinterpret_cast<const uint8_t*>(sec->get_data());
+		const auto size=uint64_t(sec->get_size());
+		auto pos=uint64_t(0);
+		while(pos <= size && size-pos >= 12)
+		{
+			const auto name_size=uint64_t(eh_record_cursor_t::load<uint32_t>(data+pos, is_be));
+			const auto desc_size=uint64_t(eh_record_cursor_t::load<uint32_t>(data+pos+4, is_be));
+			const auto type=eh_record_cursor_t::load<uint32_t>(data+pos+8, is_be);
+			const auto name_pos=pos+12;
+			const auto desc_pos=name_pos+((name_size+3) & ~uint64_t(3));
+			if(desc_pos > size || desc_size > size-desc_pos)
+				break;
+			const auto is_gnu = name_size==4 && memcmp(data+name_pos, "GNU", 4)==0;
+			if(is_gnu && type==3 /* NT_GNU_BUILD_ID */)
+			{
+				ostringstream id;
+				for(auto j=uint64_t(0); j < desc_size; j++)
+					id << hex << setw(2) << setfill('0') << unsigned(data[desc_pos+j]);
+				return id.str();
+			}
+			pos=desc_pos+((desc_size+3) & ~uint64_t(3));
+		}
+	}
+	return "";
+}
+unique_ptr<const EHFrameParser_t> EHFrameParser_t::factory(const string filename, const EHPParseMode_t parse_mode, const bool load_symbols)
 {
 	auto elfiop=unique_ptr<elfio>(new elfio);
 	if(!elfiop->load(filename))
@@ -2069,20 +3033,118 @@ unique_ptr<const EHFrameParser_t> EHFrameParser_t::factory(const string filename
 	if(ptrsize==0)
 		throw invalid_argument(string() + "Invalid ELF class in : " + filename);
 
+	auto executable_ranges=EHPAddressRangeVector_t();
+	for(auto i=0u; i < elfiop->segments.size(); i++)
+	{
+		const auto seg=elfiop->segments[i];
+		if(seg->get_type()==PT_LOAD && (seg->get_flags() & PF_X)!=0 && seg->get_memory_size()!=0)
+			executable_ranges.push_back({seg->get_virtual_address(), seg->get_virtual_address()+seg->get_memory_size()});
+	}
+
+	// defined functions from both symbol tables; the join drops the duplicates.
+	auto symbols=EHPSymbolVector_t();
+	for(auto i=0u; load_symbols && i < elfiop->sections.size(); i++)
+	{
+		const auto sec=elfiop->sections[i];
+		if(sec->get_type()!=SHT_SYMTAB && sec->get_type()!=SHT_DYNSYM)
+			continue;
+		const auto accessor=symbol_section_accessor(*elfiop, sec);
+		for(auto j=Elf_Xword(0); j < accessor.get_symbols_num(); j++)
+		{
+			auto name=string();
+			auto value=Elf64_Addr(0);
+			auto size=Elf_Xword(0);
+			auto bind=(unsigned char)0;
+			auto type=(unsigned char)0;
+			auto section_index=Elf_Half(0);
+			auto other=(unsigned char)0;
+			if(!accessor.get_symbol(j, name, value, size, bind, type, section_index, other))
+				continue;
+			if(type!=STT_FUNC || section_index==SHN_UNDEF || value==0)
+				continue;
+			const auto binding = 
+				bind==STB_GLOBAL ? SYMBOL_GLOBAL :
+				bind==STB_WEAK   ? SYMBOL_WEAK   :
+				SYMBOL_LOCAL;
+			symbols.push_back({name, value, size, binding, sec->get_type()==SHT_DYNSYM});
+		}
+	}
+
 	return EHFrameParser_t::factory(ptrsize, file_endianness,
 			eh_frame_section.first, eh_frame_section.second,
 			eh_frame_hdr_section.first, eh_frame_hdr_section.second,
-			gcc_except_table_section.first, gcc_except_table_section.second);
+			gcc_except_table_section.first, gcc_except_table_section.second,
+			parse_mode,
+			executable_ranges,
+			symbols);
 
 }
 #endif
 
+static bool is_big_endian()
+{
+    union 
+    {
+	uint32_t i;
+	char c[4];
+    } bint = {0x01020304};
+
+    return bint.c[0] == 1;
+}
+
+bool EHFrameParser_t::encodeSearchTable(
+	uint8_t ptrsize,
+	EHPEndianness_t endian_type,
+	const EHPSearchTable_t &table,
+	const uint64_t eh_frame_addr,
+	const uint64_t eh_frame_hdr_addr,
+	string &eh_frame_hdr_data
+	)
+{
+	if(ptrsize!=4 && ptrsize!=8)
+		throw out_of_range("ptrsize must be 4 or 8");
+	const auto is_be = endian_type == BIG || ( is_big_endian() && endian_type == HOST) ;
+	auto failed_entry=uint64_t(0);
+	return encode_search_table(ptrsize, is_be, table, eh_frame_addr, eh_frame_hdr_addr, eh_frame_hdr_data, failed_entry);
+}
+
+bool EHFrameParser_t::encode(const EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, EHPEncodedSections_t &sections)
+{
+	return encode_sections(model, addresses, sections);
+}
+
+bool EHFrameParser_t::compact(EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, EHPEncodedSections_t &sections, const bool narrow_absolute)
+{
+	return compact_sections(model, addresses, sections, narrow_absolute);
+}
+
+bool EHFrameParser_t::readSearchTable(
+	uint8_t ptrsize,
+	EHPEndianness_t endian_type,
+	const string &eh_frame_hdr_data, const uint64_t eh_frame_hdr_data_start_addr,
+	EHPSearchTable_t &table
+	)
+{
+	const auto data=reinterpret_cast<const uint8_t*>(eh_frame_hdr_data.data());
+	const auto is_be = endian_type == BIG || ( is_big_endian() && endian_type == HOST) ;
+	table.clear();
+	if(ptrsize==4)
+		return eh_frame_hdr_t<4>().parse(data, eh_frame_hdr_data.size(), eh_frame_hdr_data_start_addr, is_be, &table);
+	else if(ptrsize==8)
+		return eh_frame_hdr_t<8>().parse(data, eh_frame_hdr_data.size(), eh_frame_hdr_data_start_addr, is_be, &table);
+	else
+		throw out_of_range("ptrsize must be 4 or 8");
+}
+
 unique_ptr<const EHFrameParser_t> EHFrameParser_t::factory(
 	uint8_t ptrsize,
 	EHPEndianness_t endian_type,
 	const string eh_frame_data, const uint64_t eh_frame_data_start_addr,
 	const string eh_frame_hdr_data, const uint64_t eh_frame_hdr_data_start_addr,
-	const string gcc_except_table_data, const uint64_t gcc_except_table_data_start_addr
+	const string gcc_except_table_data, const uint64_t gcc_except_table_data_start_addr,
+	const EHPParseMode_t parse_mode,
+	const EHPAddressRangeVector_t &executable_ranges,
+	const EHPSymbolVector_t &symbols
 	)
 {
 	const auto eh_frame_sr=ScoopReplacement_t(eh_frame_data,eh_frame_data_start_addr);
@@ -2090,24 +3152,12 @@ unique_ptr<const EHFrameParser_t> EHFrameParser_t::factory(
 	const auto gcc_except_table_sr=ScoopReplacement_t(gcc_except_table_data,gcc_except_table_data_start_addr);
 	auto ret_val=(EHFrameParser_t*)nullptr;
 	if(ptrsize==4)
-		ret_val=new split_eh_frame_impl_t<4>(eh_frame_sr,eh_frame_hdr_sr,gcc_except_table_sr);
+		ret_val=new split_eh_frame_impl_t<4>(eh_frame_sr,eh_frame_hdr_sr,gcc_except_table_sr,parse_mode,executable_ranges,symbols);
 	else if(ptrsize==8)
-		ret_val=new split_eh_frame_impl_t<8>(eh_frame_sr,eh_frame_hdr_sr,gcc_except_table_sr);
+		ret_val=new split_eh_frame_impl_t<8>(eh_frame_sr,eh_frame_hdr_sr,gcc_except_table_sr,parse_mode,executable_ranges,symbols);
 	else
 		throw out_of_range("ptrsize must be 4 or 8");
 
-
-	const auto is_big_endian = [] () -> bool
-	{
-	    union 
-	    {
-		uint32_t i;
-		char c[4];
-	    } bint = {0x01020304};
-
-	    return bint.c[0] == 1;
-	};
-
 	const auto is_be = endian_type == BIG || ( is_big_endian() && endian_type == HOST) ;
 
 	ret_val->parse(is_be);
@@ -0,0 +1,169 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <limits>
+#include <stdexcept>
+#include <sys/stat.h>
+
+#include <ehp.hpp>
+#include "ehp_cache.hpp"
+
+using namespace std;
+using namespace EHP;
+
+parser_cache_impl_t::parser_cache_impl_t(const uint64_t p_max_memory_bytes, const EHPParserLoader_t &p_loader)
+	:
+	max_memory_bytes(p_max_memory_bytes),
+	loader(p_loader),
+	next_id(0),
+	stats({0, 0, 0, 0, 0})
+{
+}
+
+shared_ptr<const EHFrameParser_t> parser_cache_impl_t::get(const string &filename)
+{
+	struct stat st;
+	if(stat(filename.c_str(), &st)!=0)
+		throw invalid_argument(string() + "Cannot stat file: " + filename);
+	const auto key=file_key_t(st.st_dev, st.st_ino, st.st_mtim.tv_sec, st.st_mtim.tv_nsec, st.st_size);
+
+	auto loaded=promise<shared_ptr<const EHFrameParser_t> >();
+	auto pending=shared_future<shared_ptr<const EHFrameParser_t> >();
+	auto id=uint64_t(0);
+	{
+		lock_guard<mutex> guard(lock);
+		const auto it=entries.find(key);
+		if(it!=entries.end())
+		{
+			stats.hits++;
+			lru.splice(lru.begin(), lru, it->second.lru_position);
+			pending=it->second.parser;
+			evict();
+		}
+		else
+		{
+			// parsers of earlier versions of this file will not be asked for again.
+			auto stale=entries.lower_bound(file_key_t(std::get<0>(key), std::get<1>(key), numeric_limits<int64_t>::min(), 0, 0));
+			while(stale!=entries.end() && std::get<0>(stale->first)==std::get<0>(key) && std::get<1>(stale->first)==std::get<1>(key))
+				erase(stale++);
+
+			stats.misses++;
+			id=next_id++;
+			lru.push_front(key);
+			entries[key]={loaded.get_future().share(), lru.begin(), nullptr, 0, id};
+			stats.entries++;
+		}
+	}
+
+	// wait for a parse in progress without holding up everyone else.
+	if(pending.valid())
+		return pending.get();
+
+	// parse without the lock, other files can be looked up meanwhile.
+	auto parser=shared_ptr<const EHFrameParser_t>();
+	try
+	{
+		parser=shared_ptr<const EHFrameParser_t>(loader(filename));
+		if(!parser)
+			throw invalid_argument(string() + "Cannot parse file: " + filename);
+	}
+	catch(...)
+	{
+		loaded.set_exception(current_exception());
+		lock_guard<mutex> guard(lock);
+		const auto it=entries.find(key);
+		if(it!=entries.end() && it->second.id==id)
+			erase(it);
+		throw;
+	}
+	loaded.set_value(parser);
+
+	lock_guard<mutex> guard(lock);
+	const auto it=entries.find(key);
+	if(it!=entries.end() && it->second.id==id)
+	{
+		it->second.parsed=parser;
+		evict();
+	}
+	return parser;
+}
+
+void parser_cache_impl_t::erase(const map<file_key_t, entry_t>::iterator it)
+{
+	stats.memory_bytes-=it->second.memory_bytes;
+	stats.entries--;
+	lru.erase(it->second.lru_position);
+	entries.erase(it);
+}
+
+void parser_cache_impl_t::evict()
+{
+	// parsers grow as their tables are built, which happens without the cache knowing.
+	stats.memory_bytes=0;
+	for(auto &entry : entries)
+	{
+		if(entry.second.parsed)
+			entry.second.memory_bytes=entry.second.parsed->getMemoryUsage();
+		stats.memory_bytes+=entry.second.memory_bytes;
+	}
+
+	// parses in progress cost nothing yet and are skipped, and the most recently used 
+	// parser stays even if it alone is over budget.
+	auto lru_it=lru.end();
+	while(stats.memory_bytes > max_memory_bytes && lru_it!=lru.begin() && prev(lru_it)!=lru.begin())
+	{
+		--lru_it;
+		const auto it=entries.find(*lru_it);
+		if(!it->second.parsed)
+			continue;
+		lru_it=next(lru_it);
+		erase(it);
+		stats.evictions++;
+	}
+}
+
+EHPParserCacheStats_t parser_cache_impl_t::getStats() const
+{
+	lock_guard<mutex> guard(lock);
+	return stats;
+}
+
+void parser_cache_impl_t::clear()
+{
+	lock_guard<mutex> guard(lock);
+	entries.clear();
+	lru.clear();
+	stats.entries=0;
+	stats.memory_bytes=0;
+}
+
+unique_ptr<EHFrameParserCache_t> EHFrameParserCache_t::factory(uint64_t max_memory_bytes, const EHPParserLoader_t &loader)
+{
+	return unique_ptr<EHFrameParserCache_t>(new parser_cache_impl_t(max_memory_bytes, loader));
+}
+
+#if USE_ELFIO
+unique_ptr<EHFrameParserCache_t> EHFrameParserCache_t::factory(uint64_t max_memory_bytes)
+{
+	return factory(max_memory_bytes, [](const string &filename) { return EHFrameParser_t::factory(filename); });
+}
+#endif
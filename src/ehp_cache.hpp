@@ -0,0 +1,82 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_cache_hpp
+#define ehp_cache_hpp
+
+#include <stdint.h>
+#include <future>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+#include <ehp.hpp>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+class parser_cache_impl_t : public EHFrameParserCache_t
+{
+	private:
+
+	// device, inode, modification time (seconds, nanoseconds), size.
+	using file_key_t = tuple<uint64_t, uint64_t, int64_t, int64_t, uint64_t>;
+	using lru_list_t = list<file_key_t>;
+
+	struct entry_t
+	{
+		shared_future<shared_ptr<const EHFrameParser_t> > parser;
+		lru_list_t::iterator lru_position;
+		shared_ptr<const EHFrameParser_t> parsed;	// null until the parse finishes
+		uint64_t memory_bytes;	// parsed's getMemoryUsage() when last measured
+		uint64_t id;		// tells a parse's own entry from one created after it was dropped
+	};
+
+	const uint64_t max_memory_bytes;
+	const EHPParserLoader_t loader;
+
+	mutable mutex lock;
+	map<file_key_t, entry_t> entries;
+	lru_list_t lru;			// most recently used first
+	uint64_t next_id;
+	EHPParserCacheStats_t stats;
+
+	// measure the parsed entries again, then drop least recently used ones until the budget 
+	// is met.  lock must be held.
+	void evict();
+	void erase(const map<file_key_t, entry_t>::iterator it);
+
+	public:
+
+	parser_cache_impl_t(const uint64_t p_max_memory_bytes, const EHPParserLoader_t &p_loader);
+
+	virtual shared_ptr<const EHFrameParser_t> get(const string &filename);
+	virtual EHPParserCacheStats_t getStats() const;
+	virtual void clear();
+};
+
+}
+#endif
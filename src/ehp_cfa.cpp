@@ -0,0 +1,392 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <algorithm>
+#include <limits>
+
+#include <ehp.hpp>
+#include "ehp_priv.hpp"
+#include "ehp_cfa.hpp"
+
+using namespace std;
+using namespace EHP;
+
+namespace 
+{
+
+bool same_rule(const EHPRegisterRule_t &a, const EHPRegisterRule_t &b)
+{
+	return a.reg==b.reg && a.type==b.type && a.operand==b.operand;
+}
+
+bool same_cfa(const EHPCFARule_t &a, const EHPCFARule_t &b)
+{
+	return a.type==b.type && a.reg==b.reg && a.offset==b.offset;
+}
+
+// rules are kept sorted by register number so rows can be searched and compared cheaply.
+void set_rule(EHPRegisterRuleVector_t &rules, const uint32_t reg, const EHPRegisterRuleType_t type, const int64_t operand)
+{
+	const auto it=lower_bound(rules.begin(), rules.end(), reg, 
+		[](const EHPRegisterRule_t &r, const uint32_t target) { return r.reg < target; });
+	const auto new_rule=EHPRegisterRule_t({reg, type, operand});
+	if(it!=rules.end() && it->reg==reg)
+		*it=new_rule;
+	else
+		rules.insert(it, new_rule);
+}
+
+void restore_rule(EHPRegisterRuleVector_t &rules, const uint32_t reg, const EHPRegisterRuleVector_t &initial_rules)
+{
+	const auto by_reg=[](const EHPRegisterRule_t &r, const uint32_t target) { return r.reg < target; };
+	const auto it=lower_bound(rules.begin(), rules.end(), reg, by_reg);
+	const auto init_it=lower_bound(initial_rules.begin(), initial_rules.end(), reg, by_reg);
+	const auto has_initial = init_it!=initial_rules.end() && init_it->reg==reg;
+	const auto has_current = it!=rules.end() && it->reg==reg;
+	if(has_initial && has_current)
+		*it=*init_it;
+	else if(has_initial)
+		rules.insert(it, *init_it);
+	else if(has_current)
+		rules.erase(it);
+}
+
+}
+
+void cfa_table_t::evaluate(
+	const EHProgramInstructionVector_t &cie_program,
+	const EHProgramInstructionVector_t &fde_program,
+	const uint64_t caf,
+	const int64_t daf,
+	const uint64_t start_addr,
+	const uint64_t end_addr
+	)
+{
+	auto state=cfa_state_t();
+	state.cfa=EHPCFARule_t({CFA_RULE_UNDEFINED, 0, 0});
+	auto state_stack=vector<cfa_state_t>();
+
+	// the CIE's initial instructions establish the rules DW_CFA_restore returns to.
+	// location changes in a CIE are meaningless, so they are ignored.
+	const auto no_initial_state=cfa_state_t();
+	for(const auto insn : cie_program)
+	{
+		auto ignored_addr=start_addr;
+		if(!insn->advance(ignored_addr, caf))
+			execute(*insn, state, no_initial_state, state_stack, daf);
+	}
+	const auto initial_state=state;
+	state_stack.clear();
+
+	auto row_start=start_addr;
+	for(const auto insn : fde_program)
+	{
+		auto new_addr=row_start;
+		if(insn->advance(new_addr, caf))
+		{
+			// locations must only move forward and stay within the FDE.
+			if(new_addr < row_start)
+			{
+				complete=false;
+				continue;
+			}
+			new_addr=min(new_addr, end_addr);
+			emit_row(row_start, new_addr, state);
+			row_start=new_addr;
+		}
+		else
+			execute(*insn, state, initial_state, state_stack, daf);
+	}
+	emit_row(row_start, end_addr, state);
+}
+
+void cfa_table_t::execute(
+	const EHProgramInstruction_t &insn, 
+	cfa_state_t &state, 
+	const cfa_state_t &initial_state, 
+	vector<cfa_state_t> &state_stack, 
+	const int64_t daf
+	)
+{
+	const auto &bytes=insn.getBytes();
+	if(bytes.size()==0)
+	{
+		complete=false;
+		return;
+	}
+
+	const auto opcode=bytes[0];
+	const auto opcode_upper2=(uint8_t)(opcode >> 6);
+	const auto opcode_lower6=(uint8_t)(opcode & (0x3f));
+	auto cursor=eh_record_cursor_t(bytes.data(), 1, bytes.size(), false);
+
+	// register operands are ulebs, but must fit the row's 32-bit register field.
+	const auto read_reg=[&](uint32_t &reg) -> bool
+	{
+		auto uleb=uint64_t(0);
+		if(cursor.read_uleb128(uleb) || uleb > numeric_limits<uint32_t>::max())
+			return true;
+		reg=static_cast<uint32_t>(uleb);
+		return false;
+	};
+	const auto read_factored_uleb=[&](int64_t &value) -> bool
+	{
+		auto uleb=uint64_t(0);
+		if(cursor.read_uleb128(uleb))
+			return true;
+		value=static_cast<int64_t>(uleb)*daf;
+		return false;
+	};
+	const auto read_factored_sleb=[&](int64_t &value) -> bool
+	{
+		auto sleb=int64_t(0);
+		if(cursor.read_sleb128(sleb))
+			return true;
+		value=sleb*daf;
+		return false;
+	};
+	const auto read_expression=[&](int64_t &index) -> bool
+	{
+		auto len=uint64_t(0);
+		if(cursor.read_uleb128(len) || len > cursor.remaining())
+			return true;
+		const auto expr_start=&bytes[cursor.getPosition()];
+		index=static_cast<int64_t>(add_expression(expr_start, expr_start+len, insn));
+		return false;
+	};
+
+	auto reg=uint32_t(0);
+	auto reg2=uint32_t(0);
+	auto value=int64_t(0);
+	auto err=false;
+	switch(opcode_upper2)
+	{
+		case 2:
+			// DW_CFA_offset
+			err = read_factored_uleb(value);
+			if(!err)
+				set_rule(state.rules, opcode_lower6, REG_RULE_OFFSET, value);
+			break;
+		case 3:
+			// DW_CFA_restore
+			restore_rule(state.rules, opcode_lower6, initial_state.rules);
+			break;
+		case 0:
+		{
+			switch(opcode_lower6)
+			{
+				case DW_CFA_nop:
+				case DW_CFA_GNU_args_size:
+				// aarch64 reuses window_save to toggle return address signing, which 
+				// does not change where anything is saved.
+				case DW_CFA_GNU_window_save:
+					break;
+
+				case DW_CFA_offset_extended:
+					err = read_reg(reg) || read_factored_uleb(value);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_OFFSET, value);
+					break;
+				case DW_CFA_offset_extended_sf:
+					err = read_reg(reg) || read_factored_sleb(value);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_OFFSET, value);
+					break;
+				case DW_CFA_GNU_negative_offset_extended:
+					err = read_reg(reg) || read_factored_uleb(value);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_OFFSET, -value);
+					break;
+				case DW_CFA_val_offset:
+					err = read_reg(reg) || read_factored_uleb(value);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_VAL_OFFSET, value);
+					break;
+				case DW_CFA_val_offset_sf:
+					err = read_reg(reg) || read_factored_sleb(value);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_VAL_OFFSET, value);
+					break;
+				case DW_CFA_restore_extended:
+					err = read_reg(reg);
+					if(!err)
+						restore_rule(state.rules, reg, initial_state.rules);
+					break;
+				case DW_CFA_undefined:
+					err = read_reg(reg);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_UNDEFINED, 0);
+					break;
+				case DW_CFA_same_value:
+					err = read_reg(reg);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_SAME_VALUE, 0);
+					break;
+				case DW_CFA_register:
+					err = read_reg(reg) || read_reg(reg2);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_REGISTER, reg2);
+					break;
+				case DW_CFA_expression:
+					err = read_reg(reg) || read_expression(value);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_EXPRESSION, value);
+					break;
+				case DW_CFA_val_expression:
+					err = read_reg(reg) || read_expression(value);
+					if(!err)
+						set_rule(state.rules, reg, REG_RULE_VAL_EXPRESSION, value);
+					break;
+
+				case DW_CFA_remember_state:
+					state_stack.push_back(state);
+					break;
+				case DW_CFA_restore_state:
+					if(state_stack.size()==0)
+					{
+						err=true;
+						break;
+					}
+					state=state_stack.back();
+					state_stack.pop_back();
+					break;
+
+				case DW_CFA_def_cfa:
+				{
+					auto offset=uint64_t(0);
+					err = read_reg(reg) || cursor.read_uleb128(offset);
+					if(!err)
+						state.cfa=EHPCFARule_t({CFA_RULE_REG_OFFSET, reg, static_cast<int64_t>(offset)});
+					break;
+				}
+				case DW_CFA_def_cfa_sf:
+					err = read_reg(reg) || read_factored_sleb(value);
+					if(!err)
+						state.cfa=EHPCFARule_t({CFA_RULE_REG_OFFSET, reg, value});
+					break;
+				case DW_CFA_def_cfa_register:
+					// only meaningful if the current rule is register-based.
+					err = read_reg(reg) || state.cfa.type!=CFA_RULE_REG_OFFSET;
+					if(!err)
+						state.cfa.reg=reg;
+					break;
+				case DW_CFA_def_cfa_offset:
+				{
+					auto offset=uint64_t(0);
+					err = cursor.read_uleb128(offset) || state.cfa.type!=CFA_RULE_REG_OFFSET;
+					if(!err)
+						state.cfa.offset=static_cast<int64_t>(offset);
+					break;
+				}
+				case DW_CFA_def_cfa_offset_sf:
+					err = read_factored_sleb(value) || state.cfa.type!=CFA_RULE_REG_OFFSET;
+					if(!err)
+						state.cfa.offset=value;
+					break;
+				case DW_CFA_def_cfa_expression:
+					err = read_expression(value);
+					if(!err)
+						state.cfa=EHPCFARule_t({CFA_RULE_EXPRESSION, 0, value});
+					break;
+
+				default:
+					err=true;
+					break;
+			}
+			break;
+		}
+		default:
+			err=true;
+			break;
+	}
+
+	if(err)
+		complete=false;
+}
+
+void cfa_table_t::emit_row(const uint64_t start_addr, const uint64_t end_addr, const cfa_state_t &state)
+{
+	if(start_addr >= end_addr)
+		return;
+
+	// extend the previous row instead of repeating identical rules.
+	if(rows.size() > 0)
+	{
+		auto &prev=rows.back();
+		const auto prev_rules_begin=next(rules.begin(), prev.first_rule);
+		const auto same = 
+			prev.end_addr==start_addr && 
+			same_cfa(prev.cfa, state.cfa) &&
+			prev.rule_count==state.rules.size() &&
+			equal(state.rules.begin(), state.rules.end(), prev_rules_begin, same_rule);
+		if(same)
+		{
+			prev.end_addr=end_addr;
+			return;
+		}
+	}
+
+	const auto row=EHPCFARow_t({start_addr, end_addr, state.cfa, 
+		static_cast<uint32_t>(rules.size()), static_cast<uint32_t>(state.rules.size())});
+	rows.push_back(row);
+	rules.insert(rules.end(), state.rules.begin(), state.rules.end());
+}
+
+uint64_t cfa_table_t::add_expression(const uint8_t* const begin, const uint8_t* const end, const EHProgramInstruction_t &insn)
+{
+	expressions.push_back(EHProgramInstructionByteVector_t(begin, end));
+
+	// compiled once here so unwinding never decodes.  a malformed expression compiles to no ops.
+	compiled_expressions.push_back(EHPExpressionOpVector_t());
+	insn.getExpression(compiled_expressions.back());
+	return expressions.size()-1;
+}
+
+const EHPCFARow_t* cfa_table_t::findRow(uint64_t pc) const
+{
+	// rows are sorted and non-overlapping, find the last row starting at or before pc.
+	const auto it=upper_bound(rows.begin(), rows.end(), pc, 
+		[](const uint64_t pc, const EHPCFARow_t &row) { return pc < row.start_addr; });
+	if(it==rows.begin())
+		return nullptr;
+	const auto &row=*prev(it);
+	return pc < row.end_addr ? &row : nullptr;
+}
+
+const EHPRegisterRule_t* cfa_table_t::findRegisterRule(const EHPCFARow_t& row, uint32_t reg) const
+{
+	const auto begin=next(rules.begin(), row.first_rule);
+	const auto end=next(begin, row.rule_count);
+	const auto it=lower_bound(begin, end, reg, 
+		[](const EHPRegisterRule_t &r, const uint32_t target) { return r.reg < target; });
+	return (it!=end && it->reg==reg) ? &*it : nullptr;
+}
+
+uint64_t cfa_table_t::getMemoryUsage() const
+{
+	auto bytes=vector_bytes(rows)+vector_bytes(rules)+vector_bytes(expressions)+vector_bytes(compiled_expressions);
+	for(const auto &expr : expressions)
+		bytes+=vector_bytes(expr);
+	for(const auto &ops : compiled_expressions)
+		bytes+=vector_bytes(ops);
+	return bytes;
+}
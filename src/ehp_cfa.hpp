@@ -0,0 +1,94 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_cfa_hpp
+#define ehp_cfa_hpp
+
+#include <stdint.h>
+#include <vector>
+
+#include <ehp.hpp>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// Executes a CIE's initial instructions followed by an FDE's program and records
+// the resulting rows.  Location-changing instructions are interpreted through 
+// EHProgramInstruction_t::advance so byte order is handled by the instruction itself.
+class cfa_table_t : public CFATable_t
+{
+	public:
+
+	cfa_table_t() : complete(true) {}
+
+	void evaluate(
+		const EHProgramInstructionVector_t &cie_program,
+		const EHProgramInstructionVector_t &fde_program,
+		const uint64_t caf,
+		const int64_t daf,
+		const uint64_t start_addr,
+		const uint64_t end_addr
+		);
+
+	const EHPCFARowVector_t* getRows() const { return &rows; }
+	const EHPRegisterRuleVector_t* getRegisterRules() const { return &rules; }
+	const EHPExpressionVector_t* getExpressions() const { return &expressions; }
+	const EHPCompiledExpressionVector_t* getCompiledExpressions() const { return &compiled_expressions; }
+	const EHPCFARow_t* findRow(uint64_t pc) const ;
+	const EHPRegisterRule_t* findRegisterRule(const EHPCFARow_t& row, uint32_t reg) const ;
+	bool isComplete() const { return complete; }
+	// heap bytes held beyond the object itself.
+	uint64_t getMemoryUsage() const;
+
+	private:
+
+	// the rules in effect at one point in the program.  rules are kept sorted by register.
+	struct cfa_state_t
+	{
+		EHPCFARule_t cfa;
+		EHPRegisterRuleVector_t rules;
+	};
+
+	// execute one non-location instruction.  
+	void execute(
+		const EHProgramInstruction_t &insn, 
+		cfa_state_t &state, 
+		const cfa_state_t &initial_state, 
+		vector<cfa_state_t> &state_stack, 
+		const int64_t daf
+		);
+
+	void emit_row(const uint64_t start_addr, const uint64_t end_addr, const cfa_state_t &state);
+	uint64_t add_expression(const uint8_t* const begin, const uint8_t* const end, const EHProgramInstruction_t &insn);
+
+	EHPCFARowVector_t rows;
+	EHPRegisterRuleVector_t rules;
+	EHPExpressionVector_t expressions;
+	EHPCompiledExpressionVector_t compiled_expressions;
+	bool complete;
+};
+
+}
+#endif
@@ -0,0 +1,262 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <tuple>
+
+#include <ehp.hpp>
+#include "ehp_compact.hpp"
+#include "ehp_dwarf2.hpp"
+#include "ehp_encode.hpp"
+#include "ehp_parallel.hpp"
+
+using namespace std;
+using namespace EHP;
+
+namespace
+{
+
+// the addresses a field may end up at.
+struct field_range_t
+{
+	uint64_t low;
+	uint64_t high;
+};
+
+// whether value can be written with encoding anywhere in field.  a pc-relative value only moves 
+// one way with the field's address, so checking the ends is enough.
+bool fits(const uint8_t encoding, const uint64_t value, const field_range_t &field, const uint8_t ptrsize)
+{
+	auto at_low=eh_section_writer_t(nullptr, field.low, 0, ptrsize, false);
+	auto at_high=eh_section_writer_t(nullptr, field.high, 0, ptrsize, false);
+	return !at_low.write_encoded(encoding, value) && !at_high.write_encoded(encoding, value);
+}
+
+// the narrowest fixed-size encoding, keeping encoding's application and indirect bits, for which 
+// all_fit holds.  encoding itself if nothing narrower does, or if it is not absolute or pc-relative.  
+// absolute pointers usually carry relocations sized for the original field, so they are only 
+// narrowed if narrow_absolute is set.
+uint8_t narrowest(const uint8_t encoding, const uint8_t ptrsize, const bool narrow_absolute, const function<bool(uint8_t)> &all_fit)
+{
+	static const uint8_t formats[]={DW_EH_PE_udata2, DW_EH_PE_sdata2, DW_EH_PE_udata4, DW_EH_PE_sdata4};
+	const auto application=encoding & 0x70;
+	const auto size=encoded_size(encoding, ptrsize);
+	if(encoding==DW_EH_PE_omit || (application!=DW_EH_PE_absptr && application!=DW_EH_PE_pcrel) || size==0)
+		return encoding;
+	if(application==DW_EH_PE_absptr && !narrow_absolute)
+		return encoding;
+	for(const auto format : formats)
+	{
+		const auto candidate=static_cast<uint8_t>((encoding & 0xf0) | format);
+		if(encoded_size(candidate, ptrsize) >= size)
+			break;
+		if(all_fit(candidate))
+			return candidate;
+	}
+	return encoding;
+}
+
+// the call site encoding giving the smallest call site table, preferring the current one.
+uint8_t smallest_call_site_encoding(const EHPModelLSDA_t &lsda, const uint64_t fde_start, const uint8_t ptrsize)
+{
+	static const uint8_t encodings[]={DW_EH_PE_uleb128, DW_EH_PE_udata2, DW_EH_PE_udata4, DW_EH_PE_udata8};
+	const auto base = lsda.landing_pad_base_encoding==DW_EH_PE_omit ? fde_start : lsda.landing_pad_base;
+	const auto table_size=[&](const uint8_t encoding, uint64_t &size) -> bool
+	{
+		auto sizer=eh_section_writer_t(nullptr, 0, 0, ptrsize, false);
+		for(const auto &cs : lsda.call_sites)
+		{
+			if(sizer.write_encoded(encoding, cs.start-base) || 
+			   sizer.write_encoded(encoding, cs.end-cs.start) ||
+			   sizer.write_encoded(encoding, cs.landing_pad==0 ? 0 : cs.landing_pad-base))
+				return true;
+		}
+		size=sizer.getPosition();
+		return false;
+	};
+
+	auto best=lsda.call_site_encoding;
+	auto best_size=uint64_t(0);
+	if((best & 0x70)!=0 || table_size(best, best_size))
+		return best;
+	for(const auto encoding : encodings)
+	{
+		auto size=uint64_t(0);
+		if(!table_size(encoding, size) && size < best_size)
+		{
+			best=encoding;
+			best_size=size;
+		}
+	}
+	return best;
+}
+
+void compact_lsda(EHPModelFDE_t &fde, const field_range_t &gcc_except_table, const uint8_t ptrsize, const bool narrow_absolute)
+{
+	auto &lsda=fde.lsda;
+	if(lsda.landing_pad_base_encoding!=DW_EH_PE_omit && lsda.landing_pad_base==fde.start)
+		lsda.landing_pad_base_encoding=DW_EH_PE_omit;
+	if(lsda.landing_pad_base_encoding!=DW_EH_PE_omit && lsda.landing_pad_base!=0)
+	{
+		lsda.landing_pad_base_encoding=narrowest(lsda.landing_pad_base_encoding, ptrsize, narrow_absolute, [&](const uint8_t encoding)
+			{
+				return fits(encoding, lsda.landing_pad_base, gcc_except_table, ptrsize);
+			});
+	}
+	lsda.call_site_encoding=smallest_call_site_encoding(lsda, fde.start, ptrsize);
+	lsda.type_table_encoding=narrowest(lsda.type_table_encoding, ptrsize, narrow_absolute, [&](const uint8_t encoding)
+		{
+			return all_of(lsda.type_table.begin(), lsda.type_table.end(), [&](const uint64_t entry)
+				{
+					return entry==0 || fits(encoding, entry, gcc_except_table, ptrsize);
+				});
+		});
+}
+
+bool has_augmentation(const EHPModelCIE_t &cie, const char c)
+{
+	return cie.augmentation.find(c)!=string::npos;
+}
+
+// narrow the pointers a CIE encodes for itself and for its FDEs.  fixed_locations[i] is set if 
+// FDE i's or its CIE's program has set_loc operands, which are written with the FDE encoding.
+void compact_cie(EHPModelCIE_t &cie, const EHPSectionModel_t &model, const vector<size_t> &cie_fdes, const vector<char> &fixed_locations, const field_range_t &eh_frame, const field_range_t &gcc_except_table, const bool narrow_absolute)
+{
+	const auto ptrsize=model.ptrsize;
+	if(has_augmentation(cie, 'P') && cie.personality!=0)
+	{
+		cie.personality_encoding=narrowest(cie.personality_encoding, ptrsize, narrow_absolute, [&](const uint8_t encoding)
+			{
+				return fits(encoding, cie.personality, eh_frame, ptrsize);
+			});
+	}
+	const auto fixed_encoding=cie_fdes.empty() || any_of(cie_fdes.begin(), cie_fdes.end(), [&](const size_t i) { return fixed_locations[i]; });
+	if(has_augmentation(cie, 'R') && !fixed_encoding)
+	{
+		cie.fde_encoding=narrowest(cie.fde_encoding, ptrsize, narrow_absolute, [&](const uint8_t encoding)
+			{
+				return all_of(cie_fdes.begin(), cie_fdes.end(), [&](const size_t i)
+					{
+						const auto &fde=model.fdes[i];
+						return fits(encoding, fde.start, eh_frame, ptrsize) && 
+						       fits(encoding & 0x0f, fde.end-fde.start, eh_frame, ptrsize);
+					});
+			});
+	}
+	if(has_augmentation(cie, 'L'))
+	{
+		// the LSDAs may land anywhere in the table.
+		cie.lsda_encoding=narrowest(cie.lsda_encoding, ptrsize, narrow_absolute, [&](const uint8_t encoding)
+			{
+				return none_of(cie_fdes.begin(), cie_fdes.end(), [&](const size_t i) { return model.fdes[i].has_lsda; }) ||
+				       (fits(encoding, gcc_except_table.low, eh_frame, ptrsize) && fits(encoding, gcc_except_table.high, eh_frame, ptrsize));
+			});
+	}
+}
+
+// point the FDEs of identical CIEs at the first of them.
+void merge_cies(EHPSectionModel_t &model)
+{
+	using cie_key_t = tuple<uint8_t, string, uint64_t, int64_t, uint64_t, uint8_t, uint64_t, uint8_t, uint8_t, EHProgramInstructionByteVector_t>;
+	auto first_of=map<cie_key_t, uint64_t>();
+	auto merged=vector<EHPModelCIE_t>();
+	auto new_index=vector<uint64_t>(model.cies.size());
+	for(auto i=size_t(0); i < model.cies.size(); i++)
+	{
+		const auto &cie=model.cies[i];
+		const auto key=cie_key_t(cie.version, cie.augmentation, cie.code_alignment_factor, cie.data_alignment_factor, 
+			cie.return_register, cie.personality_encoding, cie.personality, cie.lsda_encoding, cie.fde_encoding, cie.program);
+		const auto it=first_of.insert({key, merged.size()}).first;
+		if(it->second==merged.size())
+			merged.push_back(cie);
+		new_index[i]=it->second;
+	}
+	for(auto &fde : model.fdes)
+		fde.cie=new_index[fde.cie];
+	model.cies.swap(merged);
+}
+
+}
+
+bool EHP::compact_sections(EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, EHPEncodedSections_t &sections, const bool narrow_absolute)
+{
+	// encoding the model as it is checks it, and bounds where compacted records can land: each 
+	// shrinks or keeps its size, except that an LSDA's type table may need up to 7 more bytes 
+	// of alignment.
+	if(encode_sections(model, addresses, sections))
+		return true;
+	const auto ptrsize=model.ptrsize;
+	const auto eh_frame=field_range_t{addresses.eh_frame_addr, addresses.eh_frame_addr+sections.eh_frame.size()};
+	const auto lsda_count=uint64_t(count_if(model.fdes.begin(), model.fdes.end(), [](const EHPModelFDE_t &fde) { return fde.has_lsda; }));
+	const auto gcc_except_table=field_range_t{addresses.gcc_except_table_addr, addresses.gcc_except_table_addr+sections.gcc_except_table.size()+8*lsda_count};
+
+	// work on a copy, so that model is left alone if the compacted one does not encode.
+	auto compacted=model;
+
+	// programs that do not decode are kept as they are, and keep their FDE encoding in case 
+	// they have set_loc operands.
+	auto cie_fixed_locations=vector<char>(compacted.cies.size());
+	for(auto i=size_t(0); i < compacted.cies.size(); i++)
+	{
+		auto &cie=compacted.cies[i];
+		auto sets_location=false;
+		cie_fixed_locations[i]=remove_cfa_nops(ptrsize, compacted.is_be, cie.fde_encoding, cie.program, sets_location) || sets_location;
+	}
+	const auto fde_count=compacted.fdes.size();
+	auto fixed_locations=vector<char>(fde_count);
+	parallel_for_chunks(fde_count, parallel_chunk_count(fde_count), [&](const size_t, const size_t begin, const size_t end)
+		{
+			for(auto i=begin; i < end; i++)
+			{
+				auto &fde=compacted.fdes[i];
+				auto sets_location=false;
+				fixed_locations[i]=cie_fixed_locations[fde.cie] || 
+					remove_cfa_nops(ptrsize, compacted.is_be, compacted.cies[fde.cie].fde_encoding, fde.program, sets_location) || 
+					sets_location;
+				if(fde.has_lsda)
+					compact_lsda(fde, gcc_except_table, ptrsize, narrow_absolute);
+			}
+		});
+
+	// a CIE's encodings must suit all of its FDEs, so merge first.  CIEs that then narrow to 
+	// the same encodings merge again.
+	merge_cies(compacted);
+	auto cie_fdes=vector<vector<size_t> >(compacted.cies.size());
+	for(auto i=size_t(0); i < fde_count; i++)
+		cie_fdes[compacted.fdes[i].cie].push_back(i);
+	for(auto i=size_t(0); i < compacted.cies.size(); i++)
+		compact_cie(compacted.cies[i], compacted, cie_fdes[i], fixed_locations, eh_frame, gcc_except_table, narrow_absolute);
+	merge_cies(compacted);
+
+	// sections still hold the encoding of model, which is what a caller gets on failure.
+	auto compacted_sections=EHPEncodedSections_t();
+	if(encode_sections(compacted, addresses, compacted_sections))
+	{
+		sections.error=compacted_sections.error;
+		return true;
+	}
+	swap(model, compacted);
+	swap(sections, compacted_sections);
+	return false;
+}
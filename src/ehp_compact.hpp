@@ -0,0 +1,46 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_compact_hpp
+#define ehp_compact_hpp
+
+#include <stdint.h>
+
+#include <ehp.hpp>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// drop the DW_CFA_nop instructions from a CFA program whose CIE has the given FDE pointer encoding, 
+// and say whether it has a DW_CFA_set_loc, whose operand uses that encoding.  returns true, leaving 
+// program alone, if it does not decode.  defined in ehp.cpp, with the instruction decoder.
+bool remove_cfa_nops(const uint8_t ptrsize, const bool is_be, const uint8_t address_encoding, EHProgramInstructionByteVector_t &program, bool &sets_location);
+
+// returns true, with sections.error set and model unchanged, if model or its compacted form cannot be 
+// encoded.  absolute pointers are only narrowed if narrow_absolute is set.
+bool compact_sections(EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, EHPEncodedSections_t &sections, const bool narrow_absolute);
+
+}
+#endif
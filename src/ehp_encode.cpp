@@ -0,0 +1,743 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <string.h>
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <unordered_map>
+
+#include <ehp.hpp>
+#include "ehp_dwarf2.hpp"
+#include "ehp_encode.hpp"
+#include "ehp_parallel.hpp"
+
+using namespace std;
+using namespace EHP;
+
+void eh_section_writer_t::write_bytes(const uint8_t* const bytes, const size_t size)
+{
+	if(data && size > 0)
+		memcpy(data+position, bytes, size);
+	position+=size;
+}
+
+void eh_section_writer_t::write_string(const string &s)
+{
+	write_bytes(reinterpret_cast<const uint8_t*>(s.c_str()), s.size()+1);
+}
+
+void eh_section_writer_t::write_uleb128(const uint64_t value, const size_t min_size)
+{
+	auto rest=value;
+	auto written=size_t(0);
+	auto more=true;
+	while(more)
+	{
+		auto byte=static_cast<uint8_t>(rest & 0x7f);
+		rest>>=7;
+		written++;
+		more = rest!=0 || written < min_size;
+		if(more)
+			byte|=0x80;
+		write_type(byte);
+	}
+}
+
+void eh_section_writer_t::write_sleb128(const int64_t value, const size_t min_size)
+{
+	auto rest=value;
+	auto written=size_t(0);
+	auto more=true;
+	while(more)
+	{
+		auto byte=static_cast<uint8_t>(rest & 0x7f);
+		rest>>=7;
+		written++;
+		// past the value, padding bytes carry on its sign.
+		more = !((rest==0 && (byte & 0x40)==0) || (rest==-1 && (byte & 0x40)!=0)) || written < min_size;
+		if(more)
+			byte|=0x80;
+		write_type(byte);
+	}
+}
+
+void eh_section_writer_t::pad(const uint64_t record_start, const uint64_t alignment)
+{
+	while((position-record_start) % alignment != 0)
+		write_type(uint8_t(0));
+}
+
+void eh_section_writer_t::align(const uint64_t alignment)
+{
+	while(getAddress() % alignment != 0)
+		write_type(uint8_t(0));
+}
+
+bool eh_section_writer_t::write_encoded(const uint8_t encoding, const uint64_t value, const size_t leb128_size)
+{
+	if(encoding==DW_EH_PE_omit)
+		return true;
+
+	auto v=value;
+	switch(encoding & 0x70)
+	{
+		case DW_EH_PE_absptr:
+			break;
+		case DW_EH_PE_pcrel:
+			v=value-getAddress();
+			break;
+		case DW_EH_PE_datarel:
+			if(!has_data_base)
+				return true;
+			v=value-data_base;
+			break;
+		default:
+			return true;
+	}
+
+	const auto sv=static_cast<int64_t>(v);
+	const auto fits_signed=[&](const int64_t min, const int64_t max) { return sv >= min && sv <= max; };
+	switch(encoding & 0x0f)
+	{
+		case DW_EH_PE_absptr:
+			if(ptrsize==8)
+				write_type(v);
+			else if(ptrsize==4 && v <= numeric_limits<uint32_t>::max())
+				write_type(static_cast<uint32_t>(v));
+			else
+				return true;
+			break;
+		case DW_EH_PE_udata2:
+			if(v > numeric_limits<uint16_t>::max())
+				return true;
+			write_type(static_cast<uint16_t>(v));
+			break;
+		case DW_EH_PE_udata4:
+			if(v > numeric_limits<uint32_t>::max())
+				return true;
+			write_type(static_cast<uint32_t>(v));
+			break;
+		case DW_EH_PE_udata8:
+			write_type(v);
+			break;
+		case DW_EH_PE_sdata2:
+			if(!fits_signed(numeric_limits<int16_t>::min(), numeric_limits<int16_t>::max()))
+				return true;
+			write_type(static_cast<int16_t>(sv));
+			break;
+		case DW_EH_PE_sdata4:
+			if(!fits_signed(numeric_limits<int32_t>::min(), numeric_limits<int32_t>::max()))
+				return true;
+			write_type(static_cast<int32_t>(sv));
+			break;
+		case DW_EH_PE_sdata8:
+			write_type(sv);
+			break;
+		case DW_EH_PE_uleb128:
+			write_uleb128(v, leb128_size);
+			break;
+		case DW_EH_PE_sleb128:
+			write_sleb128(sv, leb128_size);
+			break;
+		default:
+			return true;
+	}
+	return false;
+}
+
+size_t eh_section_writer_t::uleb128_size(uint64_t value)
+{
+	auto size=size_t(1);
+	for(value>>=7; value!=0; value>>=7)
+		size++;
+	return size;
+}
+
+size_t eh_section_writer_t::sleb128_size(int64_t value)
+{
+	auto sizer=eh_section_writer_t(nullptr, 0, 0, 8, false);
+	sizer.write_sleb128(value);
+	return sizer.getPosition();
+}
+
+uint64_t EHP::encoded_size(const uint8_t encoding, const uint8_t ptrsize)
+{
+	switch(encoding & 0x0f)
+	{
+		case DW_EH_PE_absptr: return ptrsize;
+		case DW_EH_PE_udata2: case DW_EH_PE_sdata2: return 2;
+		case DW_EH_PE_udata4: case DW_EH_PE_sdata4: return 4;
+		case DW_EH_PE_udata8: case DW_EH_PE_sdata8: return 8;
+		default: return 0;
+	}
+}
+
+namespace
+{
+
+void copy_program(const EHProgram_t &program, EHProgramInstructionByteVector_t &bytes)
+{
+	bytes.clear();
+	for(const auto insn : *program.getInstructions())
+	{
+		const auto &insn_bytes=insn->getBytes();
+		bytes.insert(bytes.end(), insn_bytes.begin(), insn_bytes.end());
+	}
+}
+
+EHPModelCIE_t model_cie(const CIEContents_t &cie)
+{
+	auto m=EHPModelCIE_t();
+	m.version=cie.getVersion();
+	m.augmentation=cie.getAugmentation();
+	m.code_alignment_factor=cie.getCAF();
+	m.data_alignment_factor=cie.getDAF();
+	m.return_register=cie.getReturnRegister();
+	m.personality_encoding=cie.getPersonalityEncoding();
+	m.personality=cie.getPersonality();
+	m.lsda_encoding=cie.getLSDAEncoding();
+	m.fde_encoding=cie.getFDEEncoding();
+	copy_program(cie.getProgram(), m.program);
+	return m;
+}
+
+// the exception specifications are lists of uleb128 type indices ending in 0, after the type 
+// table base.  the parser does not decode them, so copy the bytes up to the end of the last 
+// list a negative filter names.
+void copy_exception_specs(const LSDA_t &lsda, const image_section_t &gcc_except_table, EHPModelLSDA_t &m)
+{
+	const auto base=lsda.getTypeTableAddress();
+	if(lsda.getTypeTableEncoding()==DW_EH_PE_omit || base < gcc_except_table.addr || base > gcc_except_table.addr+gcc_except_table.size)
+		return;
+	const auto data=gcc_except_table.data+(base-gcc_except_table.addr);
+	const auto limit=gcc_except_table.size-(base-gcc_except_table.addr);
+
+	const auto read_uleb128=[&](uint64_t &pos, uint64_t &value) -> bool
+	{
+		value=0;
+		auto shift=0u;
+		auto byte=uint8_t(0x80);
+		while(byte & 0x80)
+		{
+			if(pos >= limit)
+				return true;
+			byte=data[pos++];
+			if(shift < 64)
+				value|=uint64_t(byte & 0x7f) << shift;
+			shift+=7;
+		}
+		return false;
+	};
+
+	auto end=uint64_t(0);
+	for(const auto &cs : m.call_sites)
+	{
+		for(const auto filter : cs.actions)
+		{
+			if(filter >= 0)
+				continue;
+			auto pos=uint64_t(-(filter+1));
+			auto index=uint64_t(0);
+			while(!read_uleb128(pos, index) && index!=0)
+			{
+			}
+			end=max(end, min(pos, limit));
+		}
+	}
+	m.exception_specs.assign(data, data+end);
+}
+
+void model_lsda(const LSDA_t &lsda, const image_section_t &gcc_except_table, EHPModelLSDA_t &m)
+{
+	m.landing_pad_base_encoding=lsda.getLandingPadBaseEncoding();
+	m.landing_pad_base=lsda.getLandingPadBaseAddress();
+	m.call_site_encoding=lsda.getCallSiteTableEncoding();
+	m.type_table_encoding=lsda.getTypeTableEncoding();
+	for(const auto cs : *lsda.getCallSites())
+	{
+		auto model_cs=EHPModelCallSite_t();
+		model_cs.start=cs->getCallSiteAddress();
+		model_cs.end=cs->getCallSiteEndAddress();
+		model_cs.landing_pad=cs->getLandingPadAddress();
+		for(const auto action : *cs->getActionTable())
+			model_cs.actions.push_back(action->getAction());
+		m.call_sites.push_back(model_cs);
+	}
+	for(const auto tt : *lsda.getTypeTable())
+		m.type_table.push_back(tt->getTypeInfoPointer());
+	copy_exception_specs(lsda, gcc_except_table, m);
+}
+
+bool has_augmentation(const EHPModelCIE_t &cie, const char c)
+{
+	return cie.augmentation.find(c)!=string::npos;
+}
+
+uint8_t fde_encoding(const EHPModelCIE_t &cie)
+{
+	return has_augmentation(cie, 'R') ? cie.fde_encoding : uint8_t(DW_EH_PE_absptr);
+}
+
+// readers take a zero pointer to mean none, before applying pc-relative or other bases.
+bool write_pointer(eh_section_writer_t &out, const uint8_t encoding, const uint64_t value)
+{
+	return out.write_encoded(value==0 ? (encoding & 0x0f) : encoding, value);
+}
+
+bool write_cie(eh_section_writer_t &out, const EHPModelCIE_t &cie)
+{
+	const auto record=out.getPosition();
+	out.write_type(uint32_t(0));	// length, patched below
+	out.write_type(uint32_t(0));	// CIE id
+	out.write_type(cie.version);
+	out.write_string(cie.augmentation);
+	out.write_uleb128(cie.code_alignment_factor);
+	out.write_sleb128(cie.data_alignment_factor);
+	if(cie.version==1)
+	{
+		if(cie.return_register > numeric_limits<uint8_t>::max())
+			return true;
+		out.write_type(static_cast<uint8_t>(cie.return_register));
+	}
+	else if(cie.version==3)
+		out.write_uleb128(cie.return_register);
+	else
+		return true;
+
+	if(!cie.augmentation.empty())
+	{
+		if(cie.augmentation[0]!='z')
+			return true;
+		const auto length_position=out.getPosition();
+		out.write_type(uint8_t(0));	// augmentation data length, patched below; always under 128
+		const auto data_start=out.getPosition();
+		for(auto i=size_t(1); i < cie.augmentation.size(); i++)
+		{
+			switch(cie.augmentation[i])
+			{
+				case 'P':
+					out.write_type(cie.personality_encoding);
+					if(write_pointer(out, cie.personality_encoding, cie.personality))
+						return true;
+					break;
+				case 'L':
+					out.write_type(cie.lsda_encoding);
+					break;
+				case 'R':
+					out.write_type(cie.fde_encoding);
+					break;
+				case 'S':	// signal frame
+				case 'B':	// aarch64 pointer authentication with the B key
+				case 'G':	// aarch64 memory tagging
+					break;
+				default:
+					return true;
+			}
+		}
+		out.patch_type(length_position, static_cast<uint8_t>(out.getPosition()-data_start));
+	}
+
+	// records are padded to 4 bytes, as the GNU tools write them.
+	out.write_bytes(cie.program.data(), cie.program.size());
+	out.pad(record, 4);
+	const auto length=out.getPosition()-record-sizeof(uint32_t);
+	if(length >= numeric_limits<uint32_t>::max())
+		return true;
+	out.patch_type(record, static_cast<uint32_t>(length));
+	return false;
+}
+
+// the action records of every call site's chain, and each call site's action field: 0 for no 
+// chain, else one more than the offset of its chain.  a chain ending in records already written 
+// links to them, so identical chains and common tails are written once.  longer chains go first
+// so the shorter ones find their tails.
+void build_action_table(const EHPModelLSDA_t &lsda, const uint8_t ptrsize, vector<uint8_t> &table, vector<uint64_t> &cs_actions)
+{
+	auto order=vector<size_t>(lsda.call_sites.size());
+	iota(order.begin(), order.end(), 0);
+	stable_sort(order.begin(), order.end(), [&](const size_t a, const size_t b)
+		{
+			return lsda.call_sites[a].actions.size() > lsda.call_sites[b].actions.size();
+		});
+
+	auto tail_offsets=map<vector<int64_t>, uint64_t>();
+	cs_actions.assign(lsda.call_sites.size(), 0);
+	for(const auto i : order)
+	{
+		const auto &actions=lsda.call_sites[i].actions;
+		if(actions.empty())
+			continue;
+
+		// the longest tail already in the table, if any.
+		auto shared=actions.size();
+		auto shared_offset=uint64_t(0);
+		for(auto j=size_t(0); j < actions.size(); j++)
+		{
+			const auto it=tail_offsets.find(vector<int64_t>(actions.begin()+j, actions.end()));
+			if(it!=tail_offsets.end())
+			{
+				shared=j;
+				shared_offset=it->second;
+				break;
+			}
+		}
+
+		// each record is a filter and the displacement from there to the next record.  the next 
+		// record follows directly (a displacement of 1), except that the last one written 
+		// links back to the shared tail, or ends the chain with 0.
+		const auto chain_offset=table.size();
+		table.resize(chain_offset + shared*20);
+		auto out=eh_section_writer_t(table.data(), 0, chain_offset, ptrsize, false);
+		for(auto j=size_t(0); j < shared; j++)
+		{
+			const auto offset=out.getPosition();
+			tail_offsets[vector<int64_t>(actions.begin()+j, actions.end())]=offset;
+			if(j==0)
+				cs_actions[i]=offset+1;
+			out.write_sleb128(actions[j]);
+			if(j+1 < shared)
+				out.write_sleb128(1);
+			else if(shared < actions.size())
+				out.write_sleb128(static_cast<int64_t>(shared_offset)-static_cast<int64_t>(out.getPosition()));
+			else
+				out.write_sleb128(0);
+		}
+		table.resize(out.getPosition());
+		if(shared==0)
+			cs_actions[i]=shared_offset+1;
+	}
+}
+
+bool write_lsda(eh_section_writer_t &out, const EHPModelLSDA_t &lsda, const uint64_t fde_start, const uint8_t ptrsize)
+{
+	const auto base = lsda.landing_pad_base_encoding==DW_EH_PE_omit ? fde_start : lsda.landing_pad_base;
+	const auto has_type_table = lsda.type_table_encoding!=DW_EH_PE_omit;
+	const auto entry_size = has_type_table ? encoded_size(lsda.type_table_encoding, ptrsize) : 0;
+
+	// call sites are offsets, type table entries must have a fixed size, and filters must name 
+	// an entry or a specification.
+	if((lsda.call_site_encoding & 0x70)!=0)
+		return true;
+	if(has_type_table ? entry_size==0 : (!lsda.type_table.empty() || !lsda.exception_specs.empty()))
+		return true;
+	for(const auto &cs : lsda.call_sites)
+	{
+		for(const auto filter : cs.actions)
+		{
+			if(filter > 0 && uint64_t(filter) > lsda.type_table.size())
+				return true;
+			if(filter < 0 && uint64_t(-(filter+1)) >= lsda.exception_specs.size())
+				return true;
+		}
+	}
+
+	auto actions=vector<uint8_t>();
+	auto cs_actions=vector<uint64_t>();
+	build_action_table(lsda, ptrsize, actions, cs_actions);
+
+	const auto write_call_sites=[&](eh_section_writer_t &cs_out) -> bool
+	{
+		for(auto i=size_t(0); i < lsda.call_sites.size(); i++)
+		{
+			const auto &cs=lsda.call_sites[i];
+			// a landing pad at offset 0 would read as none.
+			if(cs.start < base || cs.end < cs.start || (cs.landing_pad!=0 && cs.landing_pad <= base))
+				return true;
+			if(cs_out.write_encoded(lsda.call_site_encoding, cs.start-base) || 
+			   cs_out.write_encoded(lsda.call_site_encoding, cs.end-cs.start) ||
+			   cs_out.write_encoded(lsda.call_site_encoding, cs.landing_pad==0 ? 0 : cs.landing_pad-base))
+				return true;
+			cs_out.write_uleb128(cs_actions[i]);
+		}
+		return false;
+	};
+	auto cs_sizer=eh_section_writer_t(nullptr, 0, 0, ptrsize, false);
+	if(write_call_sites(cs_sizer))
+		return true;
+	const auto cs_length=cs_sizer.getPosition();
+
+	out.write_type(lsda.landing_pad_base_encoding);
+	if(lsda.landing_pad_base_encoding!=DW_EH_PE_omit && write_pointer(out, lsda.landing_pad_base_encoding, lsda.landing_pad_base))
+		return true;
+	out.write_type(lsda.type_table_encoding);
+	if(has_type_table)
+	{
+		// the type table base is aligned for its entries.  the offset to it is a uleb128 whose 
+		// size moves the base, so take the first size that holds the offset, padding the uleb128.
+		const auto rest=1+eh_section_writer_t::uleb128_size(cs_length)+cs_length+actions.size()+lsda.type_table.size()*entry_size;
+		for(auto size=size_t(1); ; size++)
+		{
+			const auto unaligned_base=out.getAddress()+size+rest;
+			const auto padding=(entry_size - unaligned_base%entry_size) % entry_size;
+			if(eh_section_writer_t::uleb128_size(rest+padding) <= size)
+			{
+				out.write_uleb128(rest+padding, size);
+				break;
+			}
+		}
+	}
+	out.write_type(lsda.call_site_encoding);
+	out.write_uleb128(cs_length);
+	write_call_sites(out);
+	out.write_bytes(actions.data(), actions.size());
+	if(has_type_table)
+	{
+		out.align(entry_size);
+		// filter i names the i-th entry below the base.
+		for(auto i=lsda.type_table.size(); i > 0; i--)
+		{
+			if(write_pointer(out, lsda.type_table_encoding, lsda.type_table[i-1]))
+				return true;
+		}
+		out.write_bytes(lsda.exception_specs.data(), lsda.exception_specs.size());
+	}
+	return false;
+}
+
+// what write_lsda's output depends on besides its address: call sites relative to their base, 
+// which is not written when it is the FDE's start.
+vector<uint64_t> lsda_key(const EHPModelLSDA_t &lsda, const uint64_t fde_start)
+{
+	const auto omit_base = lsda.landing_pad_base_encoding==DW_EH_PE_omit;
+	const auto base = omit_base ? fde_start : lsda.landing_pad_base;
+	auto key=vector<uint64_t>();
+	key.push_back(lsda.landing_pad_base_encoding);
+	key.push_back(omit_base ? 0 : lsda.landing_pad_base);
+	key.push_back(lsda.call_site_encoding);
+	key.push_back(lsda.type_table_encoding);
+	key.push_back(lsda.call_sites.size());
+	for(const auto &cs : lsda.call_sites)
+	{
+		key.push_back(cs.start-base);
+		key.push_back(cs.end-cs.start);
+		key.push_back(cs.landing_pad==0 ? 0 : cs.landing_pad-base);
+		key.push_back(cs.actions.size());
+		key.insert(key.end(), cs.actions.begin(), cs.actions.end());
+	}
+	key.push_back(lsda.type_table.size());
+	key.insert(key.end(), lsda.type_table.begin(), lsda.type_table.end());
+	key.insert(key.end(), lsda.exception_specs.begin(), lsda.exception_specs.end());
+	return key;
+}
+
+bool write_fde(eh_section_writer_t &out, const EHPModelFDE_t &fde, const EHPModelCIE_t &cie, const uint64_t cie_address, const uint64_t lsda_address)
+{
+	const auto record=out.getPosition();
+	out.write_type(uint32_t(0));	// length, patched below
+	// the CIE pointer is the distance back to the CIE.
+	if(cie_address > out.getAddress() || out.getAddress()-cie_address > numeric_limits<uint32_t>::max())
+		return true;
+	out.write_type(static_cast<uint32_t>(out.getAddress()-cie_address));
+
+	const auto encoding=fde_encoding(cie);
+	if(fde.end < fde.start)
+		return true;
+	if(out.write_encoded(encoding, fde.start) || out.write_encoded(encoding & 0x0f, fde.end-fde.start))
+		return true;
+
+	if(fde.has_lsda && !has_augmentation(cie, 'L'))
+		return true;
+	if(!cie.augmentation.empty())
+	{
+		const auto length_position=out.getPosition();
+		out.write_type(uint8_t(0));	// augmentation data length, patched below
+		const auto data_start=out.getPosition();
+		if(has_augmentation(cie, 'L') && write_pointer(out, cie.lsda_encoding, lsda_address))
+			return true;
+		out.patch_type(length_position, static_cast<uint8_t>(out.getPosition()-data_start));
+	}
+
+	out.write_bytes(fde.program.data(), fde.program.size());
+	out.pad(record, 4);
+	const auto length=out.getPosition()-record-sizeof(uint32_t);
+	if(length >= numeric_limits<uint32_t>::max())
+		return true;
+	out.patch_type(record, static_cast<uint32_t>(length));
+	return false;
+}
+
+}
+
+void EHP::build_model(const EHFrameParser_t &parser, const image_contents_t &contents, EHPSectionModel_t &model)
+{
+	model.ptrsize=contents.ptrsize;
+	model.is_be=contents.is_be;
+	model.cies.clear();
+	auto cie_index=unordered_map<uint64_t, uint64_t>();
+	for(const auto cie : *parser.getCIEs())
+	{
+		cie_index[cie->getPosition()]=model.cies.size();
+		model.cies.push_back(model_cie(*cie));
+	}
+
+	// each chunk copies its FDEs into their own slots.
+	const auto &fdes=*parser.getFDEs();
+	model.fdes.assign(fdes.size(), EHPModelFDE_t());
+	parallel_for_chunks(fdes.size(), parallel_chunk_count(fdes.size()), [&](const size_t, const size_t begin, const size_t end)
+		{
+			for(auto i=begin; i < end; i++)
+			{
+				const auto &fde=*fdes[i];
+				auto &m=model.fdes[i];
+				// a CIE the parser did not list is left out of range, for encode to report.
+				const auto it=cie_index.find(fde.getCIE().getPosition());
+				m.cie = it==cie_index.end() ? model.cies.size() : it->second;
+				m.start=fde.getStartAddress();
+				m.end=fde.getEndAddress();
+				copy_program(fde.getProgram(), m.program);
+				m.has_lsda = fde.getLSDAAddress()!=0;
+				if(m.has_lsda)
+					model_lsda(*fde.getLSDA(), contents.gcc_except_table, m.lsda);
+			}
+		});
+}
+
+bool EHP::encode_sections(const EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, EHPEncodedSections_t &sections)
+{
+	const auto ptrsize=model.ptrsize;
+	const auto is_be=model.is_be;
+	const auto &cies=model.cies;
+	const auto &fdes=model.fdes;
+	const auto fail=[&](const EHPEncodeErrorKind_t kind, const uint64_t index) 
+	{ 
+		sections.error={kind, index}; 
+		return true; 
+	};
+	if(ptrsize!=4 && ptrsize!=8)
+		return fail(ENCODE_ERROR_CIE, 0);
+
+	// size every record in layout order to place it.  sizes depend only on the model and the 
+	// addresses, so the write pass below puts each record exactly where it was sized.
+	// LSDAs come first since FDEs point at them.
+	// FDEs whose LSDAs would encode the same share the first one.
+	auto gcc_sizer=eh_section_writer_t(nullptr, addresses.gcc_except_table_addr, 0, ptrsize, is_be);
+	auto lsda_positions=vector<uint64_t>(fdes.size());
+	auto lsda_owners=vector<size_t>(fdes.size());
+	auto lsda_by_key=map<vector<uint64_t>, size_t>();
+	sections.lsda_addresses.assign(fdes.size(), 0);
+	for(auto i=size_t(0); i < fdes.size(); i++)
+	{
+		if(!fdes[i].has_lsda)
+			continue;
+		const auto owner=lsda_by_key.insert({lsda_key(fdes[i].lsda, fdes[i].start), i}).first->second;
+		lsda_owners[i]=owner;
+		if(owner!=i)
+		{
+			lsda_positions[i]=lsda_positions[owner];
+			sections.lsda_addresses[i]=sections.lsda_addresses[owner];
+			continue;
+		}
+		gcc_sizer.align(4);
+		lsda_positions[i]=gcc_sizer.getPosition();
+		sections.lsda_addresses[i]=gcc_sizer.getAddress();
+		if(write_lsda(gcc_sizer, fdes[i].lsda, fdes[i].start, ptrsize))
+			return fail(ENCODE_ERROR_FDE, i);
+	}
+
+	auto eh_sizer=eh_section_writer_t(nullptr, addresses.eh_frame_addr, 0, ptrsize, is_be);
+	sections.cie_addresses.resize(cies.size());
+	for(auto i=size_t(0); i < cies.size(); i++)
+	{
+		sections.cie_addresses[i]=eh_sizer.getAddress();
+		if(write_cie(eh_sizer, cies[i]))
+			return fail(ENCODE_ERROR_CIE, i);
+	}
+	auto fde_positions=vector<uint64_t>(fdes.size());
+	sections.fde_addresses.resize(fdes.size());
+	for(auto i=size_t(0); i < fdes.size(); i++)
+	{
+		fde_positions[i]=eh_sizer.getPosition();
+		sections.fde_addresses[i]=eh_sizer.getAddress();
+		if(fdes[i].cie >= cies.size() || write_fde(eh_sizer, fdes[i], cies[fdes[i].cie], sections.cie_addresses[fdes[i].cie], sections.lsda_addresses[i]))
+			return fail(ENCODE_ERROR_FDE, i);
+	}
+	eh_sizer.write_type(uint32_t(0));	// terminator
+
+	// .eh_frame_hdr, sorted by start address.
+	auto order=vector<uint64_t>(fdes.size());
+	iota(order.begin(), order.end(), 0);
+	const auto by_start=[&](const uint64_t a, const uint64_t b) { return fdes[a].start < fdes[b].start; };
+	if(!is_sorted(order.begin(), order.end(), by_start))
+		stable_sort(order.begin(), order.end(), by_start);
+	auto table=EHPSearchTable_t();
+	table.reserve(fdes.size());
+	for(const auto i : order)
+		table.push_back({fdes[i].start, sections.fde_addresses[i]});
+	auto failed_entry=uint64_t(0);
+	if(encode_search_table(ptrsize, is_be, table, addresses.eh_frame_addr, addresses.eh_frame_hdr_addr, sections.eh_frame_hdr, failed_entry))
+		return fail(ENCODE_ERROR_HDR, failed_entry < order.size() ? order[failed_entry] : fdes.size());
+
+	// nothing can fail from here.  every FDE and LSDA is written at its own position, so 
+	// chunks of them are written concurrently.
+	sections.gcc_except_table.assign(gcc_sizer.getPosition(), '\0');
+	sections.eh_frame.assign(eh_sizer.getPosition(), '\0');
+	const auto gcc_data=reinterpret_cast<uint8_t*>(&sections.gcc_except_table[0]);
+	const auto eh_data=reinterpret_cast<uint8_t*>(&sections.eh_frame[0]);
+	auto cie_out=eh_section_writer_t(eh_data, addresses.eh_frame_addr, 0, ptrsize, is_be);
+	for(const auto &cie : cies)
+		write_cie(cie_out, cie);
+	parallel_for_chunks(fdes.size(), parallel_chunk_count(fdes.size()), [&](const size_t, const size_t begin, const size_t end)
+		{
+			for(auto i=begin; i < end; i++)
+			{
+				const auto &fde=fdes[i];
+				if(fde.has_lsda && lsda_owners[i]==i)
+				{
+					auto lsda_out=eh_section_writer_t(gcc_data, addresses.gcc_except_table_addr, lsda_positions[i], ptrsize, is_be);
+					write_lsda(lsda_out, fde.lsda, fde.start, ptrsize);
+				}
+				auto fde_out=eh_section_writer_t(eh_data, addresses.eh_frame_addr, fde_positions[i], ptrsize, is_be);
+				write_fde(fde_out, fde, cies[fde.cie], sections.cie_addresses[fde.cie], sections.lsda_addresses[i]);
+			}
+		});
+	return false;
+}
+
+bool EHP::encode_search_table(const uint8_t ptrsize, const bool is_be, const EHPSearchTable_t &table, const uint64_t eh_frame_addr, const uint64_t eh_frame_hdr_addr, string &eh_frame_hdr, uint64_t &failed_entry)
+{
+	// a pointer to .eh_frame, the entry count, then the entries relative to the header.
+	failed_entry=table.size();
+	if(table.size() > numeric_limits<uint32_t>::max())
+		return true;
+	eh_frame_hdr.assign(4+4+4+table.size()*8, '\0');
+	auto hdr=eh_section_writer_t(reinterpret_cast<uint8_t*>(&eh_frame_hdr[0]), eh_frame_hdr_addr, 0, ptrsize, is_be);
+	hdr.setDataBase(eh_frame_hdr_addr);
+	hdr.write_type(uint8_t(1));	// version
+	hdr.write_type(uint8_t(DW_EH_PE_pcrel | DW_EH_PE_sdata4));
+	hdr.write_type(uint8_t(DW_EH_PE_udata4));
+	hdr.write_type(uint8_t(DW_EH_PE_datarel | DW_EH_PE_sdata4));
+	if(hdr.write_encoded(DW_EH_PE_pcrel | DW_EH_PE_sdata4, eh_frame_addr))
+		return true;
+	hdr.write_encoded(DW_EH_PE_udata4, table.size());
+	for(auto i=size_t(0); i < table.size(); i++)
+	{
+		if(hdr.write_encoded(DW_EH_PE_datarel | DW_EH_PE_sdata4, table[i].initial_location) || 
+		   hdr.write_encoded(DW_EH_PE_datarel | DW_EH_PE_sdata4, table[i].fde_address))
+		{
+			failed_entry=i;
+			return true;
+		}
+	}
+	return false;
+}
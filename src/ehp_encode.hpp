@@ -0,0 +1,124 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_encode_hpp
+#define ehp_encode_hpp
+
+#include <stdint.h>
+#include <string>
+
+#include <ehp.hpp>
+#include "ehp_image.hpp"
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// Writes the fields of a section at a position.  Without a buffer it only advances the position,
+// so the same code first sizes records and then writes them.
+class eh_section_writer_t
+{
+	private:
+
+	uint8_t* data;
+	uint64_t section_addr;
+	uint64_t position;
+	uint8_t ptrsize;
+	bool is_be;
+	bool has_data_base;
+	uint64_t data_base;
+
+	public:
+
+	eh_section_writer_t(uint8_t* p_data, const uint64_t p_section_addr, const uint64_t p_position, const uint8_t p_ptrsize, const bool p_is_be)
+		:
+			data(p_data),
+			section_addr(p_section_addr),
+			position(p_position),
+			ptrsize(p_ptrsize),
+			is_be(p_is_be),
+			has_data_base(false),
+			data_base(0)
+	{
+	}
+
+	uint64_t getPosition() const { return position; }
+	uint64_t getAddress() const { return section_addr+position; }
+
+	// what DW_EH_PE_datarel is relative to.  without one, datarel cannot be written.
+	void setDataBase(const uint64_t base) { data_base=base; has_data_base=true; }
+
+	template <class T>
+	void write_type(const T value) 
+	{ 
+		if(data)
+			store(position, value);
+		position+=sizeof(T);
+	}
+
+	template <class T>
+	void patch_type(const uint64_t at, const T value) 
+	{ 
+		if(data)
+			store(at, value);
+	}
+
+	void write_bytes(const uint8_t* const bytes, const size_t size);
+	void write_string(const string &s);	// with its NUL
+	void write_uleb128(const uint64_t value, const size_t min_size=1);	// padded out to min_size bytes
+	void write_sleb128(const int64_t value, const size_t min_size=1);	// padded out to min_size bytes
+	void pad(const uint64_t record_start, const uint64_t alignment);	// with zeros, which are also DW_CFA_nop
+	void align(const uint64_t alignment);	// the address, with zeros
+
+	// write value with encoding (DW_EH_PE_*, indirect ignored), padding leb128 values out to 
+	// leb128_size bytes.  true if the encoding is not supported or the value does not fit.
+	bool write_encoded(const uint8_t encoding, const uint64_t value, const size_t leb128_size=1);
+
+	static size_t uleb128_size(uint64_t value);
+	static size_t sleb128_size(int64_t value);
+
+	private:
+
+	template <class T>
+	void store(const uint64_t at, const T value)
+	{
+		for(auto i=size_t(0); i < sizeof(T); i++)
+			data[at + (is_be ? sizeof(T)-1-i : i)] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (8*i));
+	}
+};
+
+// the size of a fixed-size encoding's values, 0 for leb128 ones.
+uint64_t encoded_size(const uint8_t encoding, const uint8_t ptrsize);
+
+void build_model(const EHFrameParser_t &parser, const image_contents_t &contents, EHPSectionModel_t &model);
+
+// returns true, with sections.error set, if model cannot be encoded.
+bool encode_sections(const EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, EHPEncodedSections_t &sections);
+
+// write table as an .eh_frame_hdr with 4-byte entries relative to the header.  returns true if 
+// something does not fit, with failed_entry the index of the entry, or table.size() for the header.
+bool encode_search_table(const uint8_t ptrsize, const bool is_be, const EHPSearchTable_t &table, const uint64_t eh_frame_addr, const uint64_t eh_frame_hdr_addr, string &eh_frame_hdr, uint64_t &failed_entry);
+
+}
+#endif
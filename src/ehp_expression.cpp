@@ -0,0 +1,185 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <ehp.hpp>
+#include "ehp_priv.hpp"
+#include "ehp_expression.hpp"
+
+using namespace std;
+using namespace EHP;
+
+bool EHP::compile_expression(
+	const uint8_t* const begin, 
+	const uint8_t* const end, 
+	const bool is_be, 
+	const uint8_t ptrsize, 
+	EHPExpressionOpVector_t &ops
+	)
+{
+	ops.clear();
+	auto cursor=eh_record_cursor_t(begin, 0, end-begin, is_be);
+
+	// byte offset of each op, and the byte offset each branch goes to.
+	auto op_offsets=vector<uint64_t>();
+	auto branch_offsets=vector<uint64_t>();
+
+	const auto read_const=[&](const uint8_t size, const bool is_signed, uint64_t &value) -> bool
+	{
+		switch(size)
+		{
+			case 1: 
+			{
+				auto v=uint8_t(0);
+				if(cursor.read_type(v)) return true;
+				value = is_signed ? static_cast<uint64_t>(static_cast<int8_t>(v)) : v;
+				return false;
+			}
+			case 2: 
+			{
+				auto v=uint16_t(0);
+				if(cursor.read_type(v)) return true;
+				value = is_signed ? static_cast<uint64_t>(static_cast<int16_t>(v)) : v;
+				return false;
+			}
+			case 4: 
+			{
+				auto v=uint32_t(0);
+				if(cursor.read_type(v)) return true;
+				value = is_signed ? static_cast<uint64_t>(static_cast<int32_t>(v)) : v;
+				return false;
+			}
+			case 8: 
+				return cursor.read_type(value);
+		}
+		return true;
+	};
+
+	while(cursor.remaining() > 0)
+	{
+		op_offsets.push_back(cursor.getPosition());
+
+		auto op=EHPExpressionOp_t({0, 0, 0});
+		auto opcode=uint8_t(0);
+		cursor.read_type(opcode);
+		op.opcode=opcode;
+
+		auto err=false;
+		if(opcode >= DW_OP_lit0 && opcode <= DW_OP_lit31)
+		{
+			op.operand1=opcode-DW_OP_lit0;
+		}
+		else if(opcode >= DW_OP_breg0 && opcode <= DW_OP_breg31)
+		{
+			op.operand1=opcode-DW_OP_breg0;
+			err=cursor.read_sleb128(op.operand2);
+		}
+		else switch(opcode)
+		{
+			case DW_OP_addr:     err=read_const(ptrsize, false, op.operand1); break;
+			case DW_OP_const1u:  err=read_const(1, false, op.operand1); break;
+			case DW_OP_const1s:  err=read_const(1, true,  op.operand1); break;
+			case DW_OP_const2u:  err=read_const(2, false, op.operand1); break;
+			case DW_OP_const2s:  err=read_const(2, true,  op.operand1); break;
+			case DW_OP_const4u:  err=read_const(4, false, op.operand1); break;
+			case DW_OP_const4s:  err=read_const(4, true,  op.operand1); break;
+			case DW_OP_const8u:  
+			case DW_OP_const8s:  err=read_const(8, false, op.operand1); break;
+			case DW_OP_constu:   
+			case DW_OP_plus_uconst:
+				err=cursor.read_uleb128(op.operand1); 
+				break;
+			case DW_OP_consts:   
+			{
+				auto sleb=int64_t(0);
+				err=cursor.read_sleb128(sleb);
+				op.operand1=static_cast<uint64_t>(sleb);
+				break;
+			}
+			case DW_OP_pick:
+			{
+				auto index=uint8_t(0);
+				err=cursor.read_type(index);
+				op.operand1=index;
+				break;
+			}
+			case DW_OP_deref_size:
+			{
+				auto size=uint8_t(0);
+				err=cursor.read_type(size) || (size!=1 && size!=2 && size!=4 && size!=8) || size > ptrsize;
+				op.operand1=size;
+				break;
+			}
+			case DW_OP_bregx:
+				err=cursor.read_uleb128(op.operand1) || cursor.read_sleb128(op.operand2);
+				break;
+			case DW_OP_skip:
+			case DW_OP_bra:
+			{
+				// the target is relative to the end of this op.
+				auto delta=int16_t(0);
+				err=cursor.read_type(delta);
+				const auto target=static_cast<int64_t>(cursor.getPosition())+delta;
+				err = err || target < 0 || static_cast<uint64_t>(target) > cursor.getEnd();
+				op.operand1=branch_offsets.size();
+				branch_offsets.push_back(static_cast<uint64_t>(target));
+				break;
+			}
+			case DW_OP_deref:
+			case DW_OP_dup: case DW_OP_drop: case DW_OP_over: case DW_OP_swap: case DW_OP_rot:
+			case DW_OP_abs: case DW_OP_and: case DW_OP_div: case DW_OP_minus: case DW_OP_mod:
+			case DW_OP_mul: case DW_OP_neg: case DW_OP_not: case DW_OP_or: case DW_OP_plus:
+			case DW_OP_shl: case DW_OP_shr: case DW_OP_shra: case DW_OP_xor:
+			case DW_OP_eq: case DW_OP_ge: case DW_OP_gt: case DW_OP_le: case DW_OP_lt: case DW_OP_ne:
+			case DW_OP_nop:
+				break;
+			default:
+				// DW_OP_reg*, DW_OP_regx, DW_OP_fbreg, DW_OP_piece, DW_OP_xderef*, vendor ops.
+				err=true;
+				break;
+		}
+		if(err)
+		{
+			ops.clear();
+			return true;
+		}
+		ops.push_back(op);
+	}
+	if(ops.size()==0)
+		return true;
+
+	// resolve branch targets, which must land on the start of an op (or the end of the expression).
+	op_offsets.push_back(cursor.getEnd());
+	for(auto &op : ops)
+	{
+		if(op.opcode!=DW_OP_skip && op.opcode!=DW_OP_bra)
+			continue;
+		const auto target=branch_offsets[op.operand1];
+		const auto it=lower_bound(op_offsets.begin(), op_offsets.end(), target);
+		if(it==op_offsets.end() || *it!=target)
+		{
+			ops.clear();
+			return true;
+		}
+		op.operand1=static_cast<uint64_t>(it-op_offsets.begin());
+	}
+	return false;
+}
@@ -0,0 +1,260 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_expression_hpp
+#define ehp_expression_hpp
+
+#include <stdint.h>
+#include <algorithm>
+#include <limits>
+
+#include <ehp.hpp>
+#include "ehp_dwarf2.hpp"
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// Decode and validate the DW_OP_* expression in [begin, end).  Branch targets are resolved 
+// to op indexes so evaluation never has to decode.  Ops that describe locations rather than 
+// values (DW_OP_reg*, DW_OP_piece, ...) cannot appear in CFI and are rejected.
+bool compile_expression(
+	const uint8_t* const begin, 
+	const uint8_t* const end, 
+	const bool is_be, 
+	const uint8_t ptrsize, 
+	EHPExpressionOpVector_t &ops
+	);
+
+// Evaluate a compiled expression on a fixed-size stack, without allocating.  If push_initial,
+// initial is pushed first (the CFA, for register rules).  read_value(addr, size, value) reads 
+// target memory and returns true on error.  Registers that are not valid, stack over/underflow,
+// division by zero and runaway loops are errors.
+template <class reader_t>
+bool evaluate_expression(
+	const EHPExpressionOpVector_t &ops, 
+	const EHPRegisterSet_t &regs, 
+	const bool push_initial, 
+	const uint64_t initial, 
+	const uint8_t ptrsize,
+	const reader_t &read_value,
+	uint64_t &result
+	)
+{
+	static const auto max_stack=size_t(64);
+	static const auto max_steps=size_t(4096);
+
+	if(ops.size()==0)
+		return true;
+
+	uint64_t stack[max_stack];
+	auto depth=size_t(0);
+	const auto push=[&](const uint64_t value) -> bool
+	{
+		if(depth==max_stack)
+			return true;
+		stack[depth++]=value;
+		return false;
+	};
+	const auto address_mask = ptrsize==4 ? uint64_t(0xffffffff) : ~uint64_t(0);
+
+	if(push_initial)
+		push(initial);
+
+	auto steps=size_t(0);
+	auto pc=size_t(0);
+	while(pc < ops.size())
+	{
+		if(++steps > max_steps)
+			return true;
+
+		const auto &op=ops[pc++];
+		const auto opcode=op.opcode;
+
+		if(opcode >= DW_OP_lit0 && opcode <= DW_OP_lit31)
+		{
+			if(push(opcode-DW_OP_lit0))
+				return true;
+			continue;
+		}
+		if((opcode >= DW_OP_breg0 && opcode <= DW_OP_breg31) || opcode==DW_OP_bregx)
+		{
+			const auto reg=op.operand1;
+			if(reg >= EHP_UNWIND_REGISTER_COUNT || !regs.valid[reg])
+				return true;
+			if(push(regs.regs[reg]+op.operand2))
+				return true;
+			continue;
+		}
+
+		switch(opcode)
+		{
+			case DW_OP_addr:
+			case DW_OP_const1u: case DW_OP_const1s:
+			case DW_OP_const2u: case DW_OP_const2s:
+			case DW_OP_const4u: case DW_OP_const4s:
+			case DW_OP_const8u: case DW_OP_const8s:
+			case DW_OP_constu: case DW_OP_consts:
+				if(push(op.operand1))
+					return true;
+				continue;
+			case DW_OP_nop:
+				continue;
+			case DW_OP_skip:
+				pc=op.operand1;
+				continue;
+			default:
+				break;
+		}
+
+		// everything else operates on the stack, check the operands it needs are there.
+		auto needed=size_t(1);
+		switch(opcode)
+		{
+			case DW_OP_over: case DW_OP_swap: case DW_OP_and: case DW_OP_div: case DW_OP_minus: 
+			case DW_OP_mod: case DW_OP_mul: case DW_OP_or: case DW_OP_plus: case DW_OP_shl: 
+			case DW_OP_shr: case DW_OP_shra: case DW_OP_xor: case DW_OP_eq: case DW_OP_ge: 
+			case DW_OP_gt: case DW_OP_le: case DW_OP_lt: case DW_OP_ne:
+				needed=2; break;
+			case DW_OP_rot:
+				needed=3; break;
+			case DW_OP_pick:
+				needed=op.operand1+1; break;
+			default:
+				break;
+		}
+		if(depth < needed)
+			return true;
+
+		auto &top=stack[depth-1];
+		const auto stop=static_cast<int64_t>(top);
+		switch(opcode)
+		{
+			case DW_OP_dup:
+				if(push(top))
+					return true;
+				break;
+			case DW_OP_drop:
+				depth--;
+				break;
+			case DW_OP_over:
+				if(push(stack[depth-2]))
+					return true;
+				break;
+			case DW_OP_pick:
+				if(push(stack[depth-1-op.operand1]))
+					return true;
+				break;
+			case DW_OP_swap:
+				swap(stack[depth-1], stack[depth-2]);
+				break;
+			case DW_OP_rot:
+			{
+				const auto tmp=stack[depth-1];
+				stack[depth-1]=stack[depth-2];
+				stack[depth-2]=stack[depth-3];
+				stack[depth-3]=tmp;
+				break;
+			}
+			case DW_OP_deref:
+			case DW_OP_deref_size:
+			{
+				const auto size = opcode==DW_OP_deref ? ptrsize : static_cast<uint8_t>(op.operand1);
+				auto value=uint64_t(0);
+				if(read_value(top & address_mask, size, value))
+					return true;
+				top=value;
+				break;
+			}
+			case DW_OP_abs:
+				top = stop < 0 ? static_cast<uint64_t>(-stop) : top;
+				break;
+			case DW_OP_neg:
+				top = static_cast<uint64_t>(-stop);
+				break;
+			case DW_OP_not:
+				top = ~top;
+				break;
+			case DW_OP_plus_uconst:
+				top += op.operand1;
+				break;
+			case DW_OP_bra:
+				depth--;
+				if(stack[depth]!=0)
+					pc=op.operand1;
+				break;
+			default:
+			{
+				// binary operators: second is the entry below the top.
+				const auto first=stack[depth-1];
+				const auto second=stack[depth-2];
+				const auto sfirst=static_cast<int64_t>(first);
+				const auto ssecond=static_cast<int64_t>(second);
+				auto value=uint64_t(0);
+				switch(opcode)
+				{
+					case DW_OP_and:   value = second & first; break;
+					case DW_OP_or:    value = second | first; break;
+					case DW_OP_xor:   value = second ^ first; break;
+					case DW_OP_plus:  value = second + first; break;
+					case DW_OP_minus: value = second - first; break;
+					case DW_OP_mul:   value = second * first; break;
+					case DW_OP_shl:   value = first < 64 ? second << first : 0; break;
+					case DW_OP_shr:   value = first < 64 ? second >> first : 0; break;
+					case DW_OP_shra:  value = static_cast<uint64_t>(ssecond >> (first < 64 ? first : 63)); break;
+					case DW_OP_div:   
+						if(first==0 || (sfirst==-1 && ssecond==numeric_limits<int64_t>::min()))
+							return true;
+						value = static_cast<uint64_t>(ssecond / sfirst); 
+						break;
+					case DW_OP_mod:   
+						if(first==0)
+							return true;
+						value = second % first; 
+						break;
+					case DW_OP_eq:    value = ssecond == sfirst; break;
+					case DW_OP_ne:    value = ssecond != sfirst; break;
+					case DW_OP_lt:    value = ssecond <  sfirst; break;
+					case DW_OP_le:    value = ssecond <= sfirst; break;
+					case DW_OP_gt:    value = ssecond >  sfirst; break;
+					case DW_OP_ge:    value = ssecond >= sfirst; break;
+					default:
+						// compile_expression admits nothing else.
+						return true;
+				}
+				depth--;
+				stack[depth-1]=value;
+				break;
+			}
+		}
+	}
+
+	if(depth==0)
+		return true;
+	result=stack[depth-1] & address_mask;
+	return false;
+}
+
+}
+#endif
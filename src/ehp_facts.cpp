@@ -0,0 +1,366 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+
+#include <ehp.hpp>
+#include "ehp_facts.hpp"
+#include "ehp_output.hpp"
+#include "ehp_parallel.hpp"
+
+using namespace std;
+using namespace EHP;
+
+namespace
+{
+
+struct fact_column_spec_t
+{
+	const char* name;
+	EHPFactColumnType_t type;
+};
+
+struct fact_relation_spec_t
+{
+	const char* name;
+	vector<fact_column_spec_t> columns;
+};
+
+// indexed by EHPFactRelationKind_t.  keep in step with the list in ehp.hpp and bump 
+// EHP_FACT_SCHEMA_VERSION when this changes.
+const fact_relation_spec_t schema[FACT_RELATION_COUNT]=
+{
+	{ "cie", { 
+		{ "position", FACT_UNSIGNED }, 
+		{ "length", FACT_UNSIGNED }, 
+		{ "augmentation", FACT_STRING }, 
+		{ "code_alignment_factor", FACT_UNSIGNED }, 
+		{ "data_alignment_factor", FACT_SIGNED }, 
+		{ "return_register", FACT_UNSIGNED }, 
+		{ "personality", FACT_UNSIGNED }, 
+		{ "personality_encoding", FACT_UNSIGNED }, 
+		{ "personality_position", FACT_UNSIGNED }, 
+		{ "lsda_encoding", FACT_UNSIGNED }, 
+		{ "fde_encoding", FACT_UNSIGNED } 
+	} },
+	{ "fde", { 
+		{ "position", FACT_UNSIGNED }, 
+		{ "length", FACT_UNSIGNED }, 
+		{ "cie", FACT_UNSIGNED }, 
+		{ "start", FACT_UNSIGNED }, 
+		{ "end", FACT_UNSIGNED }, 
+		{ "start_position", FACT_UNSIGNED }, 
+		{ "end_position", FACT_UNSIGNED }, 
+		{ "lsda_address", FACT_UNSIGNED }, 
+		{ "lsda_address_position", FACT_UNSIGNED } 
+	} },
+	{ "cfa_insn", { 
+		{ "owner", FACT_UNSIGNED }, 
+		{ "index", FACT_UNSIGNED }, 
+		{ "pc", FACT_UNSIGNED }, 
+		{ "op", FACT_STRING }, 
+		{ "operand1", FACT_SIGNED }, 
+		{ "operand2", FACT_SIGNED } 
+	} },
+	{ "lsda", { 
+		{ "fde", FACT_UNSIGNED }, 
+		{ "landing_pad_base", FACT_UNSIGNED }, 
+		{ "call_site_table_address", FACT_UNSIGNED }, 
+		{ "call_site_table_encoding", FACT_UNSIGNED }, 
+		{ "type_table_address", FACT_UNSIGNED }, 
+		{ "type_table_encoding", FACT_UNSIGNED } 
+	} },
+	{ "call_site", { 
+		{ "fde", FACT_UNSIGNED }, 
+		{ "index", FACT_UNSIGNED }, 
+		{ "start", FACT_UNSIGNED }, 
+		{ "end", FACT_UNSIGNED }, 
+		{ "landing_pad", FACT_UNSIGNED }, 
+		{ "start_position", FACT_UNSIGNED }, 
+		{ "landing_pad_position", FACT_UNSIGNED } 
+	} },
+	{ "call_site_action", { 
+		{ "fde", FACT_UNSIGNED }, 
+		{ "call_site", FACT_UNSIGNED }, 
+		{ "index", FACT_UNSIGNED }, 
+		{ "action", FACT_SIGNED } 
+	} },
+	{ "type_entry", { 
+		{ "fde", FACT_UNSIGNED }, 
+		{ "index", FACT_UNSIGNED }, 
+		{ "type_info", FACT_UNSIGNED }, 
+		{ "encoding", FACT_UNSIGNED } 
+	} }
+};
+
+void init_facts(EHPFacts_t &facts)
+{
+	facts.schema_version=EHP_FACT_SCHEMA_VERSION;
+	facts.relations.clear();
+	for(const auto &spec : schema)
+	{
+		auto relation=EHPFactRelation_t();
+		relation.name=spec.name;
+		relation.rows=0;
+		for(const auto &column_spec : spec.columns)
+		{
+			auto column=EHPFactColumn_t();
+			column.name=column_spec.name;
+			column.type=column_spec.type;
+			relation.columns.push_back(column);
+		}
+		facts.relations.push_back(relation);
+	}
+}
+
+// Appends one tuple to a relation, a column per add() in schema order.
+class tuple_appender_t
+{
+	private:
+
+	EHPFactRelation_t &relation;
+	size_t column;
+
+	public:
+
+	tuple_appender_t(EHPFactRelation_t &p_relation) : relation(p_relation), column(0) { relation.rows++; }
+
+	tuple_appender_t& add(const uint64_t v) { relation.columns[column++].values.push_back(v); return *this; }
+	tuple_appender_t& add(const int64_t v) { return add(static_cast<uint64_t>(v)); }
+	tuple_appender_t& add(const string &v) { relation.columns[column++].strings.push_back(v); return *this; }
+};
+
+void add_program(EHPFacts_t &facts, const uint64_t owner, const EHProgram_t &program, const uint64_t start_addr, const uint64_t caf)
+{
+	auto &insns=facts.relations[FACT_CFA_INSN];
+	auto pc=start_addr;
+	auto index=uint64_t(0);
+	for(const auto insn : *program.getInstructions())
+	{
+		const auto decoded=insn->decode();
+		tuple_appender_t(insns).add(owner).add(index++).add(pc).add(get<0>(decoded)).add(get<1>(decoded)).add(get<2>(decoded));
+		insn->advance(pc, caf);
+	}
+}
+
+void add_cie(EHPFacts_t &facts, const CIEContents_t &cie)
+{
+	tuple_appender_t(facts.relations[FACT_CIE])
+		.add(cie.getPosition())
+		.add(cie.getLength())
+		.add(cie.getAugmentation())
+		.add(cie.getCAF())
+		.add(cie.getDAF())
+		.add(cie.getReturnRegister())
+		.add(cie.getPersonality())
+		.add(uint64_t(cie.getPersonalityEncoding()))
+		.add(cie.getPersonalityPointerPosition())
+		.add(uint64_t(cie.getLSDAEncoding()))
+		.add(uint64_t(cie.getFDEEncoding()));
+	add_program(facts, cie.getPosition(), cie.getProgram(), 0, cie.getCAF());
+}
+
+void add_lsda(EHPFacts_t &facts, const uint64_t fde, const LSDA_t &lsda)
+{
+	tuple_appender_t(facts.relations[FACT_LSDA])
+		.add(fde)
+		.add(lsda.getLandingPadBaseAddress())
+		.add(lsda.getCallSiteTableAddress())
+		.add(uint64_t(lsda.getCallSiteTableEncoding()))
+		.add(lsda.getTypeTableAddress())
+		.add(uint64_t(lsda.getTypeTableEncoding()));
+
+	auto cs_index=uint64_t(0);
+	for(const auto cs : *lsda.getCallSites())
+	{
+		tuple_appender_t(facts.relations[FACT_CALL_SITE])
+			.add(fde)
+			.add(cs_index)
+			.add(cs->getCallSiteAddress())
+			.add(cs->getCallSiteEndAddress())
+			.add(cs->getLandingPadAddress())
+			.add(cs->getCallSiteAddressPosition())
+			.add(cs->getLandingPadAddressPosition());
+		auto action_index=uint64_t(0);
+		for(const auto action : *cs->getActionTable())
+			tuple_appender_t(facts.relations[FACT_CALL_SITE_ACTION]).add(fde).add(cs_index).add(action_index++).add(action->getAction());
+		cs_index++;
+	}
+
+	auto tt_index=uint64_t(0);
+	for(const auto tt : *lsda.getTypeTable())
+		tuple_appender_t(facts.relations[FACT_TYPE_ENTRY]).add(fde).add(tt_index++).add(tt->getTypeInfoPointer()).add(tt->getEncoding());
+}
+
+void add_fde(EHPFacts_t &facts, const FDEContents_t &fde)
+{
+	tuple_appender_t(facts.relations[FACT_FDE])
+		.add(fde.getPosition())
+		.add(fde.getLength())
+		.add(fde.getCIE().getPosition())
+		.add(fde.getStartAddress())
+		.add(fde.getEndAddress())
+		.add(fde.getStartAddressPosition())
+		.add(fde.getEndAddressPosition())
+		.add(fde.getLSDAAddress())
+		.add(fde.getLSDAAddressPosition());
+	add_program(facts, fde.getPosition(), fde.getProgram(), fde.getStartAddress(), fde.getCIE().getCAF());
+	if(fde.getLSDAAddress()!=0)
+		add_lsda(facts, fde.getPosition(), *fde.getLSDA());
+}
+
+void append_facts(EHPFacts_t &facts, EHPFacts_t &more)
+{
+	for(auto r=size_t(0); r < facts.relations.size(); r++)
+	{
+		auto &relation=facts.relations[r];
+		auto &more_relation=more.relations[r];
+		for(auto c=size_t(0); c < relation.columns.size(); c++)
+		{
+			auto &column=relation.columns[c];
+			auto &more_column=more_relation.columns[c];
+			column.values.insert(column.values.end(), more_column.values.begin(), more_column.values.end());
+			column.strings.reserve(column.strings.size()+more_column.strings.size());
+			for(auto &s : more_column.strings)
+				column.strings.push_back(move(s));
+		}
+		relation.rows+=more_relation.rows;
+	}
+}
+
+void append_decimal(string &line, const uint64_t v)
+{
+	char digits[20];
+	auto p=digits+sizeof(digits);
+	auto rest=v;
+	do
+	{
+		*--p=static_cast<char>('0'+rest%10);
+		rest/=10;
+	} while(rest!=0);
+	line.append(p, digits+sizeof(digits)-p);
+}
+
+void write_relation(OutputSink_t &sink, const EHPFactRelation_t &relation)
+{
+	auto line=string();
+	for(auto row=uint64_t(0); row < relation.rows; row++)
+	{
+		line.clear();
+		for(const auto &column : relation.columns)
+		{
+			if(&column!=&relation.columns.front())
+				line+='\t';
+			switch(column.type)
+			{
+				case FACT_UNSIGNED:
+					append_decimal(line, column.values[row]);
+					break;
+				case FACT_SIGNED:
+				{
+					const auto v=static_cast<int64_t>(column.values[row]);
+					if(v < 0)
+						line+='-';
+					append_decimal(line, v < 0 ? uint64_t(0)-column.values[row] : column.values[row]);
+					break;
+				}
+				case FACT_STRING:
+				{
+					const auto start=line.size();
+					line+=column.strings[row];
+					replace_if(line.begin()+start, line.end(), [](const char c) { return c=='\t' || c=='\n'; }, ' ');
+					break;
+				}
+			}
+		}
+		line+='\n';
+		sink.write(line.data(), line.size());
+	}
+}
+
+// returns true if the file could not be created or written.
+bool write_file(const string &filename, const function<void(OutputSink_t&)> &fill)
+{
+	const auto fd=open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if(fd < 0)
+		return true;
+	auto failed=false;
+	try
+	{
+		fd_sink_t sink(fd, 1<<20);
+		fill(sink);
+		sink.flush();
+	}
+	catch(const runtime_error&)
+	{
+		failed=true;
+	}
+	return close(fd)!=0 || failed;
+}
+
+}
+
+void EHP::build_facts(const EHFrameParser_t &parser, EHPFacts_t &facts)
+{
+	init_facts(facts);
+	for(const auto cie : *parser.getCIEs())
+		add_cie(facts, *cie);
+
+	// each chunk of FDEs fills its own relations, appended in order afterwards.  the first 
+	// chunk runs on this thread and fills facts directly.
+	const auto &fdes=*parser.getFDEs();
+	const auto chunks=parallel_chunk_count(fdes.size());
+	auto partial=vector<EHPFacts_t>(chunks);
+	parallel_for_chunks(fdes.size(), chunks, [&](const size_t chunk, const size_t begin, const size_t end)
+		{
+			auto &chunk_facts = chunk==0 ? facts : partial[chunk];
+			if(chunk!=0)
+				init_facts(chunk_facts);
+			for(auto i=begin; i < end; i++)
+				add_fde(chunk_facts, *fdes[i]);
+		});
+	for(auto chunk=size_t(1); chunk < chunks; chunk++)
+		append_facts(facts, partial[chunk]);
+}
+
+bool EHP::write_facts(const EHPFacts_t &facts, const string &directory)
+{
+	const auto write_version=[&](OutputSink_t &sink)
+		{
+			auto line=string();
+			append_decimal(line, facts.schema_version);
+			line+='\n';
+			sink.write(line.data(), line.size());
+		};
+	if(write_file(directory+"/schema_version.facts", write_version))
+		return true;
+	for(const auto &relation : facts.relations)
+	{
+		if(write_file(directory+"/"+relation.name+".facts", [&](OutputSink_t &sink) { write_relation(sink, relation); }))
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,42 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_facts_hpp
+#define ehp_facts_hpp
+
+#include <string>
+
+#include <ehp.hpp>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+void build_facts(const EHFrameParser_t &parser, EHPFacts_t &facts);
+
+// returns true on error.
+bool write_facts(const EHPFacts_t &facts, const string &directory);
+
+}
+#endif
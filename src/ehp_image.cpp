@@ -0,0 +1,388 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <ehp.hpp>
+#include "ehp_image.hpp"
+
+using namespace std;
+using namespace EHP;
+
+namespace 
+{
+
+const char image_magic[8]={'E','H','P','I','M','A','G','E'};
+
+static_assert(sizeof(EHPAddressRange_t)==2*sizeof(uint64_t), "executable ranges are stored as they are in memory");
+
+// append data at the next 8-byte boundary, so every part can be used in place.
+void append_part(string &image, image_header_t &header, const image_part_t part, const void* data, const uint64_t size)
+{
+	image.resize((image.size()+7) & ~size_t(7), '\0');
+	header.parts[part].offset=image.size();
+	header.parts[part].size=size;
+	if(size > 0)
+		image.append(reinterpret_cast<const char*>(data), size);
+}
+
+void append_section(string &image, image_header_t &header, const image_part_t part, const image_section_t &section)
+{
+	append_part(image, header, part, section.data, section.size);
+}
+
+template <class T>
+bool is_record_part(const image_header_t &header, const image_part_t part)
+{
+	return header.parts[part].offset%8==0 && header.parts[part].size%sizeof(T)==0;
+}
+
+// see https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function
+void fnv1a(uint64_t &hash, const uint8_t* const data, const uint64_t size)
+{
+	for(auto i=uint64_t(0); i < size; i++)
+	{
+		hash^=data[i];
+		hash*=0x100000001b3ULL;
+	}
+}
+
+void fnv1a_section(uint64_t &hash, const image_section_t &section)
+{
+	fnv1a(hash, reinterpret_cast<const uint8_t*>(&section.addr), sizeof(section.addr));
+	fnv1a(hash, reinterpret_cast<const uint8_t*>(&section.size), sizeof(section.size));
+	fnv1a(hash, section.data, section.size);
+}
+
+// lay out the whole image in memory.
+void build_image(const string &key, const image_contents_t &contents, string &image)
+{
+	auto header=image_header_t();
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, image_magic, sizeof(header.magic));
+	header.version=image_version;
+	header.byte_order_mark=image_byte_order_mark;
+	header.ptrsize=contents.ptrsize;
+	header.is_be=contents.is_be ? 1 : 0;
+	header.eh_frame_addr=contents.eh_frame.addr;
+	header.eh_frame_hdr_addr=contents.eh_frame_hdr.addr;
+	header.gcc_except_table_addr=contents.gcc_except_table.addr;
+
+	auto errors=vector<image_parse_error_t>();
+	for(const auto &e : *contents.parse_errors)
+		errors.push_back({e.position, e.length, static_cast<uint64_t>(e.kind)});
+
+	auto symbols=vector<image_symbol_t>();
+	auto names=string();
+	for(const auto &s : *contents.symbols)
+	{
+		symbols.push_back({s.address, s.size, names.size(), s.name.size(), static_cast<uint32_t>(s.binding), s.is_dynamic ? 1u : 0u});
+		names+=s.name;
+	}
+
+	image.assign(sizeof(header), '\0');
+	append_part(image, header, IMAGE_KEY, key.data(), key.size());
+	append_section(image, header, IMAGE_EH_FRAME, contents.eh_frame);
+	append_section(image, header, IMAGE_EH_FRAME_HDR, contents.eh_frame_hdr);
+	append_section(image, header, IMAGE_GCC_EXCEPT_TABLE, contents.gcc_except_table);
+	append_part(image, header, IMAGE_FDES, contents.fdes, contents.fde_count*sizeof(image_fde_t));
+	append_part(image, header, IMAGE_CIES, contents.cies, contents.cie_count*sizeof(image_cie_t));
+	append_part(image, header, IMAGE_AUGMENTATIONS, contents.augmentations, contents.augmentations_size);
+	append_part(image, header, IMAGE_INSN_SIZES, contents.insn_sizes, contents.insn_count*sizeof(uint32_t));
+	append_part(image, header, IMAGE_LSDAS, contents.lsdas, contents.lsda_count*sizeof(image_lsda_t));
+	append_part(image, header, IMAGE_CALL_SITES, contents.call_sites, contents.call_site_count*sizeof(image_call_site_t));
+	append_part(image, header, IMAGE_ACTIONS, contents.actions, contents.action_count*sizeof(int64_t));
+	append_part(image, header, IMAGE_TYPE_ENTRIES, contents.type_entries, contents.type_entry_count*sizeof(image_type_entry_t));
+	append_part(image, header, IMAGE_PARSE_ERRORS, errors.data(), errors.size()*sizeof(image_parse_error_t));
+	append_part(image, header, IMAGE_EXECUTABLE_RANGES, contents.executable_ranges->data(), contents.executable_ranges->size()*sizeof(EHPAddressRange_t));
+	append_part(image, header, IMAGE_SYMBOLS, symbols.data(), symbols.size()*sizeof(image_symbol_t));
+	append_part(image, header, IMAGE_SYMBOL_NAMES, names.data(), names.size());
+	memcpy(&image[0], &header, sizeof(header));
+}
+
+// returns true on error.
+bool write_all(const int fd, const string &image)
+{
+	auto written=size_t(0);
+	while(written < image.size())
+	{
+		const auto res=write(fd, image.data()+written, image.size()-written);
+		if(res < 0 && errno==EINTR)
+			continue;
+		if(res <= 0)
+			return true;
+		written+=res;
+	}
+	return false;
+}
+
+// the range [first, first+count) lies within a part of size records.
+bool in_range(const uint64_t first, const uint64_t count, const uint64_t records)
+{
+	return first <= records && count <= records-first;
+}
+
+}
+
+void image_records_t::describe(image_contents_t &contents) const
+{
+	contents.fdes=fdes.data();
+	contents.fde_count=fdes.size();
+	contents.cies=cies.data();
+	contents.cie_count=cies.size();
+	contents.augmentations=augmentations.data();
+	contents.augmentations_size=augmentations.size();
+	contents.insn_sizes=insn_sizes.data();
+	contents.insn_count=insn_sizes.size();
+	contents.lsdas=lsdas.data();
+	contents.lsda_count=lsdas.size();
+	contents.call_sites=call_sites.data();
+	contents.call_site_count=call_sites.size();
+	contents.actions=actions.data();
+	contents.action_count=actions.size();
+	contents.type_entries=type_entries.data();
+	contents.type_entry_count=type_entries.size();
+}
+
+bool EHP::write_image(const string &filename, const string &key, const image_contents_t &contents)
+{
+	auto image=string();
+	build_image(key, contents, image);
+
+	// a unique temporary, so writers in other threads or processes never share one.
+	auto temp_name=filename+".XXXXXX";
+	const auto fd=mkstemp(&temp_name[0]);
+	if(fd < 0)
+		return true;
+	const auto write_failed=fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)!=0 || write_all(fd, image);
+	if(::close(fd)!=0 || write_failed || rename(temp_name.c_str(), filename.c_str())!=0)
+	{
+		unlink(temp_name.c_str());
+		return true;
+	}
+	return false;
+}
+
+int EHP::publish_image(const string &key, const image_contents_t &contents)
+{
+	auto image=string();
+	build_image(key, contents, image);
+
+	const auto fd=memfd_create("ehp-image", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if(fd < 0)
+		return -1;
+	if(write_all(fd, image))
+	{
+		::close(fd);
+		return -1;
+	}
+
+	// once sealed, nobody can change the image under a process that has it mapped.
+	if(fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)!=0)
+	{
+		::close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+mapped_image_t::mapped_image_t()
+	:
+	base(nullptr),
+	size(0)
+{
+}
+
+mapped_image_t::~mapped_image_t()
+{
+	close();
+}
+
+void mapped_image_t::close()
+{
+	if(base!=nullptr)
+		munmap(const_cast<uint8_t*>(base), size);
+	base=nullptr;
+	size=0;
+}
+
+bool mapped_image_t::open(const string &filename, const string &key)
+{
+	const auto fd=::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+	if(fd < 0)
+	{
+		close();
+		return true;
+	}
+	const auto res=open(fd, key);
+	::close(fd);
+	return res;
+}
+
+bool mapped_image_t::open(const int fd, const string &key)
+{
+	close();
+
+	struct stat st;
+	if(fstat(fd, &st)!=0 || st.st_size < static_cast<off_t>(sizeof(image_header_t)))
+		return true;
+	const auto mapping=mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(mapping==MAP_FAILED)
+		return true;
+	base=reinterpret_cast<const uint8_t*>(mapping);
+	size=st.st_size;
+
+	const auto fail=[&]() -> bool
+	{
+		close();
+		return true;
+	};
+
+	const auto &header=getHeader();
+	if(memcmp(header.magic, image_magic, sizeof(header.magic))!=0 || header.version!=image_version || header.byte_order_mark!=image_byte_order_mark)
+		return fail();
+	if((header.ptrsize!=4 && header.ptrsize!=8) || header.is_be > 1)
+		return fail();
+	for(const auto &part : header.parts)
+	{
+		if(part.offset > size || part.size > size-part.offset)
+			return fail();
+	}
+	if(!is_record_part<image_fde_t>(header, IMAGE_FDES) || !is_record_part<image_cie_t>(header, IMAGE_CIES) || 
+	   !is_record_part<uint32_t>(header, IMAGE_INSN_SIZES) || !is_record_part<image_lsda_t>(header, IMAGE_LSDAS) || 
+	   !is_record_part<image_call_site_t>(header, IMAGE_CALL_SITES) || !is_record_part<int64_t>(header, IMAGE_ACTIONS) || 
+	   !is_record_part<image_type_entry_t>(header, IMAGE_TYPE_ENTRIES) || 
+	   !is_record_part<image_parse_error_t>(header, IMAGE_PARSE_ERRORS) || !is_record_part<EHPAddressRange_t>(header, IMAGE_EXECUTABLE_RANGES) ||
+	   !is_record_part<image_symbol_t>(header, IMAGE_SYMBOLS))
+		return fail();
+	if(getPartSize(IMAGE_KEY)!=key.size() || memcmp(getPart(IMAGE_KEY), key.data(), key.size())!=0)
+		return fail();
+
+	// the loader binary searches the FDEs and rebuilds records by following these offsets and 
+	// indexes without further checks, so check them once here.
+	const auto eh_frame_size=getPartSize(IMAGE_EH_FRAME);
+	const auto insn_sizes=getRecords<uint32_t>(IMAGE_INSN_SIZES);
+	const auto insn_count=getRecordCount<uint32_t>(IMAGE_INSN_SIZES);
+	const auto bad_program=[&](const image_program_t &program) -> bool
+	{
+		if(!in_range(program.position, program.size, eh_frame_size) || !in_range(program.first_insn, program.insn_count, insn_count))
+			return true;
+		auto size=uint64_t(0);
+		for(auto i=program.first_insn; i < program.first_insn+program.insn_count; i++)
+		{
+			if(insn_sizes[i]==0)
+				return true;
+			size+=insn_sizes[i];
+		}
+		return size!=program.size;
+	};
+
+	const auto cies=getRecords<image_cie_t>(IMAGE_CIES);
+	const auto cie_count=getRecordCount<image_cie_t>(IMAGE_CIES);
+	const auto augmentations_size=getPartSize(IMAGE_AUGMENTATIONS);
+	if(any_of(cies, cies+cie_count, [&](const image_cie_t &c) 
+		{ return !in_range(c.augmentation_offset, c.augmentation_length, augmentations_size) || bad_program(c.program); }))
+		return fail();
+
+	const auto actions_count=getRecordCount<int64_t>(IMAGE_ACTIONS);
+	const auto call_sites=getRecords<image_call_site_t>(IMAGE_CALL_SITES);
+	const auto call_site_count=getRecordCount<image_call_site_t>(IMAGE_CALL_SITES);
+	if(any_of(call_sites, call_sites+call_site_count, [&](const image_call_site_t &cs) { return !in_range(cs.first_action, cs.action_count, actions_count); }))
+		return fail();
+
+	const auto type_entry_count=getRecordCount<image_type_entry_t>(IMAGE_TYPE_ENTRIES);
+	const auto lsdas=getRecords<image_lsda_t>(IMAGE_LSDAS);
+	const auto lsda_count=getRecordCount<image_lsda_t>(IMAGE_LSDAS);
+	if(any_of(lsdas, lsdas+lsda_count, [&](const image_lsda_t &l) 
+		{ return !in_range(l.first_call_site, l.call_site_count, call_site_count) || !in_range(l.first_type_entry, l.type_entry_count, type_entry_count); }))
+		return fail();
+
+	const auto fdes=getRecords<image_fde_t>(IMAGE_FDES);
+	const auto fde_count=getRecordCount<image_fde_t>(IMAGE_FDES);
+	for(auto i=uint64_t(0); i < fde_count; i++)
+	{
+		const auto &fde=fdes[i];
+		if(fde.start_addr > fde.end_addr || (i > 0 && fdes[i-1].start_addr > fde.start_addr))
+			return fail();
+		if(fde.position < header.eh_frame_addr || fde.position-header.eh_frame_addr >= eh_frame_size || fde.cie_offset >= eh_frame_size)
+			return fail();
+		if(fde.cie >= cie_count || (fde.lsda!=image_no_lsda && fde.lsda >= lsda_count) || bad_program(fde.program))
+			return fail();
+	}
+	const auto errors=getRecords<image_parse_error_t>(IMAGE_PARSE_ERRORS);
+	if(any_of(errors, errors+getRecordCount<image_parse_error_t>(IMAGE_PARSE_ERRORS), [](const image_parse_error_t &e) { return e.kind > PARSE_ERROR_LENGTH; }))
+		return fail();
+	const auto symbols=getRecords<image_symbol_t>(IMAGE_SYMBOLS);
+	const auto names_size=getPartSize(IMAGE_SYMBOL_NAMES);
+	if(any_of(symbols, symbols+getRecordCount<image_symbol_t>(IMAGE_SYMBOLS), [&](const image_symbol_t &s) 
+		{ return s.name_offset > names_size || s.name_length > names_size-s.name_offset || s.binding > SYMBOL_LOCAL; }))
+		return fail();
+	return false;
+}
+
+void mapped_image_t::getContents(image_contents_t &contents) const
+{
+	const auto &header=getHeader();
+	contents.ptrsize=header.ptrsize;
+	contents.is_be=header.is_be!=0;
+	contents.eh_frame={getPart(IMAGE_EH_FRAME), getPartSize(IMAGE_EH_FRAME), header.eh_frame_addr};
+	contents.eh_frame_hdr={getPart(IMAGE_EH_FRAME_HDR), getPartSize(IMAGE_EH_FRAME_HDR), header.eh_frame_hdr_addr};
+	contents.gcc_except_table={getPart(IMAGE_GCC_EXCEPT_TABLE), getPartSize(IMAGE_GCC_EXCEPT_TABLE), header.gcc_except_table_addr};
+	contents.fdes=getRecords<image_fde_t>(IMAGE_FDES);
+	contents.fde_count=getRecordCount<image_fde_t>(IMAGE_FDES);
+	contents.cies=getRecords<image_cie_t>(IMAGE_CIES);
+	contents.cie_count=getRecordCount<image_cie_t>(IMAGE_CIES);
+	contents.augmentations=reinterpret_cast<const char*>(getPart(IMAGE_AUGMENTATIONS));
+	contents.augmentations_size=getPartSize(IMAGE_AUGMENTATIONS);
+	contents.insn_sizes=getRecords<uint32_t>(IMAGE_INSN_SIZES);
+	contents.insn_count=getRecordCount<uint32_t>(IMAGE_INSN_SIZES);
+	contents.lsdas=getRecords<image_lsda_t>(IMAGE_LSDAS);
+	contents.lsda_count=getRecordCount<image_lsda_t>(IMAGE_LSDAS);
+	contents.call_sites=getRecords<image_call_site_t>(IMAGE_CALL_SITES);
+	contents.call_site_count=getRecordCount<image_call_site_t>(IMAGE_CALL_SITES);
+	contents.actions=getRecords<int64_t>(IMAGE_ACTIONS);
+	contents.action_count=getRecordCount<int64_t>(IMAGE_ACTIONS);
+	contents.type_entries=getRecords<image_type_entry_t>(IMAGE_TYPE_ENTRIES);
+	contents.type_entry_count=getRecordCount<image_type_entry_t>(IMAGE_TYPE_ENTRIES);
+}
+
+string EHP::compute_image_key(const image_section_t &eh_frame, const image_section_t &eh_frame_hdr, const image_section_t &gcc_except_table)
+{
+	auto hash=uint64_t(0xcbf29ce484222325ULL);
+	fnv1a_section(hash, eh_frame);
+	fnv1a_section(hash, eh_frame_hdr);
+	fnv1a_section(hash, gcc_except_table);
+
+	ostringstream key;
+	key << "fnv1a:" << hex << setw(16) << setfill('0') << hash;
+	return key.str();
+}
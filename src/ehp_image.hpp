@@ -0,0 +1,303 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_image_hpp
+#define ehp_image_hpp
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <ehp.hpp>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// The file written by EHFrameParser_t::writeImage.  Everything is in the writer's byte order 
+// and addressed by file offset, so a loader on the same host can use the mapping in place.  
+// Bump image_version whenever any of these layouts changes.
+static const uint32_t image_version=2;
+static const uint32_t image_byte_order_mark=0x01020304;
+
+using image_part_t = enum image_part 
+{
+	IMAGE_KEY,
+	IMAGE_EH_FRAME,
+	IMAGE_EH_FRAME_HDR,
+	IMAGE_GCC_EXCEPT_TABLE,
+	IMAGE_FDES,			// image_fde_t, sorted by start address
+	IMAGE_CIES,			// image_cie_t
+	IMAGE_AUGMENTATIONS,		// the CIEs' augmentation strings
+	IMAGE_INSN_SIZES,		// uint32_t, the length of each CFA instruction
+	IMAGE_LSDAS,			// image_lsda_t
+	IMAGE_CALL_SITES,		// image_call_site_t
+	IMAGE_ACTIONS,			// int64_t, each call site's action table
+	IMAGE_TYPE_ENTRIES,		// image_type_entry_t
+	IMAGE_PARSE_ERRORS,		// image_parse_error_t
+	IMAGE_EXECUTABLE_RANGES,	// EHPAddressRange_t
+	IMAGE_SYMBOLS,			// image_symbol_t
+	IMAGE_SYMBOL_NAMES,
+	IMAGE_PART_COUNT
+};
+
+struct image_extent_t
+{
+	uint64_t offset;
+	uint64_t size;
+};
+
+struct image_header_t
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order_mark;
+	uint32_t ptrsize;
+	uint32_t is_be;		// byte order of the sections, not of the image
+	uint64_t eh_frame_addr;
+	uint64_t eh_frame_hdr_addr;
+	uint64_t gcc_except_table_addr;
+	image_extent_t parts[IMAGE_PART_COUNT];
+};
+
+// a CFA program, already split into instructions.  the bytes stay in .eh_frame.
+struct image_program_t
+{
+	uint64_t position;	// offset into .eh_frame
+	uint64_t size;
+	uint64_t first_insn;	// into IMAGE_INSN_SIZES
+	uint64_t insn_count;
+};
+
+static const uint64_t image_no_lsda=~uint64_t(0);
+
+// everything FDEContents_t can answer, decoded.
+struct image_fde_t
+{
+	uint64_t position;
+	uint64_t cie_offset;	// offset of the CIE in .eh_frame
+	uint64_t length;
+	uint64_t start_addr;
+	uint64_t end_addr;
+	uint64_t lsda_addr;
+	uint64_t start_addr_position;
+	uint64_t end_addr_position;
+	uint64_t end_addr_size;
+	uint64_t lsda_addr_position;
+	uint64_t lsda_addr_size;
+	uint64_t cie;		// into IMAGE_CIES
+	uint64_t lsda;		// into IMAGE_LSDAS, or image_no_lsda
+	image_program_t program;
+};
+
+struct image_cie_t
+{
+	uint64_t position;
+	uint64_t length;
+	uint64_t code_alignment_factor;
+	int64_t  data_alignment_factor;
+	uint64_t return_address_register_column;
+	uint64_t augmentation_data_length;
+	uint64_t personality;
+	uint64_t personality_pointer_position;
+	uint64_t personality_pointer_size;
+	uint64_t augmentation_offset;	// into IMAGE_AUGMENTATIONS
+	uint64_t augmentation_length;
+	image_program_t program;
+	uint8_t  cie_id;
+	uint8_t  version;
+	uint8_t  personality_encoding;
+	uint8_t  lsda_encoding;
+	uint8_t  fde_encoding;
+	uint8_t  listed;	// parsed as a record of its own, and so one of getCIEs()
+	uint8_t  padding[2];
+};
+
+struct image_lsda_t
+{
+	uint64_t landing_pad_base_addr;
+	uint64_t type_table_offset;
+	uint64_t type_table_addr;
+	uint64_t type_table_addr_location;
+	uint64_t cs_table_start_offset;
+	uint64_t cs_table_start_addr;
+	uint64_t cs_table_start_addr_location;
+	uint64_t cs_table_length;
+	uint64_t cs_table_end_addr;
+	uint64_t action_table_start_addr;
+	uint64_t first_call_site;	// into IMAGE_CALL_SITES
+	uint64_t call_site_count;
+	uint64_t first_type_entry;	// into IMAGE_TYPE_ENTRIES
+	uint64_t type_entry_count;
+	uint8_t  landing_pad_base_encoding;
+	uint8_t  type_table_encoding;
+	uint8_t  cs_table_encoding;
+	uint8_t  padding[5];
+};
+
+struct image_call_site_t
+{
+	uint64_t call_site_offset;
+	uint64_t call_site_addr;
+	uint64_t call_site_addr_position;
+	uint64_t call_site_length;
+	uint64_t call_site_end_addr;
+	uint64_t call_site_end_addr_position;
+	uint64_t landing_pad_offset;
+	uint64_t landing_pad_addr;
+	uint64_t landing_pad_addr_position;
+	uint64_t landing_pad_addr_end_position;
+	uint64_t action;
+	uint64_t action_table_offset;
+	uint64_t action_table_addr;
+	uint64_t first_action;		// into IMAGE_ACTIONS
+	uint64_t action_count;
+};
+
+struct image_type_entry_t
+{
+	uint64_t pointer_to_typeinfo;
+	uint64_t encoding;
+	uint64_t encoding_size;
+};
+
+struct image_parse_error_t
+{
+	uint64_t position;
+	uint64_t length;
+	uint64_t kind;
+};
+
+struct image_symbol_t
+{
+	uint64_t address;
+	uint64_t size;
+	uint64_t name_offset;	// into IMAGE_SYMBOL_NAMES
+	uint64_t name_length;
+	uint32_t binding;
+	uint32_t is_dynamic;
+};
+
+struct image_section_t
+{
+	const uint8_t* data;
+	uint64_t size;
+	uint64_t addr;
+};
+
+// what goes into an image.  nothing is copied, the pointers only have to last through write_image.
+struct image_contents_t
+{
+	uint32_t ptrsize;
+	bool is_be;
+	image_section_t eh_frame;
+	image_section_t eh_frame_hdr;
+	image_section_t gcc_except_table;
+	const image_fde_t* fdes;
+	uint64_t fde_count;
+	const image_cie_t* cies;
+	uint64_t cie_count;
+	const char* augmentations;
+	uint64_t augmentations_size;
+	const uint32_t* insn_sizes;
+	uint64_t insn_count;
+	const image_lsda_t* lsdas;
+	uint64_t lsda_count;
+	const image_call_site_t* call_sites;
+	uint64_t call_site_count;
+	const int64_t* actions;
+	uint64_t action_count;
+	const image_type_entry_t* type_entries;
+	uint64_t type_entry_count;
+	const EHPParseErrorVector_t* parse_errors;
+	const EHPAddressRangeVector_t* executable_ranges;
+	const EHPSymbolVector_t* symbols;
+};
+
+// the decoded records of a parser, as they are gathered for an image.
+struct image_records_t
+{
+	vector<image_fde_t> fdes;
+	vector<image_cie_t> cies;
+	string augmentations;
+	vector<uint32_t> insn_sizes;
+	vector<image_lsda_t> lsdas;
+	vector<image_call_site_t> call_sites;
+	vector<int64_t> actions;
+	vector<image_type_entry_t> type_entries;
+
+	// point contents at these records.
+	void describe(image_contents_t &contents) const;
+};
+
+// write to a temporary file and rename it into place, so readers never map a partial image.
+// returns true on error.
+bool write_image(const string &filename, const string &key, const image_contents_t &contents);
+
+// put the image in a sealed memfd that other processes can map.  returns the descriptor, or -1 on error.
+int publish_image(const string &key, const image_contents_t &contents);
+
+// a read-only mapping of an image.
+class mapped_image_t
+{
+	public:
+
+	mapped_image_t();
+	~mapped_image_t();
+
+	// map filename and check that it is a well-formed image of this version, written on a 
+	// host with this byte order, for key.  returns true on error.
+	bool open(const string &filename, const string &key);
+	// the same for an open descriptor, which the caller keeps.
+	bool open(const int fd, const string &key);
+
+	const image_header_t& getHeader() const { return *reinterpret_cast<const image_header_t*>(base); }
+	const uint8_t* getPart(const image_part_t part) const { return base+getHeader().parts[part].offset; }
+	uint64_t getPartSize(const image_part_t part) const { return getHeader().parts[part].size; }
+	uint64_t getSize() const { return size; }
+
+	template <class T>
+	const T* getRecords(const image_part_t part) const { return reinterpret_cast<const T*>(getPart(part)); }
+	template <class T>
+	uint64_t getRecordCount(const image_part_t part) const { return getPartSize(part)/sizeof(T); }
+
+	// point contents at the mapped sections and records.  the rest of contents is left alone.
+	void getContents(image_contents_t &contents) const;
+
+	private:
+
+	mapped_image_t(const mapped_image_t&);
+	mapped_image_t& operator=(const mapped_image_t&);
+
+	void close();
+
+	const uint8_t* base;
+	uint64_t size;
+};
+
+// a key for binaries without a build id, hashed from the section contents and addresses.
+string compute_image_key(const image_section_t &eh_frame, const image_section_t &eh_frame_hdr, const image_section_t &gcc_except_table);
+
+}
+#endif
@@ -0,0 +1,535 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <numeric>
+
+#include <ehp.hpp>
+#include "ehp_index.hpp"
+#include "ehp_memory.hpp"
+#include "ehp_parallel.hpp"
+
+using namespace std;
+using namespace EHP;
+
+namespace 
+{
+
+// search starts[from, starts.size()) for the entry covering pc.  found is set to the index 
+// of the first entry starting after pc, which is a good place to start searching for a larger pc.
+const EHPCallSiteIndexEntry_t* find_in_range(const call_site_index_t &index, const size_t from, const uint64_t pc, size_t &found)
+{
+	// gallop forward from the hint before bisecting, so nearby pcs cost O(log distance).
+	const auto &starts=index.starts;
+	auto low=from;
+	auto step=size_t(1);
+	while(low+step < starts.size() && starts[low+step] <= pc)
+	{
+		low+=step;
+		step*=2;
+	}
+	const auto high=min(low+step, starts.size());
+	found=static_cast<size_t>(upper_bound(next(starts.begin(), low), next(starts.begin(), high), pc)-starts.begin());
+	if(found==from)
+		return nullptr;
+	const auto &entry=index.entries[found-1];
+	return pc < entry.end_addr ? &entry : nullptr;
+}
+
+// sort ranges and merge any that overlap or touch.
+EHPAddressRangeVector_t normalize_ranges(const EHPAddressRangeVector_t &ranges)
+{
+	auto sorted=EHPAddressRangeVector_t();
+	copy_if(ranges.begin(), ranges.end(), back_inserter(sorted), 
+		[](const EHPAddressRange_t &r) { return r.start < r.end; });
+	sort(sorted.begin(), sorted.end(), 
+		[](const EHPAddressRange_t &a, const EHPAddressRange_t &b) { return a.start < b.start; });
+
+	auto merged=EHPAddressRangeVector_t();
+	for(const auto &r : sorted)
+	{
+		if(merged.size() > 0 && r.start <= merged.back().end)
+			merged.back().end=max(merged.back().end, r.end);
+		else
+			merged.push_back(r);
+	}
+	return merged;
+}
+
+// call covered(start, end) for each piece of ranges that some FDE covers, in address order.
+template <class covered_t>
+void for_each_covered(const FDEVector_t &fdes, const EHPAddressRangeVector_t &ranges, const covered_t &covered)
+{
+	// both lists are sorted, walk them together.
+	auto fde_it=fdes.begin();
+	for(const auto &r : ranges)
+	{
+		fde_it=lower_bound(fde_it, fdes.end(), r.start, 
+			[](const FDEContents_t* fde, const uint64_t addr) { return fde->getEndAddress() <= addr; });
+		for(auto it=fde_it; it!=fdes.end() && (*it)->getStartAddress() < r.end; ++it)
+		{
+			const auto start=max((*it)->getStartAddress(), r.start);
+			const auto end=min((*it)->getEndAddress(), r.end);
+			if(start < end)
+				covered(start, end);
+		}
+	}
+}
+
+}
+
+void EHP::find_coverage_gaps(const FDEVector_t &fdes, const EHPAddressRangeVector_t &ranges, EHPAddressRangeVector_t &gaps)
+{
+	gaps.clear();
+	const auto merged=normalize_ranges(ranges);
+
+	// everything in a range up to the next covered piece is a gap.
+	auto range_it=merged.begin();
+	auto uncovered_from=uint64_t(0);
+	const auto flush_to=[&](const uint64_t addr)
+	{
+		// close out every range ending at or before addr, then the part of the current one before addr.
+		while(range_it!=merged.end() && range_it->end <= addr)
+		{
+			const auto start=max(uncovered_from, range_it->start);
+			if(start < range_it->end)
+				gaps.push_back({start, range_it->end});
+			++range_it;
+		}
+		if(range_it!=merged.end())
+		{
+			const auto start=max(uncovered_from, range_it->start);
+			if(start < addr)
+				gaps.push_back({start, addr});
+		}
+	};
+	for_each_covered(fdes, merged, [&](const uint64_t start, const uint64_t end)
+		{
+			flush_to(start);
+			uncovered_from=max(uncovered_from, end);
+		});
+	flush_to(numeric_limits<uint64_t>::max());
+}
+
+void EHP::build_coverage_map(const FDEVector_t &fdes, const EHPAddressRangeVector_t &ranges, EHPCoverageMap_t &map)
+{
+	map=EHPCoverageMap_t();
+	map.ranges=normalize_ranges(ranges);
+
+	auto total_bits=uint64_t(0);
+	for(const auto &r : map.ranges)
+	{
+		map.range_first_bit.push_back(total_bits);
+		total_bits+=r.end-r.start;
+	}
+	map.bits.resize((total_bits+63)/64, 0);
+
+	auto range_index=size_t(0);
+	for_each_covered(fdes, map.ranges, [&](const uint64_t start, const uint64_t end)
+		{
+			while(map.ranges[range_index].end < end)
+				range_index++;
+			const auto &r=map.ranges[range_index];
+			auto bit=map.range_first_bit[range_index]+(start-r.start);
+			const auto end_bit=map.range_first_bit[range_index]+(end-r.start);
+
+			// partial words a bit at a time, whole words at once.
+			while(bit < end_bit && bit%64!=0)
+			{
+				map.bits[bit/64] |= uint64_t(1) << (bit%64);
+				bit++;
+			}
+			for(; bit+64 <= end_bit; bit+=64)
+				map.bits[bit/64]=~uint64_t(0);
+			for(; bit < end_bit; bit++)
+				map.bits[bit/64] |= uint64_t(1) << (bit%64);
+		});
+}
+
+void EHP::build_fde_index(const FDEVector_t &fdes, fde_index_t &index)
+{
+	index=fde_index_t();
+	index.by_position.reserve(fdes.size());
+	for(const auto fde : fdes)
+	{
+		index.by_position.push_back(make_pair(fde->getPosition(), fde));
+		if(fde->getLSDAAddress()!=0)
+			index.by_lsda[fde->getLSDAAddress()].push_back(fde);
+		index.by_personality[fde->getCIE().getPersonality()].push_back(fde);
+	}
+	sort(index.by_position.begin(), index.by_position.end());
+}
+
+const FDEContents_t* EHP::find_fde_by_position(const fde_index_t &index, const uint64_t position)
+{
+	const auto it=lower_bound(index.by_position.begin(), index.by_position.end(), position, 
+		[](const pair<uint64_t, const FDEContents_t*> &entry, const uint64_t position) { return entry.first < position; });
+	return (it!=index.by_position.end() && it->first==position) ? it->second : nullptr;
+}
+
+const FDEVector_t* EHP::find_fde_list(const unordered_map<uint64_t, FDEVector_t> &lists, const uint64_t key)
+{
+	const auto it=lists.find(key);
+	return it==lists.end() ? nullptr : &it->second;
+}
+
+void EHP::join_symbols(const FDEVector_t &fdes, const EHPSymbolVector_t &symbols, EHPSymbolJoin_t &join)
+{
+	join=EHPSymbolJoin_t();
+	join.symbols=symbols;
+	auto &syms=join.symbols;
+
+	// by address, best name first.  the name sorts before the table so that a .symtab 
+	// symbol and its .dynsym copy end up next to each other.
+	sort(syms.begin(), syms.end(), [](const EHPSymbol_t &a, const EHPSymbol_t &b)
+		{
+			if(a.address != b.address)
+				return a.address < b.address;
+			if(a.binding != b.binding)
+				return a.binding < b.binding;
+			if((a.size==0) != (b.size==0))
+				return a.size!=0;
+			if(a.name != b.name)
+				return a.name < b.name;
+			return !a.is_dynamic && b.is_dynamic;
+		});
+	syms.erase(unique(syms.begin(), syms.end(), [](const EHPSymbol_t &a, const EHPSymbol_t &b)
+		{
+			return a.address==b.address && a.name==b.name;
+		}), syms.end());
+
+	const auto contains=[&](const uint64_t sym, const uint64_t addr)
+	{
+		return syms[sym].address <= addr && addr-syms[sym].address < syms[sym].size;
+	};
+
+	// both lists are sorted, walk them together.  group_first is the best symbol at the 
+	// address of the last symbol passed, and furthest is whichever passed symbol reaches 
+	// furthest, for FDEs that start inside a function rather than at its symbol.
+	join.fde_symbols.assign(fdes.size(), EHP_NO_SYMBOL);
+	auto next_sym=size_t(0);
+	auto group_first=EHP_NO_SYMBOL;
+	auto furthest=EHP_NO_SYMBOL;
+	for(auto i=size_t(0); i < fdes.size(); i++)
+	{
+		const auto start=fdes[i]->getStartAddress();
+		for(; next_sym < syms.size() && syms[next_sym].address <= start; next_sym++)
+		{
+			if(next_sym==0 || syms[next_sym].address!=syms[next_sym-1].address)
+				group_first=next_sym;
+			const auto end=syms[next_sym].address+syms[next_sym].size;
+			if(furthest==EHP_NO_SYMBOL || end > syms[furthest].address+syms[furthest].size)
+				furthest=next_sym;
+		}
+
+		if(group_first!=EHP_NO_SYMBOL && (syms[group_first].address==start || contains(group_first, start)))
+			join.fde_symbols[i]=group_first;
+		else if(furthest!=EHP_NO_SYMBOL && contains(furthest, start))
+			join.fde_symbols[i]=furthest;
+		else
+			join.unnamed_fdes.push_back(i);
+	}
+
+	// and again the other way, tracking how far the FDEs started so far reach.
+	auto next_fde=size_t(0);
+	auto reach=uint64_t(0);
+	for(auto i=size_t(0); i < syms.size(); i++)
+	{
+		for(; next_fde < fdes.size() && fdes[next_fde]->getStartAddress() <= syms[i].address; next_fde++)
+			reach=max(reach, fdes[next_fde]->getEndAddress());
+		if(syms[i].address >= reach)
+			join.uncovered_symbols.push_back(i);
+	}
+}
+
+void EHP::build_call_site_index(const FDEVector_t &fdes, call_site_index_t &index)
+{
+	auto &entries=index.entries;
+	entries.clear();
+	for(const auto fde : fdes)
+	{
+		for(const auto cs : *fde->getLSDA()->getCallSites())
+		{
+			if(cs->getCallSiteAddress() >= cs->getCallSiteEndAddress())
+				continue;
+			const auto &actions=*cs->getActionTable();
+			const auto first_action = actions.size() > 0 ? actions[0]->getAction() : 0;
+			entries.push_back(EHPCallSiteIndexEntry_t({
+				cs->getCallSiteAddress(), 
+				cs->getCallSiteEndAddress(), 
+				cs->getLandingPadAddress(), 
+				first_action, 
+				cs, 
+				fde}));
+		}
+	}
+
+	// FDEs are sorted, but a call site table need not be.
+	stable_sort(entries.begin(), entries.end(), 
+		[](const EHPCallSiteIndexEntry_t &a, const EHPCallSiteIndexEntry_t &b) { return a.start_addr < b.start_addr; });
+	entries.shrink_to_fit();
+
+	index.starts.clear();
+	index.starts.reserve(entries.size());
+	transform(entries.begin(), entries.end(), back_inserter(index.starts), 
+		[](const EHPCallSiteIndexEntry_t &entry) { return entry.start_addr; });
+}
+
+const EHPCallSiteIndexEntry_t* EHP::find_call_site(const call_site_index_t &index, const uint64_t pc)
+{
+	auto found=size_t(0);
+	return find_in_range(index, 0, pc, found);
+}
+
+void EHP::find_call_sites(const call_site_index_t &index, const vector<uint64_t> &pcs, EHPCallSiteLookupVector_t &results)
+{
+	results.resize(pcs.size());
+
+	// each chunk writes its own slice of results.  within a chunk, a run of increasing 
+	// pcs only searches the part of the index past the previous pc's entry.
+	const auto chunks=parallel_chunk_count(pcs.size(), 1<<16);
+	parallel_for_chunks(pcs.size(), chunks, [&](const size_t, const size_t begin, const size_t end)
+		{
+			auto hint=size_t(0);
+			auto prev_pc=uint64_t(0);
+			for(auto i=begin; i < end; i++)
+			{
+				const auto pc=pcs[i];
+				const auto search_from = (hint > 0 && pc >= prev_pc) ? hint-1 : 0;
+				results[i]=find_in_range(index, search_from, pc, hint);
+				prev_pc=pc;
+			}
+		});
+}
+
+void EHP::build_exception_graph(const EHPCallSiteIndex_t &index, EHPExceptionGraph_t &graph)
+{
+	graph=EHPExceptionGraph_t();
+
+	// landing pad nodes.  a function's landing pads lie inside it and the index visits functions 
+	// in address order, so sorting each function's few pads and appending them keeps landing_pads 
+	// sorted, in time linear in the number of call sites.  only if some pad lies outside its 
+	// function do all of them need sorting together.
+	auto targets=vector<uint32_t>(index.size(), 0);
+	auto in_order=true;
+	for(auto begin=size_t(0); begin < index.size(); )
+	{
+		auto end=begin;
+		while(end < index.size() && index[end].fde==index[begin].fde)
+			end++;
+		const auto first=graph.landing_pads.size();
+		for(auto i=begin; i < end; i++)
+			if(index[i].landing_pad_addr!=0)
+				graph.landing_pads.push_back(index[i].landing_pad_addr);
+		const auto function_pads=graph.landing_pads.begin()+first;
+		sort(function_pads, graph.landing_pads.end());
+		graph.landing_pads.erase(unique(function_pads, graph.landing_pads.end()), graph.landing_pads.end());
+		if(first > 0 && first < graph.landing_pads.size() && graph.landing_pads[first] <= graph.landing_pads[first-1])
+			in_order=false;
+		for(auto i=begin; i < end; i++)
+			if(index[i].landing_pad_addr!=0)
+				targets[i]=static_cast<uint32_t>(lower_bound(graph.landing_pads.begin()+first, graph.landing_pads.end(), index[i].landing_pad_addr)-graph.landing_pads.begin());
+		begin=end;
+	}
+	if(!in_order)
+	{
+		sort(graph.landing_pads.begin(), graph.landing_pads.end());
+		graph.landing_pads.erase(unique(graph.landing_pads.begin(), graph.landing_pads.end()), graph.landing_pads.end());
+		for(auto i=size_t(0); i < index.size(); i++)
+			if(index[i].landing_pad_addr!=0)
+				targets[i]=static_cast<uint32_t>(lower_bound(graph.landing_pads.begin(), graph.landing_pads.end(), index[i].landing_pad_addr)-graph.landing_pads.begin());
+	}
+
+	// call site nodes and their out-edges.  a call site has at most one landing pad.
+	graph.call_site_starts.reserve(index.size());
+	graph.call_site_ends.reserve(index.size());
+	graph.edge_offsets.reserve(index.size()+1);
+	graph.edge_offsets.push_back(0);
+	graph.filter_offsets.push_back(0);
+	auto pad_in_degree=vector<uint32_t>(graph.landing_pads.size(), 0);
+	for(auto i=size_t(0); i < index.size(); i++)
+	{
+		const auto &entry=index[i];
+		graph.call_site_starts.push_back(entry.start_addr);
+		graph.call_site_ends.push_back(entry.end_addr);
+		if(entry.landing_pad_addr!=0)
+		{
+			const auto target=targets[i];
+			auto kinds=uint8_t(0);
+			for(const auto action : *entry.call_site->getActionTable())
+			{
+				const auto filter=action->getAction();
+				kinds |= filter==0 ? EDGE_CLEANUP : filter > 0 ? EDGE_CATCH : EDGE_EXCEPTION_SPEC;
+				graph.type_filters.push_back(filter);
+			}
+			// no action record at all is also a cleanup.
+			if(kinds==0)
+				kinds=EDGE_CLEANUP;
+			graph.edge_targets.push_back(target);
+			graph.edge_kinds.push_back(kinds);
+			graph.filter_offsets.push_back(static_cast<uint32_t>(graph.type_filters.size()));
+			pad_in_degree[target]++;
+		}
+		graph.edge_offsets.push_back(static_cast<uint32_t>(graph.edge_targets.size()));
+	}
+
+	// reverse edges, by counting sort so each pad's sources stay in address order.
+	graph.pad_offsets.resize(graph.landing_pads.size()+1, 0);
+	for(auto j=size_t(0); j < pad_in_degree.size(); j++)
+		graph.pad_offsets[j+1]=graph.pad_offsets[j]+pad_in_degree[j];
+	graph.pad_sources.resize(graph.edge_targets.size());
+	auto fill=vector<uint32_t>(graph.pad_offsets.begin(), prev(graph.pad_offsets.end()));
+	for(auto i=size_t(0); i < index.size(); i++)
+		for(auto e=graph.edge_offsets[i]; e < graph.edge_offsets[i+1]; e++)
+			graph.pad_sources[fill[graph.edge_targets[e]]++]=static_cast<uint32_t>(i);
+}
+
+void EHP::build_catch_index(const EHPCallSiteIndex_t &index, EHPCatchIndex_t &catches)
+{
+	catches.clear();
+	for(const auto &entry : index)
+	{
+		const auto &type_table=*entry.fde->getLSDA()->getTypeTable();
+		for(const auto action : *entry.call_site->getActionTable())
+		{
+			// only positive filters are catch clauses, they index the type table from 1.
+			const auto filter=action->getAction();
+			if(filter <= 0 || static_cast<uint64_t>(filter) > type_table.size())
+				continue;
+			const auto type_info=type_table[filter-1]->getTypeInfoPointer();
+			auto &sites=catches[type_info];
+
+			// a chain can name the same type twice, e.g., from nested try blocks.
+			if(sites.size() > 0 && sites.back().call_site==entry.call_site)
+				continue;
+			sites.push_back(EHPCatchSite_t({entry.start_addr, entry.landing_pad_addr, filter, entry.call_site, entry.fde}));
+		}
+	}
+}
+
+void EHP::build_search_table(const FDEVector_t &fdes, EHPSearchTable_t &table)
+{
+	table.clear();
+	table.reserve(fdes.size());
+	for(const auto fde : fdes)
+		table.push_back({fde->getStartAddress(), fde->getPosition()});
+}
+
+void EHP::check_search_table(const FDEVector_t &fdes, const EHPSearchTable_t &table, EHPSearchTableIssueVector_t &issues)
+{
+	const auto before=[](const EHPSearchTableEntry_t &a, const EHPSearchTableEntry_t &b) 
+	{ 
+		return a.initial_location < b.initial_location || (a.initial_location==b.initial_location && a.fde_address < b.fde_address); 
+	};
+	const auto same=[](const EHPSearchTableEntry_t &a, const EHPSearchTableEntry_t &b) 
+	{ 
+		return a.initial_location==b.initial_location && a.fde_address==b.fde_address; 
+	};
+
+	// the entries the FDEs should have, with the index of each one's FDE.  FDEs with the same 
+	// start may be in either order.
+	issues.clear();
+	auto expected=EHPSearchTable_t();
+	build_search_table(fdes, expected);
+	auto fde_index=vector<uint64_t>(expected.size());
+	iota(fde_index.begin(), fde_index.end(), 0);
+	if(!is_sorted(expected.begin(), expected.end(), before))
+	{
+		sort(fde_index.begin(), fde_index.end(), [&](const uint64_t a, const uint64_t b) { return before(expected[a], expected[b]); });
+		sort(expected.begin(), expected.end(), before);
+	}
+
+	// walk the table and the expected entries together.  an entry starting below the last one in 
+	// order, or above a next one that is in order, is looked up instead, so that one stray entry 
+	// does not put the walk out of step.
+	auto listed=vector<bool>(expected.size(), false);
+	auto next=size_t(0);
+	auto in_order_start=uint64_t(0);
+	for(auto i=size_t(0); i < table.size(); i++)
+	{
+		const auto &entry=table[i];
+		const auto above_next = i+1 < table.size() && 
+			table[i+1].initial_location < entry.initial_location && 
+			table[i+1].initial_location >= in_order_start;
+		if(entry.initial_location < in_order_start || above_next)
+		{
+			issues.push_back({SEARCH_TABLE_MISORDERED, i, entry});
+			const auto it=lower_bound(expected.begin(), expected.end(), entry, before);
+			if(it!=expected.end() && same(*it, entry))
+				listed[it-expected.begin()]=true;
+			continue;
+		}
+		in_order_start=entry.initial_location;
+		while(next < expected.size() && before(expected[next], entry))
+			next++;
+		if(next < expected.size() && same(expected[next], entry) && !listed[next])
+			listed[next++]=true;
+		else
+			issues.push_back({SEARCH_TABLE_EXTRA, i, entry});
+	}
+	for(auto j=size_t(0); j < expected.size(); j++)
+	{
+		if(!listed[j])
+			issues.push_back({SEARCH_TABLE_MISSING, fde_index[j], expected[j]});
+	}
+}
+
+uint64_t EHP::table_bytes(const call_site_index_t &index)
+{
+	return vector_bytes(index.entries)+vector_bytes(index.starts);
+}
+
+uint64_t EHP::table_bytes(const EHPExceptionGraph_t &graph)
+{
+	return vector_bytes(graph.call_site_starts)+vector_bytes(graph.call_site_ends)+vector_bytes(graph.landing_pads)+
+		vector_bytes(graph.edge_offsets)+vector_bytes(graph.edge_targets)+vector_bytes(graph.edge_kinds)+
+		vector_bytes(graph.filter_offsets)+vector_bytes(graph.type_filters)+
+		vector_bytes(graph.pad_offsets)+vector_bytes(graph.pad_sources);
+}
+
+uint64_t EHP::table_bytes(const EHPCatchIndex_t &catches)
+{
+	auto bytes=hash_map_bytes(catches);
+	for(const auto &type_sites : catches)
+		bytes+=vector_bytes(type_sites.second);
+	return bytes;
+}
+
+uint64_t EHP::table_bytes(const fde_index_t &index)
+{
+	auto bytes=vector_bytes(index.by_position)+hash_map_bytes(index.by_lsda)+hash_map_bytes(index.by_personality);
+	for(const auto &lsda_fdes : index.by_lsda)
+		bytes+=vector_bytes(lsda_fdes.second);
+	for(const auto &personality_fdes : index.by_personality)
+		bytes+=vector_bytes(personality_fdes.second);
+	return bytes;
+}
+
+uint64_t EHP::table_bytes(const EHPSymbolJoin_t &join)
+{
+	auto bytes=vector_bytes(join.symbols)+vector_bytes(join.fde_symbols)+vector_bytes(join.unnamed_fdes)+vector_bytes(join.uncovered_symbols);
+	for(const auto &sym : join.symbols)
+		bytes+=string_bytes(sym.name);
+	return bytes;
+}
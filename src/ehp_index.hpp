@@ -0,0 +1,85 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_index_hpp
+#define ehp_index_hpp
+
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <ehp.hpp>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// The public index plus a dense copy of its start addresses, which is what lookups 
+// actually search: eight bytes per entry keeps the binary search in cache.
+struct call_site_index_t
+{
+	EHPCallSiteIndex_t entries;
+	vector<uint64_t> starts;
+};
+
+// Secondary FDE lookups for binary rewriters, which address FDEs by where they are rather than what they cover.
+struct fde_index_t
+{
+	vector<pair<uint64_t, const FDEContents_t*> > by_position;	// sorted by position
+	unordered_map<uint64_t, FDEVector_t> by_lsda;			// FDEs without an LSDA are not listed
+	unordered_map<uint64_t, FDEVector_t> by_personality;
+};
+
+void build_fde_index(const FDEVector_t &fdes, fde_index_t &index);
+const FDEContents_t* find_fde_by_position(const fde_index_t &index, const uint64_t position);
+const FDEVector_t* find_fde_list(const unordered_map<uint64_t, FDEVector_t> &lists, const uint64_t key);
+
+// fdes must be sorted by address, as getFDEs() returns them.  ranges may overlap and be in any order.
+void find_coverage_gaps(const FDEVector_t &fdes, const EHPAddressRangeVector_t &ranges, EHPAddressRangeVector_t &gaps);
+void build_coverage_map(const FDEVector_t &fdes, const EHPAddressRangeVector_t &ranges, EHPCoverageMap_t &map);
+
+// fdes must be sorted by address, as getFDEs() returns them.  symbols may be in any order.
+void join_symbols(const FDEVector_t &fdes, const EHPSymbolVector_t &symbols, EHPSymbolJoin_t &join);
+
+// fdes must be sorted by address, as getFDEs() returns them.
+void build_search_table(const FDEVector_t &fdes, EHPSearchTable_t &table);
+void check_search_table(const FDEVector_t &fdes, const EHPSearchTable_t &table, EHPSearchTableIssueVector_t &issues);
+
+// fdes must be sorted by address, as getFDEs() returns them.
+void build_call_site_index(const FDEVector_t &fdes, call_site_index_t &index);
+const EHPCallSiteIndexEntry_t* find_call_site(const call_site_index_t &index, const uint64_t pc);
+void find_call_sites(const call_site_index_t &index, const vector<uint64_t> &pcs, EHPCallSiteLookupVector_t &results);
+void build_exception_graph(const EHPCallSiteIndex_t &index, EHPExceptionGraph_t &graph);
+void build_catch_index(const EHPCallSiteIndex_t &index, EHPCatchIndex_t &catches);
+
+// the heap bytes behind each table, for getMemoryUsage().
+uint64_t table_bytes(const call_site_index_t &index);
+uint64_t table_bytes(const EHPExceptionGraph_t &graph);
+uint64_t table_bytes(const EHPCatchIndex_t &catches);
+uint64_t table_bytes(const fde_index_t &index);
+uint64_t table_bytes(const EHPSymbolJoin_t &join);
+
+}
+#endif
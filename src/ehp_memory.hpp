@@ -0,0 +1,67 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_memory_hpp
+#define ehp_memory_hpp
+
+#include <stdint.h>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// Estimates of the heap memory behind the standard containers, for getMemoryUsage().  Each 
+// counts what the container allocates itself, not what its elements own in turn.
+
+template <class T>
+uint64_t vector_bytes(const vector<T> &v)
+{
+	return v.capacity()*sizeof(T);
+}
+
+inline uint64_t string_bytes(const string &s)
+{
+	return s.capacity();
+}
+
+// a node per element, holding the element and a link, plus the bucket array.
+template <class K, class V>
+uint64_t hash_map_bytes(const unordered_map<K, V> &m)
+{
+	return m.size()*(sizeof(typename unordered_map<K, V>::value_type)+sizeof(void*)) + m.bucket_count()*sizeof(void*);
+}
+
+// a tree node per element, holding the element, three links and a colour.
+template <class T, class C>
+uint64_t set_bytes(const set<T, C> &s)
+{
+	return s.size()*(sizeof(T)+4*sizeof(void*));
+}
+
+}
+#endif
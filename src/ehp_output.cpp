@@ -0,0 +1,410 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <errno.h>
+#include <string.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#include <ehp.hpp>
+#include "ehp_output.hpp"
+
+using namespace std;
+using namespace EHP;
+
+buffered_sink_t::buffered_sink_t(const size_t p_buffer_size)
+	:
+	buffer_size(p_buffer_size)
+{
+	buffer.reserve(buffer_size);
+}
+
+void buffered_sink_t::write(const char* data, size_t size)
+{
+	if(buffer.size()+size > buffer_size)
+	{
+		flush();
+		// too big to be worth copying.
+		if(size >= buffer_size)
+		{
+			drain(data, size);
+			return;
+		}
+	}
+	buffer.append(data, size);
+}
+
+void buffered_sink_t::flush()
+{
+	if(buffer.size() > 0)
+		drain(buffer.data(), buffer.size());
+	buffer.clear();
+}
+
+stream_sink_t::stream_sink_t(ostream &p_out, const size_t buffer_size)
+	:
+	buffered_sink_t(buffer_size),
+	out(p_out)
+{
+}
+
+stream_sink_t::~stream_sink_t()
+{
+	flush();
+}
+
+void stream_sink_t::drain(const char* data, size_t size)
+{
+	out.write(data, size);
+}
+
+sink_ostream_t::buffer_t::int_type sink_ostream_t::buffer_t::overflow(const int_type c)
+{
+	sync();
+	if(!traits_type::eq_int_type(c, traits_type::eof()))
+	{
+		*pptr()=traits_type::to_char_type(c);
+		pbump(1);
+	}
+	return traits_type::not_eof(c);
+}
+
+int sink_ostream_t::buffer_t::sync()
+{
+	if(pptr() > pbase())
+		sink.write(pbase(), pptr()-pbase());
+	setp(data, data+sizeof(data));
+	return 0;
+}
+
+fd_sink_t::fd_sink_t(const int p_fd, const size_t buffer_size)
+	:
+	buffered_sink_t(buffer_size),
+	fd(p_fd)
+{
+}
+
+fd_sink_t::~fd_sink_t()
+{
+	// nowhere to report a failure from here, call flush() first to find out.
+	try
+	{
+		flush();
+	}
+	catch(const runtime_error&)
+	{
+	}
+}
+
+void fd_sink_t::drain(const char* data, size_t size)
+{
+	while(size > 0)
+	{
+		const auto res=::write(fd, data, size);
+		if(res < 0 && errno==EINTR)
+			continue;
+		if(res <= 0)
+			throw runtime_error("Cannot write to output descriptor");
+		data+=res;
+		size-=res;
+	}
+}
+
+unique_ptr<OutputSink_t> OutputSink_t::factory(ostream &out, size_t buffer_size)
+{
+	return unique_ptr<OutputSink_t>(new stream_sink_t(out, buffer_size));
+}
+
+unique_ptr<OutputSink_t> OutputSink_t::factory(int fd, size_t buffer_size)
+{
+	return unique_ptr<OutputSink_t>(new fd_sink_t(fd, buffer_size));
+}
+
+unique_ptr<OutputSink_t> OutputSink_t::factory(string &out)
+{
+	return unique_ptr<OutputSink_t>(new string_sink_t(out));
+}
+
+json_writer_t::json_writer_t(OutputSink_t &p_sink)
+	:
+	sink(p_sink),
+	after_key(false)
+{
+}
+
+void json_writer_t::separate()
+{
+	if(after_key)
+	{
+		after_key=false;
+		return;
+	}
+	if(first_in_level.size() > 0)
+	{
+		if(!first_in_level.back())
+			raw(',');
+		first_in_level.back()=false;
+	}
+}
+
+void json_writer_t::beginObject()
+{
+	separate();
+	raw('{');
+	first_in_level.push_back(true);
+}
+
+void json_writer_t::endObject()
+{
+	first_in_level.pop_back();
+	raw('}');
+}
+
+void json_writer_t::beginArray()
+{
+	separate();
+	raw('[');
+	first_in_level.push_back(true);
+}
+
+void json_writer_t::endArray()
+{
+	first_in_level.pop_back();
+	raw(']');
+}
+
+void json_writer_t::key(const char* name)
+{
+	// keys are literals in this file, nothing to escape.
+	separate();
+	raw('"');
+	raw(name, strlen(name));
+	raw("\":", 2);
+	after_key=true;
+}
+
+void json_writer_t::value(const uint64_t v)
+{
+	separate();
+	char digits[20];
+	auto p=digits+sizeof(digits);
+	auto rest=v;
+	do
+	{
+		*--p=static_cast<char>('0'+rest%10);
+		rest/=10;
+	} while(rest!=0);
+	raw(p, digits+sizeof(digits)-p);
+}
+
+void json_writer_t::value(const int64_t v)
+{
+	if(v >= 0)
+	{
+		value(static_cast<uint64_t>(v));
+		return;
+	}
+	separate();
+	raw('-');
+	after_key=true;	// the digits follow the sign directly
+	value(uint64_t(0)-static_cast<uint64_t>(v));
+}
+
+void json_writer_t::value(const string &s)
+{
+	static const char hex_digits[]="0123456789abcdef";
+	separate();
+	raw('"');
+	auto clean_from=size_t(0);
+	for(auto i=size_t(0); i < s.size(); i++)
+	{
+		const auto c=static_cast<unsigned char>(s[i]);
+		if(c >= 0x20 && c!='"' && c!='\\')
+			continue;
+		raw(s.data()+clean_from, i-clean_from);
+		clean_from=i+1;
+		if(c=='"' || c=='\\')
+		{
+			const char escaped[2]={'\\', static_cast<char>(c)};
+			raw(escaped, 2);
+		}
+		else
+		{
+			const char escaped[6]={'\\', 'u', '0', '0', hex_digits[c>>4], hex_digits[c&0xf]};
+			raw(escaped, 6);
+		}
+	}
+	raw(s.data()+clean_from, s.size()-clean_from);
+	raw('"');
+}
+
+void json_writer_t::hexValue(const uint8_t* const data, const size_t size)
+{
+	static const char hex_digits[]="0123456789abcdef";
+	separate();
+	raw('"');
+	for(auto i=size_t(0); i < size; i++)
+	{
+		const char digits[2]={hex_digits[data[i]>>4], hex_digits[data[i]&0xf]};
+		raw(digits, 2);
+	}
+	raw('"');
+}
+
+namespace
+{
+
+void write_instructions(json_writer_t &json, const EHProgram_t &program, const uint64_t start_addr, const uint64_t caf)
+{
+	auto pc=start_addr;
+	json.key("instructions");
+	json.beginArray();
+	for(const auto insn : *program.getInstructions())
+	{
+		const auto decoded=insn->decode();
+		const auto &bytes=insn->getBytes();
+		json.beginObject();
+		json.member("pc", pc);
+		json.member("op", get<0>(decoded));
+		json.key("operands");
+		json.beginArray();
+		json.value(get<1>(decoded));
+		json.value(get<2>(decoded));
+		json.endArray();
+		json.key("bytes");
+		json.hexValue(bytes.data(), bytes.size());
+		json.endObject();
+		insn->advance(pc, caf);
+	}
+	json.endArray();
+}
+
+void write_cie(json_writer_t &json, const CIEContents_t &cie)
+{
+	json.beginObject();
+	json.member("type", string("cie"));
+	json.member("position", cie.getPosition());
+	json.member("length", cie.getLength());
+	json.member("augmentation", cie.getAugmentation());
+	json.member("code_alignment_factor", cie.getCAF());
+	json.member("data_alignment_factor", cie.getDAF());
+	json.member("return_register", cie.getReturnRegister());
+	json.member("personality", cie.getPersonality());
+	json.member("personality_encoding", uint64_t(cie.getPersonalityEncoding()));
+	json.member("lsda_encoding", uint64_t(cie.getLSDAEncoding()));
+	json.member("fde_encoding", uint64_t(cie.getFDEEncoding()));
+	write_instructions(json, cie.getProgram(), 0, cie.getCAF());
+	json.endObject();
+}
+
+void write_lsda(json_writer_t &json, const LSDA_t &lsda)
+{
+	json.key("lsda");
+	json.beginObject();
+	json.member("landing_pad_base", lsda.getLandingPadBaseAddress());
+	json.member("call_site_table_address", lsda.getCallSiteTableAddress());
+	json.member("call_site_table_encoding", uint64_t(lsda.getCallSiteTableEncoding()));
+	json.member("type_table_address", lsda.getTypeTableAddress());
+	json.member("type_table_encoding", uint64_t(lsda.getTypeTableEncoding()));
+
+	json.key("call_sites");
+	json.beginArray();
+	for(const auto cs : *lsda.getCallSites())
+	{
+		json.beginObject();
+		json.member("start", cs->getCallSiteAddress());
+		json.member("end", cs->getCallSiteEndAddress());
+		json.member("landing_pad", cs->getLandingPadAddress());
+		json.key("actions");
+		json.beginArray();
+		for(const auto action : *cs->getActionTable())
+			json.value(action->getAction());
+		json.endArray();
+		json.endObject();
+	}
+	json.endArray();
+
+	json.key("type_table");
+	json.beginArray();
+	for(const auto tt : *lsda.getTypeTable())
+	{
+		json.beginObject();
+		json.member("type_info", tt->getTypeInfoPointer());
+		json.member("encoding", tt->getEncoding());
+		json.endObject();
+	}
+	json.endArray();
+	json.endObject();
+}
+
+void write_fde(json_writer_t &json, const FDEContents_t &fde)
+{
+	json.beginObject();
+	json.member("type", string("fde"));
+	json.member("position", fde.getPosition());
+	json.member("length", fde.getLength());
+	json.member("start", fde.getStartAddress());
+	json.member("end", fde.getEndAddress());
+	json.member("cie", fde.getCIE().getPosition());
+	json.member("lsda_address", fde.getLSDAAddress());
+	write_instructions(json, fde.getProgram(), fde.getStartAddress(), fde.getCIE().getCAF());
+	if(fde.getLSDAAddress()!=0)
+		write_lsda(json, *fde.getLSDA());
+	json.endObject();
+}
+
+}
+
+void EHP::write_json(const EHFrameParser_t &parser, OutputSink_t &sink, const EHPJSONFormat_t format)
+{
+	json_writer_t json(sink);
+	if(format==JSON_LINES)
+	{
+		for(const auto cie : *parser.getCIEs())
+		{
+			write_cie(json, *cie);
+			json.newline();
+		}
+		for(const auto fde : *parser.getFDEs())
+		{
+			write_fde(json, *fde);
+			json.newline();
+		}
+	}
+	else
+	{
+		json.beginObject();
+		json.key("cies");
+		json.beginArray();
+		for(const auto cie : *parser.getCIEs())
+			write_cie(json, *cie);
+		json.endArray();
+		json.key("fdes");
+		json.beginArray();
+		for(const auto fde : *parser.getFDEs())
+			write_fde(json, *fde);
+		json.endArray();
+		json.endObject();
+		json.newline();
+	}
+	sink.flush();
+}
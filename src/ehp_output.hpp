@@ -0,0 +1,172 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_output_hpp
+#define ehp_output_hpp
+
+#include <stdint.h>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <ehp.hpp>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// Collects small writes and hands them to drain() in buffer_size pieces.
+class buffered_sink_t : public OutputSink_t
+{
+	private:
+
+	string buffer;
+	size_t buffer_size;
+
+	protected:
+
+	virtual void drain(const char* data, size_t size) =0;
+
+	public:
+
+	buffered_sink_t(const size_t p_buffer_size);
+
+	virtual void write(const char* data, size_t size);
+	virtual void flush();
+};
+
+class stream_sink_t : public buffered_sink_t
+{
+	private:
+
+	ostream &out;
+
+	protected:
+
+	virtual void drain(const char* data, size_t size);
+
+	public:
+
+	stream_sink_t(ostream &p_out, const size_t buffer_size);
+	virtual ~stream_sink_t();
+};
+
+class fd_sink_t : public buffered_sink_t
+{
+	private:
+
+	int fd;
+
+	protected:
+
+	virtual void drain(const char* data, size_t size);
+
+	public:
+
+	fd_sink_t(const int p_fd, const size_t buffer_size);
+	virtual ~fd_sink_t();
+};
+
+class string_sink_t : public OutputSink_t
+{
+	private:
+
+	string &out;
+
+	public:
+
+	string_sink_t(string &p_out) : out(p_out) {}
+
+	virtual void write(const char* data, size_t size) { out.append(data, size); }
+	virtual void flush() {}
+};
+
+// An ostream for operator<< formatting that hands its text to a sink a buffer at a time 
+// instead of a line at a time.  The text is written when the buffer fills and when destroyed.
+class sink_ostream_t : public ostream
+{
+	private:
+
+	class buffer_t : public streambuf
+	{
+		private:
+
+		OutputSink_t &sink;
+		char data[4096];
+
+		protected:
+
+		virtual int_type overflow(int_type c);
+		virtual int sync();
+
+		public:
+
+		buffer_t(OutputSink_t &p_sink) : sink(p_sink) { setp(data, data+sizeof(data)); }
+	};
+
+	buffer_t buffer;
+
+	public:
+
+	sink_ostream_t(OutputSink_t &sink) : ostream(nullptr), buffer(sink) { rdbuf(&buffer); }
+	virtual ~sink_ostream_t() { flush(); }
+};
+
+// Writes JSON text straight to a sink.  Commas are placed here, callers only open, close and fill in.
+class json_writer_t
+{
+	private:
+
+	OutputSink_t &sink;
+	vector<bool> first_in_level;	// one per open object or array
+	bool after_key;
+
+	void separate();
+	void raw(const char* s, const size_t size) { sink.write(s, size); }
+	void raw(const char c) { sink.write(&c, 1); }
+
+	public:
+
+	json_writer_t(OutputSink_t &p_sink);
+
+	void beginObject();
+	void endObject();
+	void beginArray();
+	void endArray();
+	void key(const char* name);
+	void value(const uint64_t v);
+	void value(const int64_t v);
+	void value(const string &s);
+	void hexValue(const uint8_t* const data, const size_t size);	// a string of hex digits
+	void newline() { raw('\n'); }
+
+	template <class T>
+	void member(const char* name, const T &v) { key(name); value(v); }
+};
+
+void write_json(const EHFrameParser_t &parser, OutputSink_t &sink, const EHPJSONFormat_t format);
+
+}
+#endif
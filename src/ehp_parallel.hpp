@@ -0,0 +1,78 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_parallel_hpp
+#define ehp_parallel_hpp
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// how many chunks to split count items into: one per hardware thread, or per thread of 
+// EHP_THREADS if it is set, but never so many that a chunk has fewer than min_per_chunk items.
+inline size_t parallel_chunk_count(const size_t count, const size_t min_per_chunk=256)
+{
+	const auto requested=getenv("EHP_THREADS");
+	const auto threads = requested!=nullptr && atoi(requested) > 0 ? 
+		static_cast<size_t>(atoi(requested)) : 
+		static_cast<size_t>(thread::hardware_concurrency());
+	return max(size_t(1), min(max(size_t(1), threads), count/min_per_chunk));
+}
+
+// run work(chunk, begin, end) for each of chunks contiguous slices of [0, count), 
+// concurrently, and wait for all of them.  slices are in order, so per-chunk 
+// results can be concatenated to get the sequential result.  work must not throw.
+template <class work_t>
+void parallel_for_chunks(const size_t count, const size_t chunks, const work_t &work)
+{
+	const auto chunk_begin=[&](const size_t chunk) { return count*chunk/chunks; };
+
+	auto threads=vector<thread>();
+	threads.reserve(chunks);
+	for(auto chunk=size_t(1); chunk < chunks; chunk++)
+	{
+		try
+		{
+			threads.push_back(thread([&work, chunk, chunk_begin]() { work(chunk, chunk_begin(chunk), chunk_begin(chunk+1)); }));
+		}
+		catch(const system_error &)
+		{
+			// out of threads, do this chunk here instead.
+			work(chunk, chunk_begin(chunk), chunk_begin(chunk+1));
+		}
+	}
+	work(0, chunk_begin(0), chunk_begin(1));
+	for(auto &t : threads)
+		t.join();
+}
+
+}
+#endif
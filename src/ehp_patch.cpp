@@ -0,0 +1,226 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <unordered_map>
+
+#include <ehp.hpp>
+#include "ehp_dwarf2.hpp"
+#include "ehp_encode.hpp"
+#include "ehp_parallel.hpp"
+#include "ehp_patch.hpp"
+
+using namespace std;
+using namespace EHP;
+
+namespace
+{
+
+// one section buffer being patched.
+class section_patcher_t
+{
+	public:
+
+	section_patcher_t(string &p_data, const uint64_t p_addr, const uint8_t p_ptrsize, const bool p_is_be)
+		:
+			data(reinterpret_cast<uint8_t*>(&p_data[0])),
+			addr(p_addr),
+			size(p_data.size()),
+			ptrsize(p_ptrsize),
+			is_be(p_is_be)
+	{
+	}
+
+	// write value with encoding into the width bytes at field, if it fits there exactly.
+	bool patch(const uint64_t field, const uint64_t width, const uint8_t encoding, const uint64_t value) const
+	{
+		if(field < addr || field-addr > size || width > size-(field-addr))
+			return true;
+		auto sizer=eh_section_writer_t(nullptr, addr, field-addr, ptrsize, is_be);
+		if(sizer.write_encoded(encoding, value, width) || sizer.getAddress()-field!=width)
+			return true;
+		auto out=eh_section_writer_t(data, addr, field-addr, ptrsize, is_be);
+		out.write_encoded(encoding, value, width);
+		return false;
+	}
+
+	private:
+
+	uint8_t* data;
+	uint64_t addr;
+	uint64_t size;
+	uint8_t ptrsize;
+	bool is_be;
+};
+
+// an FDE's range in the new layout.
+void map_range(const EHPAddressMap_t &map, const uint64_t start, const uint64_t end, uint64_t &new_start, uint64_t &new_end)
+{
+	new_start=map(start);
+	new_end = end > start ? map(end-1)+1 : new_start;
+}
+
+// the new value of each call site field of fde's LSDA, relative to the landing pad base: the FDE's 
+// new start, or the LSDA's own base, which stays.
+struct call_site_values_t
+{
+	uint64_t start;
+	uint64_t length;
+	uint64_t landing_pad;
+	bool bad_start;
+	bool bad_length;
+	bool bad_landing_pad;
+};
+
+void map_call_sites(const EHPAddressMap_t &map, const FDEContents_t &fde, const uint64_t new_fde_start, vector<call_site_values_t> &values)
+{
+	const auto &lsda=*fde.getLSDA();
+	const auto base = lsda.getLandingPadBaseEncoding()==DW_EH_PE_omit ? new_fde_start : lsda.getLandingPadBaseAddress();
+	values.clear();
+	for(const auto cs : *lsda.getCallSites())
+	{
+		auto start=uint64_t(0), end=uint64_t(0);
+		map_range(map, cs->getCallSiteAddress(), cs->getCallSiteEndAddress(), start, end);
+		const auto landing_pad = cs->getLandingPadAddress()==0 ? 0 : map(cs->getLandingPadAddress());
+		auto v=call_site_values_t();
+		v.start=start-base;
+		v.length=end-start;
+		v.landing_pad = landing_pad==0 ? 0 : landing_pad-base;
+		v.bad_start = start < base;
+		v.bad_length = end < start;
+		// a landing pad at offset 0 would read as none.
+		v.bad_landing_pad = landing_pad!=0 && landing_pad <= base;
+		values.push_back(v);
+	}
+}
+
+bool same_values(const vector<call_site_values_t> &a, const vector<call_site_values_t> &b)
+{
+	if(a.size()!=b.size())
+		return false;
+	for(auto i=size_t(0); i < a.size(); i++)
+	{
+		if(a[i].start!=b[i].start || a[i].length!=b[i].length || a[i].landing_pad!=b[i].landing_pad)
+			return false;
+	}
+	return true;
+}
+
+}
+
+bool EHP::patch_addresses(
+	const EHFrameParser_t &parser, 
+	const image_contents_t &contents, 
+	const EHPAddressMap_t &map, 
+	string &eh_frame, 
+	string &gcc_except_table, 
+	EHPPatchErrorVector_t &errors)
+{
+	errors.clear();
+	if(eh_frame.size()!=contents.eh_frame.size || gcc_except_table.size()!=contents.gcc_except_table.size)
+		return true;
+	const auto eh_frame_patcher=section_patcher_t(eh_frame, contents.eh_frame.addr, contents.ptrsize, contents.is_be);
+	const auto gcc_except_table_patcher=section_patcher_t(gcc_except_table, contents.gcc_except_table.addr, contents.ptrsize, contents.is_be);
+
+	for(const auto cie : *parser.getCIEs())
+	{
+		if(cie->getPersonalityPointerSize()==0 || cie->getPersonality()==0)
+			continue;
+		const auto personality=map(cie->getPersonality());
+		if(eh_frame_patcher.patch(cie->getPersonalityPointerPosition(), cie->getPersonalityPointerSize(), cie->getPersonalityEncoding(), personality))
+			errors.push_back({PATCH_PERSONALITY, cie->getPersonalityPointerPosition(), personality});
+	}
+
+	// an LSDA shared by several FDEs is patched for the first of them, and checked against the 
+	// others.  the first FDE's values are worked out here, before the chunks start, since its 
+	// LSDA fills caches on first use and another chunk may be reading it.
+	const auto &fdes=*parser.getFDEs();
+	auto lsda_owners=unordered_map<uint64_t, size_t>();
+	auto shared_values=unordered_map<size_t, vector<call_site_values_t> >();
+	for(auto i=size_t(0); i < fdes.size(); i++)
+	{
+		if(fdes[i]->getLSDAAddress()==0 || fdes[i]->getLSDA()==nullptr)
+			continue;
+		const auto owner=lsda_owners.insert({fdes[i]->getLSDAAddress(), i}).first->second;
+		if(owner==i || shared_values.count(owner)!=0)
+			continue;
+		auto owner_start=uint64_t(0), owner_end=uint64_t(0);
+		map_range(map, fdes[owner]->getStartAddress(), fdes[owner]->getEndAddress(), owner_start, owner_end);
+		map_call_sites(map, *fdes[owner], owner_start, shared_values[owner]);
+	}
+
+	// every field is written in place, so chunks of FDEs are patched concurrently.
+	const auto chunks=parallel_chunk_count(fdes.size());
+	auto chunk_errors=vector<EHPPatchErrorVector_t>(chunks);
+	parallel_for_chunks(fdes.size(), chunks, [&](const size_t chunk, const size_t begin, const size_t end)
+		{
+			auto &errs=chunk_errors[chunk];
+			auto values=vector<call_site_values_t>();
+			for(auto i=begin; i < end; i++)
+			{
+				const auto &fde=*fdes[i];
+				const auto &cie=fde.getCIE();
+				const auto fde_encoding = cie.getFDEEncoding()==DW_EH_PE_omit ? uint8_t(DW_EH_PE_absptr) : cie.getFDEEncoding();
+				auto new_start=uint64_t(0), new_end=uint64_t(0);
+				map_range(map, fde.getStartAddress(), fde.getEndAddress(), new_start, new_end);
+				const auto start_width=fde.getEndAddressPosition()-fde.getStartAddressPosition();
+				if(eh_frame_patcher.patch(fde.getStartAddressPosition(), start_width, fde_encoding, new_start))
+					errs.push_back({PATCH_FDE_START, fde.getStartAddressPosition(), new_start});
+				if(new_end < new_start || eh_frame_patcher.patch(fde.getEndAddressPosition(), fde.getEndAddressSize(), fde_encoding & 0x0f, new_end-new_start))
+					errs.push_back({PATCH_FDE_RANGE, fde.getEndAddressPosition(), new_end-new_start});
+
+				if(fde.getLSDAAddress()==0 || fde.getLSDA()==nullptr)
+					continue;
+				const auto new_lsda=map(fde.getLSDAAddress());
+				if(eh_frame_patcher.patch(fde.getLSDAAddressPosition(), fde.getLSDAAddressSize(), cie.getLSDAEncoding(), new_lsda))
+					errs.push_back({PATCH_FDE_LSDA, fde.getLSDAAddressPosition(), new_lsda});
+
+				map_call_sites(map, fde, new_start, values);
+				const auto owner=lsda_owners.find(fde.getLSDAAddress())->second;
+				if(owner!=i)
+				{
+					if(!same_values(values, shared_values.find(owner)->second))
+						errs.push_back({PATCH_SHARED_LSDA, fde.getLSDAAddressPosition(), new_lsda});
+					continue;
+				}
+
+				const auto encoding=fde.getLSDA()->getCallSiteTableEncoding();
+				const auto &call_sites=*fde.getLSDA()->getCallSites();
+				for(auto j=size_t(0); j < call_sites.size(); j++)
+				{
+					const auto &cs=*call_sites[j];
+					const auto &v=values[j];
+					const auto start_pos=cs.getCallSiteAddressPosition();
+					const auto length_pos=cs.getCallSiteEndAddressPosition();
+					const auto lp_pos=cs.getLandingPadAddressPosition();
+					if(v.bad_start || gcc_except_table_patcher.patch(start_pos, length_pos-start_pos, encoding, v.start))
+						errs.push_back({PATCH_CALL_SITE_START, start_pos, v.start});
+					if(v.bad_length || gcc_except_table_patcher.patch(length_pos, lp_pos-length_pos, encoding, v.length))
+						errs.push_back({PATCH_CALL_SITE_LENGTH, length_pos, v.length});
+					if(v.bad_landing_pad || gcc_except_table_patcher.patch(lp_pos, cs.getLandingPadAddressEndPosition()-lp_pos, encoding, v.landing_pad))
+						errs.push_back({PATCH_LANDING_PAD, lp_pos, v.landing_pad});
+				}
+			}
+		});
+	for(const auto &errs : chunk_errors)
+		errors.insert(errors.end(), errs.begin(), errs.end());
+	return !errors.empty();
+}
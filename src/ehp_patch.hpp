@@ -0,0 +1,49 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_patch_hpp
+#define ehp_patch_hpp
+
+#include <stdint.h>
+#include <string>
+
+#include <ehp.hpp>
+#include "ehp_image.hpp"
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// contents gives the sections' addresses and sizes.  returns true if the buffers do not match 
+// them or any field could not be patched.
+bool patch_addresses(
+	const EHFrameParser_t &parser, 
+	const image_contents_t &contents, 
+	const EHPAddressMap_t &map, 
+	string &eh_frame, 
+	string &gcc_except_table, 
+	EHPPatchErrorVector_t &errors);
+
+}
+#endif
@@ -31,11 +31,24 @@
 #include <string.h>
 #include <map>
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <type_traits>
 
 #include "ehp_dwarf2.hpp"
 #include "scoop_replacement.hpp"
+#include "ehp_cfa.hpp"
+#include "ehp_index.hpp"
+#include "ehp_memory.hpp"
+#include "ehp_compact.hpp"
+#include "ehp_encode.hpp"
+#include "ehp_facts.hpp"
+#include "ehp_patch.hpp"
+#include "ehp_image.hpp"
+#include "ehp_output.hpp"
 
 
 namespace EHP
@@ -44,6 +57,174 @@ namespace EHP
 using namespace std;
 
 
+// A read cursor over a bounded range of a section, typically one CIE or FDE.
+// open_record validates a record's extent against the section once, after which
+// every read is bounded by the record's end rather than the section's.  Fixed-width
+// loads go through memcpy so unaligned fields are safe.  Positions are section offsets.
+class eh_record_cursor_t
+{
+	public:
+
+	eh_record_cursor_t() : data(nullptr), position(0), end(0), is_be(false) {}
+	eh_record_cursor_t(const uint8_t* const p_data, const uint64_t p_position, const uint64_t p_end, const bool p_is_be) 
+		: data(p_data), position(p_position), end(p_end), is_be(p_is_be) 
+	{}
+
+	// read the length field of the record at record_position and bound the cursor to the record.
+	// the cursor is left just past the length field.  every CIE/FDE starts with a 4-byte id, 
+	// so records too short to hold one are rejected here too.
+	static bool open_record(
+		eh_record_cursor_t &cursor, 
+		uint64_t &length, 
+		const uint64_t record_position, 
+		const uint8_t* const data, 
+		const uint64_t max, 
+		const bool is_be)
+	{
+		auto section=eh_record_cursor_t(data, record_position, max, is_be);
+		auto length_32bit=uint32_t(0);
+		if(section.read_type(length_32bit))
+			return true;
+		length=length_32bit;
+		if(length_32bit==0xffffffff && section.read_type(length))
+			return true;
+		if(length < sizeof(uint32_t) || length > section.remaining())
+			return true;
+		cursor=eh_record_cursor_t(data, section.getPosition(), section.getPosition()+length, is_be);
+		return false;
+	}
+
+	uint64_t getPosition() const { return position; }
+	uint64_t getEnd() const { return end; }
+	uint64_t remaining() const { return position < end ? end-position : 0; }
+	bool isBigEndian() const { return is_be; }
+	const uint8_t* getData() const { return data; }
+
+	// load a value in the given byte order from possibly-unaligned memory.
+	template <class T> 
+	static T load(const uint8_t* const p, const bool is_be)
+	{
+		static_assert(is_integral<T>::value, "load requires an integer type");
+		using U = typename make_unsigned<T>::type;
+		auto raw=U(0);
+		memcpy(&raw, p, sizeof(U));
+		if(is_be != host_is_be())
+		{
+			auto swapped=U(0);
+			for(auto i=size_t(0); i<sizeof(U); i++)
+			{
+				swapped = static_cast<U>((static_cast<uint64_t>(swapped) << 8) | (raw & 0xff));
+				raw = static_cast<U>(static_cast<uint64_t>(raw) >> 8);
+			}
+			raw=swapped;
+		}
+		auto value=T(0);
+		memcpy(&value, &raw, sizeof(T));
+		return value;
+	}
+
+	// caller guarantees remaining() >= sizeof(T).
+	template <class T> 
+	T read_unchecked()
+	{
+		const auto value=load<T>(&data[position], is_be);
+		position+=sizeof(T);
+		return value;
+	}
+
+	// read_type, with the bounds check left out if checked is false.  callers that have checked 
+	// room for a run of fixed-width fields at once read them with checked false.
+	template <class T, bool checked> 
+	bool read_fixed(T &value)
+	{
+		if(checked && remaining() < sizeof(T))
+			return true;
+		value=read_unchecked<T>();
+		return false;
+	}
+
+	template <class T> 
+	bool read_type(T &value)
+	{
+		return read_fixed<T, true>(value);
+	}
+
+	bool skip(const uint64_t amount)
+	{
+		if(remaining() < amount)
+			return true;
+		position+=amount;
+		return false;
+	}
+
+	bool read_string(string &s)
+	{
+		const auto start=position;
+		while(position < end && data[position]!='\0')
+			position++;
+		if(position >= end)
+			return true;
+		s.assign(reinterpret_cast<const char*>(&data[start]), position-start);
+		position++;
+		return false;
+	}
+
+	// see https://en.wikipedia.org/wiki/LEB128
+	bool read_uleb128(uint64_t &result)
+	{
+		result=0;
+		auto shift=0u;
+		while(position < end)
+		{
+			const auto byte=data[position++];
+			if(shift < 64)
+				result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			if((byte & 0x80) == 0)
+				return false;
+			shift += 7;
+		}
+		return true;
+	}
+
+	// see https://en.wikipedia.org/wiki/LEB128
+	bool read_sleb128(int64_t &result)
+	{
+		auto uresult=uint64_t(0);
+		auto shift=0u;
+		auto byte=uint8_t(0);
+		do
+		{
+			if(position >= end)
+				return true;
+			byte=data[position++];
+			if(shift < 64)
+				uresult |= static_cast<uint64_t>(byte & 0x7f) << shift;
+			shift += 7;
+		} while((byte & 0x80) != 0);
+
+		/* sign bit of byte is second high order bit (0x40) */
+		if(shift < 64 && (byte & 0x40) != 0)
+			uresult |= ~uint64_t(0) << shift;
+		result=static_cast<int64_t>(uresult);
+		return false;
+	}
+
+	private:
+
+	static bool host_is_be()
+	{
+		const auto probe=uint16_t(1);
+		auto first=uint8_t(0);
+		memcpy(&first, &probe, 1);
+		return first==0;
+	}
+
+	const uint8_t* data;
+	uint64_t position;
+	uint64_t end;
+	bool is_be;
+};
+
 template <int ptrsize>
 class eh_frame_util_t 
 {
@@ -61,6 +242,15 @@ class eh_frame_util_t
 		const bool is_be
 	       	);
 
+	// with checked false, the caller guarantees room for a fixed-size encoding's value.  leb128 
+	// values are always checked, byte by byte.
+	template <class T, bool checked=true> 
+	static bool read_type_with_encoding (
+		const uint8_t encoding, T &value, 
+		eh_record_cursor_t &cursor,
+		const uint64_t section_start_addr
+	       	);
+
 	static bool read_string (
 		string &s, 
 		uint64_t &position,
@@ -94,36 +284,80 @@ class eh_frame_util_t
 		);
 };
 
+// The .eh_frame_hdr section: a pointer to .eh_frame and a table of (initial location, 
+// FDE address) pairs sorted by initial location, for binary search by unwinders.
+template <int ptrsize>
+class eh_frame_hdr_t : private eh_frame_util_t<ptrsize>
+{
+	private:
+
+	uint8_t version;
+	uint8_t eh_frame_ptr_encoding;
+	uint8_t fde_count_encoding;
+	uint8_t table_encoding;
+	uint64_t eh_frame_ptr;
+	uint64_t fde_count;
+	uint64_t table_position;
+
+	public:
+
+	eh_frame_hdr_t();
+
+	// decode the header and, if table is not null, the search table.
+	// returns true if the section is malformed or has no table.
+	bool parse(
+		const uint8_t* const data, 
+		const uint64_t max, 
+		const uint64_t hdr_addr, 
+		const bool is_be, 
+		EHPSearchTable_t *table
+		);
+
+	uint8_t getVersion() const { return version; }
+	uint8_t getEHFramePtrEncoding() const { return eh_frame_ptr_encoding; }
+	uint8_t getFDECountEncoding() const { return fde_count_encoding; }
+	uint8_t getTableEncoding() const { return table_encoding; }
+	uint64_t getEHFramePtr() const { return eh_frame_ptr; }
+	uint64_t getFDECount() const { return fde_count; }
+	uint64_t getTablePosition() const { return table_position; }
+};
+
 template <int ptrsize>
 class eh_program_insn_t  : public EHProgramInstruction_t
 {
 	public: 
 	
 	eh_program_insn_t() ;
-	eh_program_insn_t(const string &s) ;
+	eh_program_insn_t(const string &s, const bool is_be=false) ;
 
-	void print(uint64_t &pc, int64_t caf) const;
+	void print(uint64_t &pc, int64_t caf) const { print(cout, pc, caf); }
+	void print(ostream &out, uint64_t &pc, int64_t caf) const;
 	tuple<string, int64_t, int64_t> decode() const;
 	uint64_t getSize() const { return program_bytes.size(); }
 	void push_byte(uint8_t c) ;
 
 	static void print_uleb_operand(
+		ostream &out,
 		uint64_t pos,
 		const uint8_t* const data, 
 		const uint64_t max) ;
 
 	static void print_sleb_operand(
+		ostream &out,
 		uint64_t pos,
 		const uint8_t* const data, 
 		const uint64_t max) ;
 
+	// address_encoding is the CIE's FDE pointer encoding, which DW_CFA_set_loc's operand uses. 
+	// section_addr is the address of the cursor's section, for pc-relative operands.
 	bool parse_insn(
 		uint8_t opcode, 
-		uint64_t &pos,
-		const uint8_t* const data, 
-		const uint64_t &max,
-		const bool is_be
+		eh_record_cursor_t &cursor,
+		const uint8_t address_encoding,
+		const uint64_t section_addr
 		);
+	// rebuild the instruction at position in an image's .eh_frame, without decoding it again.
+	void restore(const image_section_t &eh_frame, const uint64_t position, const uint64_t size, const bool is_be, const uint8_t address_encoding);
 
 	bool isNop() const ;
 	bool isDefCFAOffset() const ;
@@ -131,13 +365,24 @@ class eh_program_insn_t  : public EHProgramInstruction_t
 	bool isRememberState() const ;
 
 	bool advance(uint64_t &cur_addr, uint64_t CAF) const ;
+	bool getExpression(EHPExpressionOpVector_t &ops) const ;
 
 	const vector<uint8_t>& getBytes() const ;
 	vector<uint8_t>& getBytes() ;
+	// heap bytes held beyond the object itself.
+	uint64_t getMemoryUsage() const { return vector_bytes(program_bytes); }
 
 	private:
 
+	// operands read safely from program_bytes in the target's byte order.  set_loc's address is 
+	// decoded with address_encoding, as if its operand were at operand_addr.
+	bool read_address_operand(uint64_t &addr) const ;
+	bool read_advance_operand(uint64_t &delta) const ;
+
 	vector<uint8_t> program_bytes;
+	bool is_be;
+	uint8_t address_encoding;
+	uint64_t operand_addr;
 };
 
 template <int ptrsize>
@@ -147,21 +392,29 @@ template <int ptrsize>
 class eh_program_t : public EHProgram_t
 {
 	public:
+	eh_program_t() : position(0) {}
 	void push_insn(const eh_program_insn_t<ptrsize> &i); 
 
-	void print(const uint64_t start_addr, const int64_t caf) const;
+	void print(const uint64_t start_addr, const int64_t caf) const { print(cout, start_addr, caf); }
+	void print(ostream &out, const uint64_t start_addr, const int64_t caf) const;
 
-	bool parse_program(
-		const uint64_t& program_start_position,
-		const uint8_t* const data, 
-		const uint64_t &max_program_pos,
-		const bool is_be
-		);
+	// parse instructions from the cursor up to the end of its record.  see parse_insn for 
+	// address_encoding and section_addr.
+	bool parse_program(eh_record_cursor_t &cursor, const uint8_t address_encoding, const uint64_t section_addr);
+	// add the program to an image's records, or rebuild it from them.
+	void describe(image_program_t &record, image_records_t &records) const;
+	void restore(const image_program_t &record, const image_contents_t &contents, const uint8_t address_encoding);
         virtual const EHProgramInstructionVector_t* getInstructions() const ;
+	// fill the pointer caches the getters return.  call once the object is at its final address, 
+	// before other threads can see it; the getters then only read.
+	void build_caches() const;
 	vector<eh_program_insn_t <ptrsize> >& getInstructionsInternal() ;
 	const vector<eh_program_insn_t <ptrsize> >& getInstructionsInternal() const ;
+	// see eh_program_insn_t::getMemoryUsage.
+	uint64_t getMemoryUsage() const;
 
 	private:
+	uint64_t position;	// of the first instruction, in the parsed section
 	vector<eh_program_insn_t <ptrsize> > instructions;
 	mutable EHProgramInstructionVector_t instructions_cache;
 };
@@ -195,6 +448,10 @@ class cie_contents_t : public CIEContents_t, private eh_frame_util_t<ptrsize>
 	cie_contents_t() ;
 	
 	const eh_program_t<ptrsize>& getProgram() const ;
+	// see eh_program_t::build_caches.
+	void build_caches() const { eh_pgm.build_caches(); }
+	// see eh_program_insn_t::getMemoryUsage.
+	uint64_t getMemoryUsage() const { return string_bytes(augmentation)+eh_pgm.getMemoryUsage(); }
 	uint64_t getPosition() const { return cie_position; }
 	uint64_t getLength() const { return length; }
 	uint64_t getCAF() const ;
@@ -208,6 +465,7 @@ class cie_contents_t : public CIEContents_t, private eh_frame_util_t<ptrsize>
 	string getAugmentation() const ;
 	uint8_t getLSDAEncoding() const ;
 	uint8_t getFDEEncoding() const ;
+	uint8_t getVersion() const { return cie_version; }
 
 	bool parse_cie(
 		const uint64_t &cie_position,
@@ -216,7 +474,12 @@ class cie_contents_t : public CIEContents_t, private eh_frame_util_t<ptrsize>
 		const uint64_t eh_addr,
 		const bool is_be
 		);
-	void print(const uint64_t startAddr) const ;
+	// see eh_program_t::describe.
+	void describe(image_cie_t &record, image_records_t &records) const;
+	void restore(const image_cie_t &record, const image_contents_t &contents);
+	void print(const uint64_t startAddr) const { print(cout, startAddr); }
+	void print(OutputSink_t &out, const uint64_t startAddr) const { sink_ostream_t stream(out); print(stream, startAddr); }
+	void print(ostream &out, const uint64_t startAddr) const;
 };
 
 template <int ptrsize>
@@ -230,7 +493,9 @@ class lsda_call_site_action_t : public LSDACallSiteAction_t, private eh_frame_ut
 	int64_t getAction() const ;
 
 	bool parse_lcsa(uint64_t &pos, const uint8_t* const data, const uint64_t max, bool &end, const bool is_be);
-	void print() const;
+	void restore(const int64_t p_action) { action=p_action; }
+	void print() const { print(cout); }
+	void print(ostream &out) const;
 };
 
 template <int ptrsize>
@@ -260,8 +525,12 @@ class lsda_type_table_entry_t: public LSDATypeTableEntry_t, private eh_frame_uti
 		const uint64_t data_addr,
 		const bool is_be
 		);
+	// see eh_program_t::describe.
+	void describe(image_type_entry_t &record) const;
+	void restore(const image_type_entry_t &record);
 
-	void print() const;
+	void print() const { print(cout); }
+	void print(ostream &out) const;
 	
 };
 
@@ -290,6 +559,10 @@ class lsda_call_site_t : public LSDACallSite_t, private eh_frame_util_t<ptrsize>
 	lsda_call_site_t() ;
 
 	const LSDACallSiteActionVector_t* getActionTable() const;
+	// see eh_program_t::build_caches.
+	void build_caches() const;
+	// see eh_program_insn_t::getMemoryUsage.
+	uint64_t getMemoryUsage() const { return vector_bytes(action_table)+vector_bytes(action_table_cache); }
 	const vector<lsda_call_site_action_t <ptrsize> >& getActionTableInternal() const { return action_table; }
 	      vector<lsda_call_site_action_t <ptrsize> >& getActionTableInternal()       { return action_table; }
 
@@ -313,8 +586,12 @@ class lsda_call_site_t : public LSDACallSite_t, private eh_frame_util_t<ptrsize>
 		const uint64_t gcc_except_table_max,
 		const bool is_be
 		);
+	// see eh_program_t::describe.
+	void describe(image_call_site_t &record, image_records_t &records) const;
+	void restore(const image_call_site_t &record, const image_contents_t &contents);
 
-	void print() const;
+	void print() const { print(cout); }
+	void print(ostream &out) const;
 
 
 };
@@ -361,12 +638,17 @@ class lsda_t : public LSDA_t, private eh_frame_util_t<ptrsize>
 
 	uint8_t getTTEncoding() const ;
 	bool parse_lsda(const uint64_t lsda_addr, 
-			const ScoopReplacement_t* gcc_except_scoop_data,
+			const image_section_t &gcc_except_table,
 	                const uint64_t fde_region_start,
 			const bool is_be
 	                );
-	void print() const;
+	// see eh_program_t::describe.
+	void describe(image_lsda_t &record, image_records_t &records) const;
+	void restore(const image_lsda_t &record, const image_contents_t &contents);
+	void print() const { print(cout); }
+	void print(ostream &out) const;
 	uint64_t getLandingPadBaseAddress() const {  return landing_pad_base_addr; }
+	uint8_t getLandingPadBaseEncoding() const { return landing_pad_base_encoding; }
 	const CallSiteVector_t* getCallSites() const ;
 	uint64_t getCallSiteTableAddress() const { return cs_table_start_addr; }
 	uint64_t getCallSiteTableAddressLocation() const { return cs_table_start_addr_location; }
@@ -374,6 +656,10 @@ class lsda_t : public LSDA_t, private eh_frame_util_t<ptrsize>
 	uint8_t getCallSiteTableEncoding() const { return cs_table_encoding; }
 	const call_site_table_t<ptrsize> getCallSitesInternal() const { return call_site_table;}
 	const TypeTableVector_t* getTypeTable() const ;
+	// see eh_program_t::build_caches.
+	void build_caches() const;
+	// see eh_program_insn_t::getMemoryUsage.
+	uint64_t getMemoryUsage() const;
 	uint64_t getTypeTableAddress() const { return type_table_addr; }
 	uint64_t getTypeTableAddressLocation() const { return type_table_addr_location; }
 	uint8_t getTypeTableEncoding() const { return type_table_encoding; }
@@ -403,14 +689,25 @@ class fde_contents_t : public FDEContents_t, eh_frame_util_t<ptrsize>
 	eh_program_t<ptrsize> eh_pgm;
 	cie_contents_t<ptrsize> cie_info;
 
+	// evaluated on first call to getCFATable.  threads racing to evaluate it publish the 
+	// first result atomically, so only ever use these through the atomic_* functions.
+	mutable shared_ptr<cfa_table_t> cfa_table;
+	// computed on first call to getFrameSummary, and published the same way.
+	mutable shared_ptr<EHPFrameSummary_t> frame_summary;
+	// the owning parser's getMemoryUsage() total, charged for the table and summary as they 
+	// are published.  null for FDEs no parser owns.
+	atomic<uint64_t>* memory_usage;
+
 	public:
 	fde_contents_t() ;
 	fde_contents_t(const uint64_t start_addr, const uint64_t end_addr)
 		: 
 		fde_start_addr(start_addr),
-		fde_end_addr(end_addr)
+		fde_end_addr(end_addr),
+		memory_usage(nullptr)
 	{} 
 	uint64_t getPosition() const { return fde_position; }
+	uint64_t getCIEPosition() const { return cie_position; } // offset into .eh_frame, as printed
 	uint64_t getLength() const { return length; }
 	uint64_t getStartAddress() const { return fde_start_addr; } 
 	uint64_t getEndAddress() const {return fde_end_addr; }
@@ -434,16 +731,30 @@ class fde_contents_t : public FDEContents_t, eh_frame_util_t<ptrsize>
 	uint64_t getLSDAAddressPosition() const { return fde_lsda_addr_position; }
 	uint64_t getLSDAAddressSize() const { return fde_lsda_addr_size; }
 
+	const CFATable_t* getCFATable() const ;
+	const EHPFrameSummary_t& getFrameSummary() const ;
+	// see eh_program_t::build_caches.
+	void build_caches() const;
+	// see eh_program_insn_t::getMemoryUsage.  the CFA table and summary are charged to 
+	// the account when they are built, and are not included.
+	uint64_t getMemoryUsage() const { return eh_pgm.getMemoryUsage()+lsda.getMemoryUsage()+cie_info.getMemoryUsage(); }
+	void setMemoryAccount(atomic<uint64_t>* account) { memory_usage=account; }
+
 	bool parse_fde(
 		const uint64_t &fde_position,
 		const uint64_t &cie_position,
 		const uint8_t* const data, 
 		const uint64_t max,
 		const uint64_t eh_addr,
-		const ScoopReplacement_t *gcc_except_scoop,
+		const image_section_t &gcc_except_table,
 		const bool is_be);
+	// see eh_program_t::describe.  the caller fills in the record's CIE index.
+	void describe(image_fde_t &record, image_records_t &records) const;
+	void restore(const image_fde_t &record, const image_contents_t &contents);
 
-	void print() const;
+	void print() const { print(cout); }
+	void print(OutputSink_t &out) const { sink_ostream_t stream(out); print(stream); }
+	void print(ostream &out) const;
 
 
 };
@@ -452,8 +763,99 @@ template <int ptrsize>
 bool operator<(const fde_contents_t<ptrsize>& a, const fde_contents_t<ptrsize>& b) { return a.getFDEEndAddress()-1 < b.getFDEStartAddress(); }
 
 
+// The tables and lookups derived from getFDEs(), built on first use.  Shared by 
+// parsers and anything else that can produce the FDE list.
+class eh_frame_tables_t : public EHFrameParser_t
+{
+	private:
+
+	// each table is built once, by whichever thread asks first, while any others wait.
+	mutable EHPUnwindTable_t unwind_table_cache;
+	mutable once_flag unwind_table_once;
+	mutable EHPCFAOffsetTable_t cfa_offset_table_cache;
+	mutable once_flag cfa_offset_table_once;
+	mutable call_site_index_t call_site_index_cache;
+	mutable once_flag call_site_index_once;
+	mutable EHPExceptionGraph_t exception_graph_cache;
+	mutable once_flag exception_graph_once;
+	mutable EHPCatchIndex_t catch_index_cache;
+	mutable once_flag catch_index_once;
+	mutable fde_index_t fde_index_cache;
+	mutable once_flag fde_index_once;
+	mutable EHPSymbolJoin_t symbol_join_cache;
+	mutable once_flag symbol_join_once;
+
+	const fde_index_t& getFDEIndex() const;
+
+	protected:
+
+	// what getMemoryUsage() reports.  parsers add their records once they have them, and 
+	// the tables above, the FDEs' CFA tables and their summaries are added as they are built.
+	mutable atomic<uint64_t> memory_usage;
+
+	// describe this parser as image contents and pass them to use, which is called at most once.
+	// returns true if the contents could not be described or use returned true.
+	virtual bool withImageContents(const function<bool(const image_contents_t&)> &use) const =0;
+
+	EHPParseErrorVector_t parse_errors;
+	EHPAddressRangeVector_t executable_ranges;
+	EHPSymbolVector_t symbols;
+
+	eh_frame_tables_t(const EHPAddressRangeVector_t &p_executable_ranges, const EHPSymbolVector_t &p_symbols)
+		:
+			memory_usage(0),
+			executable_ranges(p_executable_ranges),
+			symbols(p_symbols)
+	{
+		memory_usage+=vector_bytes(executable_ranges)+vector_bytes(symbols);
+		for(const auto &sym : symbols)
+			memory_usage+=string_bytes(sym.name);
+	}
+
+	public:
+
+        virtual const EHPParseErrorVector_t* getParseErrors() const { return &parse_errors; }
+        virtual uint64_t getMemoryUsage() const { return memory_usage.load(); }
+        virtual const EHPUnwindTable_t* getUnwindTable() const;
+        virtual const EHPUnwindEntry_t* findUnwindEntry(uint64_t addr) const;
+        virtual const EHPCFAOffsetTable_t* getCFAOffsetTable() const;
+        virtual void computeFrameSummaries() const;
+        virtual const EHPCallSiteIndex_t* getCallSiteIndex() const;
+        virtual const EHPCallSiteIndexEntry_t* findCallSite(uint64_t pc) const;
+        virtual void findCallSites(const vector<uint64_t>& pcs, EHPCallSiteLookupVector_t& results) const;
+        virtual const EHPExceptionGraph_t* getExceptionGraph() const;
+        virtual const EHPCatchIndex_t* getCatchIndex() const;
+        virtual const EHPCatchSiteVector_t* findCatchSites(uint64_t type_info_pointer) const;
+        virtual const FDEContents_t* findFDEByPosition(uint64_t position) const;
+        virtual const FDEVector_t* findFDEsByLSDA(uint64_t lsda_addr) const;
+        virtual const FDEVector_t* findFDEsByPersonality(uint64_t personality) const;
+        virtual const EHPAddressRangeVector_t* getExecutableRanges() const { return &executable_ranges; }
+        virtual void getCoverageGaps(const EHPAddressRangeVector_t& ranges, EHPAddressRangeVector_t& gaps) const;
+        virtual void getCoverageMap(const EHPAddressRangeVector_t& ranges, EHPCoverageMap_t& map) const;
+        virtual const EHPSymbolVector_t* getSymbols() const { return &symbols; }
+        virtual const EHPSymbolJoin_t* getSymbolJoin() const;
+        virtual void joinSymbols(const EHPSymbolVector_t& symbols, EHPSymbolJoin_t& join) const;
+        virtual bool writeImage(const string &filename, const string &key) const;
+        virtual int publishImage(const string &key) const;
+        virtual void writeJSON(OutputSink_t &sink, EHPJSONFormat_t format=JSON_DOCUMENT) const;
+        virtual void print() const;
+        virtual void print(OutputSink_t &out) const;
+        virtual void getFacts(EHPFacts_t &facts) const;
+        virtual bool writeFacts(const string &directory) const;
+        virtual void getModel(EHPSectionModel_t &model) const;
+        virtual void getSearchTable(EHPSearchTable_t &table) const;
+        virtual void checkSearchTable(const EHPSearchTable_t &table, EHPSearchTableIssueVector_t &issues) const;
+        virtual bool patchAddresses(const EHPAddressMap_t &map, string &eh_frame_data, string &gcc_except_table_data, EHPPatchErrorVector_t &errors) const;
+};
+
+// a view of a scoop's bytes, valid as long as the scoop is.
+inline image_section_t scoop_section(const ScoopReplacement_t &scoop)
+{
+	return {reinterpret_cast<const uint8_t*>(scoop.getContents().data()), scoop.getContents().size(), scoop.getStart()};
+}
+
 template <int ptrsize>
-class split_eh_frame_impl_t : public EHFrameParser_t
+class split_eh_frame_impl_t : public eh_frame_tables_t
 {
 	private: 
 
@@ -461,39 +863,130 @@ class split_eh_frame_impl_t : public EHFrameParser_t
 	unique_ptr<ScoopReplacement_t> eh_frame_hdr_scoop;
 	unique_ptr<ScoopReplacement_t> gcc_except_table_scoop;
 
+	// the caches are filled at the end of parse(), so that getters only read.
 	vector<cie_contents_t <ptrsize> > cies;
-	mutable CIEVector_t cies_cache;
+	CIEVector_t cies_cache;
 
 	set<fde_contents_t <ptrsize> > fdes;
-	mutable FDEVector_t fdes_cache;
+	FDEVector_t fdes_cache;
 
+	EHPParseMode_t parse_mode;
+	bool data_is_be;
 
 	bool iterate_fdes(const bool is_be);
 
+	// record a malformed record.  returns true if parsing should stop.
+	bool record_parse_error(const EHPParseErrorKind_t kind, const uint64_t position, const uint64_t length);
+
 	public:
 
 	split_eh_frame_impl_t
 		(
 		const ScoopReplacement_t &eh_frame,
 		const ScoopReplacement_t &eh_frame_hdr,
-		const ScoopReplacement_t &gcc_except_table 
+		const ScoopReplacement_t &gcc_except_table,
+		const EHPParseMode_t p_parse_mode=PARSE_STRICT,
+		const EHPAddressRangeVector_t &p_executable_ranges=EHPAddressRangeVector_t(),
+		const EHPSymbolVector_t &p_symbols=EHPSymbolVector_t()
 		)
 		:
+			eh_frame_tables_t(p_executable_ranges, p_symbols),
 			eh_frame_scoop(new ScoopReplacement_t(eh_frame)),
 			eh_frame_hdr_scoop(new ScoopReplacement_t(eh_frame_hdr)),
-			gcc_except_table_scoop(new ScoopReplacement_t(gcc_except_table))
+			gcc_except_table_scoop(new ScoopReplacement_t(gcc_except_table)),
+			parse_mode(p_parse_mode),
+			data_is_be(false)
 	{
 	}
 
 	bool parse(const bool is_be);
-	void print() const;
 
         virtual const FDEVector_t* getFDEs() const;
         virtual const CIEVector_t* getCIEs() const;
         virtual const FDEContents_t* findFDE(uint64_t addr) const; 
 
+	protected:
+
+	bool withImageContents(const function<bool(const image_contents_t&)> &use) const;
+};
+
+template <int ptrsize>
+class image_eh_frame_impl_t;
+
+// An FDE from an image.  The addresses and positions come straight from the image record, 
+// anything else is rebuilt from the image's records on first use.
+template <int ptrsize>
+class image_fde_proxy_t : public FDEContents_t
+{
+	private:
+
+	const image_fde_t* record;
+	const image_eh_frame_impl_t<ptrsize>* owner;
+	mutable once_flag contents_once;
+	mutable unique_ptr<fde_contents_t<ptrsize> > contents;
+
+	const fde_contents_t<ptrsize>& getContents() const;
+
+	public:
+
+	image_fde_proxy_t() : record(nullptr), owner(nullptr) {}
+	void init(const image_fde_t* p_record, const image_eh_frame_impl_t<ptrsize>* p_owner) { record=p_record; owner=p_owner; }
+
+	uint64_t getPosition() const { return record->position; }
+	uint64_t getLength() const { return record->length; }
+	uint64_t getStartAddress() const { return record->start_addr; }
+	uint64_t getEndAddress() const { return record->end_addr; }
+	const CIEContents_t& getCIE() const { return getContents().getCIE(); }
+	const EHProgram_t& getProgram() const { return getContents().getProgram(); }
+	const LSDA_t* getLSDA() const { return getContents().getLSDA(); }
+	uint64_t getLSDAAddress() const { return record->lsda_addr; }
+	uint64_t getStartAddressPosition() const { return record->start_addr_position; }
+	uint64_t getEndAddressPosition() const { return record->end_addr_position; }
+	uint64_t getEndAddressSize() const { return record->end_addr_size; }
+	uint64_t getLSDAAddressPosition() const { return record->lsda_addr_position; }
+	uint64_t getLSDAAddressSize() const { return record->lsda_addr_size; }
+	const CFATable_t* getCFATable() const { return getContents().getCFATable(); }
+	const EHPFrameSummary_t& getFrameSummary() const { return getContents().getFrameSummary(); }
+	void print() const { getContents().print(); }
+	void print(OutputSink_t &out) const { getContents().print(out); }
+};
+
+// A parser loaded from an image written by writeImage.  Loading only maps the file and 
+// points a proxy at each FDE record.  CIEs, symbols and FDE contents are rebuilt from the 
+// image's decoded records on first use; nothing is parsed again.
+template <int ptrsize>
+class image_eh_frame_impl_t : public eh_frame_tables_t
+{
+	private:
+
+	unique_ptr<mapped_image_t> image;
+	// the mapped sections and records.
+	image_contents_t contents;
+	unique_ptr<image_fde_proxy_t<ptrsize>[]> fde_proxies;
+	FDEVector_t fdes;
+
+	mutable vector<cie_contents_t <ptrsize> > cies;
+	mutable CIEVector_t cies_cache;
+	mutable once_flag cies_once;
+	mutable EHPSymbolVector_t image_symbols;
+	mutable once_flag symbols_once;
+
+	public:
+
+	image_eh_frame_impl_t(unique_ptr<mapped_image_t> p_image);
+
+	bool parse(const bool) { return false; }
+
+	unique_ptr<fde_contents_t<ptrsize> > restoreFDE(const image_fde_t &record) const;
+
+        virtual const FDEVector_t* getFDEs() const { return &fdes; }
+        virtual const CIEVector_t* getCIEs() const;
+        virtual const FDEContents_t* findFDE(uint64_t addr) const; 
+        virtual const EHPSymbolVector_t* getSymbols() const;
 
+	protected:
 
+	bool withImageContents(const function<bool(const image_contents_t&)> &use) const;
 };
 
 }
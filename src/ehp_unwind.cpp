@@ -0,0 +1,462 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string.h>
+
+#include <ehp.hpp>
+#include "ehp_unwind.hpp"
+#include "ehp_expression.hpp"
+#include "ehp_parallel.hpp"
+
+using namespace std;
+using namespace EHP;
+
+namespace 
+{
+
+bool fits_int32(const int64_t value)
+{
+	return value >= numeric_limits<int32_t>::min() && value <= numeric_limits<int32_t>::max();
+}
+
+bool same_entry_rules(const EHPUnwindEntry_t &a, const EHPUnwindEntry_t &b)
+{
+	return  a.cfa_offset==b.cfa_offset && 
+		a.ra_offset==b.ra_offset && 
+		a.fp_offset==b.fp_offset && 
+		a.cfa_reg==b.cfa_reg && 
+		a.flags==b.flags;
+}
+
+EHPUnwindEntry_t make_entry(const uint64_t start_addr, const uint16_t flags)
+{
+	return EHPUnwindEntry_t({start_addr, 0, 0, 0, 0, flags});
+}
+
+// compile one CFA row to a fixed-width entry, or mark it as needing full DWARF evaluation.
+EHPUnwindEntry_t compile_row(const CFATable_t &table, const EHPCFARow_t &row, const arch_registers_t &regs, const uint32_t ra_reg)
+{
+	const auto needs_dwarf=make_entry(row.start_addr, UNWIND_NEEDS_DWARF);
+	if(!table.isComplete())
+		return needs_dwarf;
+
+	// profilers only track sp/fp, so a CFA based on any other register needs the full rules.
+	const auto &cfa=row.cfa;
+	if(cfa.type!=CFA_RULE_REG_OFFSET || cfa.reg > numeric_limits<uint16_t>::max() || !fits_int32(cfa.offset))
+		return needs_dwarf;
+	if(regs.known && cfa.reg!=regs.sp && cfa.reg!=regs.fp)
+		return needs_dwarf;
+
+	auto entry=make_entry(row.start_addr, 0);
+	entry.cfa_reg=static_cast<uint16_t>(cfa.reg);
+	entry.cfa_offset=static_cast<int32_t>(cfa.offset);
+
+	const auto ra_rule=table.findRegisterRule(row, ra_reg);
+	if(ra_rule==nullptr || ra_rule->type==REG_RULE_SAME_VALUE)
+	{ /* still in the return address register */ }
+	else if(ra_rule->type==REG_RULE_UNDEFINED)
+		entry.flags|=UNWIND_RA_UNDEFINED;
+	else if(ra_rule->type==REG_RULE_OFFSET && fits_int32(ra_rule->operand))
+	{
+		entry.flags|=UNWIND_RA_AT_CFA;
+		entry.ra_offset=static_cast<int32_t>(ra_rule->operand);
+	}
+	else
+		return needs_dwarf;
+
+	if(regs.known)
+	{
+		const auto fp_rule=table.findRegisterRule(row, regs.fp);
+		if(fp_rule==nullptr || fp_rule->type==REG_RULE_SAME_VALUE)
+		{ /* frame pointer unchanged */ }
+		else if(fp_rule->type==REG_RULE_OFFSET && fits_int32(fp_rule->operand))
+		{
+			entry.flags|=UNWIND_FP_AT_CFA;
+			entry.fp_offset=static_cast<int32_t>(fp_rule->operand);
+		}
+		else
+			return needs_dwarf;
+	}
+	return entry;
+}
+
+bool same_cfa(const EHPCFAOffsetEntry_t &a, const EHPCFAOffsetEntry_t &b)
+{
+	return a.type==b.type && a.cfa_reg==b.cfa_reg && a.cfa_offset==b.cfa_offset;
+}
+
+// append a change point, dropping it if the CFA rule did not change.  
+// an entry at the same address supersedes the previous one.
+void append_cfa_offset(EHPCFAOffsetTable_t &table, const EHPCFAOffsetEntry_t &entry)
+{
+	while(table.size() > 0 && table.back().addr==entry.addr)
+		table.pop_back();
+	if(table.size() > 0 && same_cfa(table.back(), entry))
+		return;
+	table.push_back(entry);
+}
+
+void append_fde_cfa_offsets(EHPCFAOffsetTable_t &table, const FDEContents_t &fde)
+{
+	const auto undefined=[](const uint64_t addr) { return EHPCFAOffsetEntry_t({addr, 0, 0, CFA_RULE_UNDEFINED}); };
+
+	auto covered_to=fde.getStartAddress();
+	for(const auto &row : *fde.getCFATable()->getRows())
+	{
+		if(row.start_addr > covered_to)
+			append_cfa_offset(table, undefined(covered_to));
+		const auto is_reg=row.cfa.type==CFA_RULE_REG_OFFSET;
+		append_cfa_offset(table, EHPCFAOffsetEntry_t({row.start_addr, is_reg ? row.cfa.offset : 0, is_reg ? row.cfa.reg : 0, row.cfa.type}));
+		covered_to=row.end_addr;
+	}
+	// the FDE's range ends here.  if the next FDE is adjacent, its first entry replaces this one.
+	append_cfa_offset(table, undefined(min(covered_to, fde.getEndAddress())));
+}
+
+bool host_is_be()
+{
+	const auto probe=uint16_t(1);
+	auto first=uint8_t(0);
+	memcpy(&first, &probe, 1);
+	return first==0;
+}
+
+}
+
+arch_registers_t EHP::get_arch_registers(const uint64_t return_address_column)
+{
+	switch(return_address_column)
+	{
+		case 16: return arch_registers_t({true, 16, 7, 6});	// x86-64: rip, rsp, rbp
+		case 8:  return arch_registers_t({true, 8, 4, 5});	// i386: eip, esp, ebp
+		case 30: return arch_registers_t({true, 30, 31, 29});	// aarch64: x30, sp, x29
+		default: return arch_registers_t({false, static_cast<uint32_t>(return_address_column), 0, 0});
+	}
+}
+
+arch_registers_t EHP::get_arch_registers(const EHPArchitecture_t arch)
+{
+	switch(arch)
+	{
+		case ARCH_X86_64:  return get_arch_registers(16);
+		case ARCH_I386:    return get_arch_registers(8);
+		case ARCH_AARCH64: return get_arch_registers(30);
+	}
+	throw invalid_argument("Unknown architecture");
+}
+
+void EHP::build_unwind_table(const FDEVector_t &fdes, EHPUnwindTable_t &table)
+{
+	table.clear();
+
+	// adjacent entries with identical rules are merged, so only a change of rules costs an entry.
+	const auto append=[&](const EHPUnwindEntry_t &entry)
+	{
+		// an entry at the same address supersedes the previous one (e.g., the end marker of an adjacent FDE).
+		while(table.size() > 0 && table.back().start_addr==entry.start_addr)
+			table.pop_back();
+		if(table.size() > 0 && same_entry_rules(table.back(), entry))
+			return;
+		table.push_back(entry);
+	};
+
+	for(const auto fde : fdes)
+	{
+		if(fde->getStartAddress() >= fde->getEndAddress())
+			continue;
+
+		const auto &cie=fde->getCIE();
+		const auto regs=get_arch_registers(cie.getReturnRegister());
+		const auto ra_reg=static_cast<uint32_t>(cie.getReturnRegister());
+		const auto cfa_table=fde->getCFATable();
+		
+		// a row table may start late or have holes if the program was odd, those pcs have no rules.
+		auto covered_to=fde->getStartAddress();
+		for(const auto &row : *cfa_table->getRows())
+		{
+			if(row.start_addr > covered_to)
+				append(make_entry(covered_to, UNWIND_NEEDS_DWARF));
+			append(compile_row(*cfa_table, row, regs, ra_reg));
+			covered_to=row.end_addr;
+		}
+		if(covered_to < fde->getEndAddress())
+			append(make_entry(covered_to, UNWIND_NEEDS_DWARF));
+
+		// terminate the FDE's range.  if the next FDE is adjacent, its first entry replaces this one.
+		append(make_entry(fde->getEndAddress(), UNWIND_NO_CFI));
+	}
+	table.shrink_to_fit();
+}
+
+void EHP::summarize_frame(const FDEContents_t &fde, EHPFrameSummary_t &summary)
+{
+	const auto &cie=fde.getCIE();
+	const auto regs=get_arch_registers(cie.getReturnRegister());
+	const auto ra_reg=cie.getReturnRegister();
+	const auto table=fde.getCFATable();
+
+	summary=EHPFrameSummary_t();
+	summary.max_frame_size=0;
+	summary.uses_frame_pointer=false;
+	summary.has_expressions=table->getExpressions()->size() > 0;
+	summary.is_complete=table->isComplete();
+
+	// remember/restore state are the only way to share rules between epilogues and later code.
+	const auto &insns=*fde.getProgram().getInstructions();
+	summary.has_remember_restore=any_of(insns.begin(), insns.end(), 
+		[](const EHProgramInstruction_t* insn) { return insn->isRememberState() || insn->isRestoreState(); });
+
+	const auto &rules=*table->getRegisterRules();
+	for(const auto &row : *table->getRows())
+	{
+		if(row.cfa.type==CFA_RULE_REG_OFFSET)
+		{
+			if(regs.known && row.cfa.reg==regs.fp)
+				summary.uses_frame_pointer=true;
+			if(!regs.known || row.cfa.reg==regs.sp)
+				summary.max_frame_size=max(summary.max_frame_size, row.cfa.offset);
+		}
+
+		// keep the first save slot seen for each register.
+		for(auto i=row.first_rule; i < row.first_rule+row.rule_count; i++)
+		{
+			const auto &rule=rules[i];
+			if(rule.type!=REG_RULE_OFFSET || rule.reg==ra_reg)
+				continue;
+			const auto it=lower_bound(summary.saved_registers.begin(), summary.saved_registers.end(), rule.reg, 
+				[](const EHPSavedRegister_t &saved, const uint32_t reg) { return saved.reg < reg; });
+			if(it==summary.saved_registers.end() || it->reg!=rule.reg)
+				summary.saved_registers.insert(it, EHPSavedRegister_t({rule.reg, rule.operand}));
+		}
+	}
+}
+
+void EHP::build_cfa_offset_table(const FDEVector_t &fdes, EHPCFAOffsetTable_t &table)
+{
+	table.clear();
+
+	// each FDE's program is evaluated by exactly one thread, and FDEs share no mutable state.
+	const auto chunks=parallel_chunk_count(fdes.size());
+	auto partial=vector<EHPCFAOffsetTable_t>(chunks);
+	parallel_for_chunks(fdes.size(), chunks, [&](const size_t chunk, const size_t begin, const size_t end)
+		{
+			for(auto i=begin; i < end; i++)
+			{
+				if(fdes[i]->getStartAddress() < fdes[i]->getEndAddress())
+					append_fde_cfa_offsets(partial[chunk], *fdes[i]);
+			}
+		});
+
+	// chunks are in address order, stitch them with the same merging rules.
+	auto total=size_t(0);
+	for(const auto &p : partial)
+		total+=p.size();
+	table.reserve(total);
+	for(const auto &p : partial)
+		for(const auto &entry : p)
+			append_cfa_offset(table, entry);
+}
+
+const EHPUnwindEntry_t* EHP::find_unwind_entry(const EHPUnwindTable_t &table, const uint64_t addr)
+{
+	const auto it=upper_bound(table.begin(), table.end(), addr, 
+		[](const uint64_t addr, const EHPUnwindEntry_t &entry) { return addr < entry.start_addr; });
+	if(it==table.begin())
+		return nullptr;
+	const auto &entry=*prev(it);
+	return (entry.flags & UNWIND_NO_CFI) ? nullptr : &entry;
+}
+
+unwinder_impl_t::unwinder_impl_t(const EHFrameParser_t &p_parser, const EHPArchitecture_t arch, const EHPEndianness_t memory_endian)
+	:
+		parser(p_parser),
+		arch_regs(get_arch_registers(arch)),
+		ptrsize(arch==ARCH_I386 ? 4 : 8),
+		memory_is_be(memory_endian==BIG || (memory_endian==HOST && host_is_be()))
+{
+	// evaluates and caches every FDE's CFA table.
+	parser.getUnwindTable();
+}
+
+bool unwinder_impl_t::read_value(const EHPMemoryReader_t &read_memory, const uint64_t addr, const uint8_t size, uint64_t &value) const
+{
+	uint8_t bytes[8];
+	if(size > sizeof(bytes) || read_memory(addr, bytes, size))
+		return true;
+
+	value=0;
+	for(auto i=0U; i<size; i++)
+	{
+		const auto byte=uint64_t(bytes[memory_is_be ? i : size-1-i]);
+		value=(value<<8) | byte;
+	}
+	return false;
+}
+
+bool unwinder_impl_t::evaluate(const EHPExpressionOpVector_t &ops, const EHPRegisterSet_t &regs, const bool push_cfa, const uint64_t cfa,
+                               const EHPMemoryReader_t &read_memory, uint64_t &result) const
+{
+	const auto read=[&](const uint64_t addr, const uint8_t size, uint64_t &value) -> bool
+	{
+		return read_value(read_memory, addr, size, value);
+	};
+	return evaluate_expression(ops, regs, push_cfa, cfa, ptrsize, read, result);
+}
+
+bool unwinder_impl_t::compute_cfa(const CFATable_t &table, const EHPCFARow_t &row, const EHPRegisterSet_t &regs, 
+                                  const EHPMemoryReader_t &read_memory, uint64_t &cfa) const
+{
+	switch(row.cfa.type)
+	{
+		case CFA_RULE_REG_OFFSET:
+			if(row.cfa.reg >= EHP_UNWIND_REGISTER_COUNT || !regs.valid[row.cfa.reg])
+				return true;
+			cfa=regs.regs[row.cfa.reg]+row.cfa.offset;
+			return false;
+		case CFA_RULE_EXPRESSION:
+			return evaluate((*table.getCompiledExpressions())[row.cfa.offset], regs, false, 0, read_memory, cfa);
+		case CFA_RULE_UNDEFINED:
+			break;
+	}
+	return true;
+}
+
+void unwinder_impl_t::apply_rule(const CFATable_t &table, const EHPRegisterRule_t &rule, const EHPRegisterSet_t &callee, const uint64_t cfa, 
+                                 const EHPMemoryReader_t &read_memory, EHPRegisterSet_t &caller) const
+{
+	const auto reg=rule.reg;
+	if(reg >= EHP_UNWIND_REGISTER_COUNT)
+		return;
+
+	// a register whose saved value cannot be found is unknown in the caller, 
+	// which only stops the unwind if the return address or CFA needs it.
+	auto value=uint64_t(0);
+	auto err=false;
+	switch(rule.type)
+	{
+		case REG_RULE_SAME_VALUE:
+			return;
+		case REG_RULE_OFFSET:
+			err=read_value(read_memory, cfa+rule.operand, ptrsize, value);
+			break;
+		case REG_RULE_VAL_OFFSET:
+			value=cfa+rule.operand;
+			break;
+		case REG_RULE_REGISTER:
+		{
+			const auto from=static_cast<uint64_t>(rule.operand);
+			err = from >= EHP_UNWIND_REGISTER_COUNT || !callee.valid[from];
+			if(!err)
+				value=callee.regs[from];
+			break;
+		}
+		case REG_RULE_EXPRESSION:
+		{
+			const auto &ops=(*table.getCompiledExpressions())[rule.operand];
+			auto addr=uint64_t(0);
+			err = evaluate(ops, callee, true, cfa, read_memory, addr) || 
+			      read_value(read_memory, addr, ptrsize, value);
+			break;
+		}
+		case REG_RULE_VAL_EXPRESSION:
+		{
+			const auto &ops=(*table.getCompiledExpressions())[rule.operand];
+			err=evaluate(ops, callee, true, cfa, read_memory, value);
+			break;
+		}
+		case REG_RULE_UNDEFINED:
+			err=true;
+			break;
+	}
+
+	caller.regs[reg]=err ? 0 : value;
+	caller.valid.set(reg, !err);
+}
+
+bool unwinder_impl_t::step(EHPRegisterSet_t& regs, uint64_t& cfa, const EHPMemoryReader_t& read_memory) const
+{
+	// a return address may be one past the end of the calling function, look up the call instead.
+	const auto lookup_pc = regs.pc_is_return_address ? regs.pc-1 : regs.pc;
+	const auto fde=parser.findFDE(lookup_pc);
+	if(fde==nullptr)
+		return true;
+	const auto table=fde->getCFATable();
+	const auto row=table->findRow(lookup_pc);
+	if(row==nullptr)
+		return true;
+
+	auto frame_cfa=uint64_t(0);
+	if(compute_cfa(*table, *row, regs, read_memory, frame_cfa))
+		return true;
+
+	// registers without a rule keep their value, as is usual for callee-saved registers.
+	auto caller=regs;
+	const auto &rules=*table->getRegisterRules();
+	for(auto i=row->first_rule; i < row->first_rule+row->rule_count; i++)
+		apply_rule(*table, rules[i], regs, frame_cfa, read_memory, caller);
+
+	// the caller's stack pointer is the CFA by definition.
+	caller.regs[arch_regs.sp]=frame_cfa;
+	caller.valid.set(arch_regs.sp);
+
+	// an undefined return address marks the outermost frame.
+	const auto ra_reg=fde->getCIE().getReturnRegister();
+	if(ra_reg >= EHP_UNWIND_REGISTER_COUNT || !caller.valid[ra_reg] || caller.regs[ra_reg]==0)
+		return true;
+	caller.pc=caller.regs[ra_reg];
+
+	// the frame a signal trampoline returns to was interrupted, its pc is not a return address.
+	caller.pc_is_return_address=fde->getCIE().getAugmentation().find('S')==string::npos;
+
+	regs=caller;
+	cfa=frame_cfa;
+	return false;
+}
+
+void unwinder_impl_t::unwind(const EHPRegisterSet_t& initial, const EHPMemoryReader_t& read_memory, EHPFrameVector_t& frames, size_t max_frames) const
+{
+	frames.clear();
+	frames.reserve(max_frames);
+
+	auto regs=initial;
+	while(frames.size() < max_frames)
+	{
+		const auto pc=regs.pc;
+		auto cfa=uint64_t(0);
+		const auto err=step(regs, cfa, read_memory);
+		frames.push_back(EHPFrame_t({pc, err ? 0 : cfa}));
+		if(err)
+			break;
+
+		// stacks grow down on every supported architecture, a CFA that does not move up would loop.
+		if(frames.size() > 1 && cfa <= frames[frames.size()-2].cfa)
+			break;
+	}
+}
+
+unique_ptr<const Unwinder_t> Unwinder_t::factory(const EHFrameParser_t& parser, EHPArchitecture_t arch, EHPEndianness_t memory_endian)
+{
+	return unique_ptr<const Unwinder_t>(new unwinder_impl_t(parser, arch, memory_endian));
+}
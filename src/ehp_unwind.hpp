@@ -0,0 +1,82 @@
+// @HEADER_COMPONENT libehp
+// @HEADER_LANG C++
+// @HEADER_BEGIN
+
+/*
+   Copyright 2017-2019 University of Virginia
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+// @HEADER_END
+
+#ifndef ehp_unwind_hpp
+#define ehp_unwind_hpp
+
+#include <stdint.h>
+
+#include <ehp.hpp>
+
+
+namespace EHP
+{
+
+using namespace std;
+
+// The DWARF register numbers an architecture uses for its return address, 
+// stack pointer and frame pointer.
+struct arch_registers_t
+{
+	bool known;
+	uint32_t ra;
+	uint32_t sp;
+	uint32_t fp;
+};
+
+// recognize the architecture from a CIE's return address column.
+arch_registers_t get_arch_registers(const uint64_t return_address_column);
+arch_registers_t get_arch_registers(const EHPArchitecture_t arch);
+
+// fdes must be sorted by address, as getFDEs() returns them.
+void build_unwind_table(const FDEVector_t &fdes, EHPUnwindTable_t &table);
+void summarize_frame(const FDEContents_t &fde, EHPFrameSummary_t &summary);
+void build_cfa_offset_table(const FDEVector_t &fdes, EHPCFAOffsetTable_t &table);
+const EHPUnwindEntry_t* find_unwind_entry(const EHPUnwindTable_t &table, const uint64_t addr);
+
+class unwinder_impl_t : public Unwinder_t
+{
+	private:
+
+	const EHFrameParser_t &parser;
+	arch_registers_t arch_regs;
+	uint32_t ptrsize;
+	bool memory_is_be;
+
+	bool read_value(const EHPMemoryReader_t &read_memory, const uint64_t addr, const uint8_t size, uint64_t &value) const;
+	bool evaluate(const EHPExpressionOpVector_t &ops, const EHPRegisterSet_t &regs, const bool push_cfa, const uint64_t cfa,
+	              const EHPMemoryReader_t &read_memory, uint64_t &result) const;
+	bool compute_cfa(const CFATable_t &table, const EHPCFARow_t &row, const EHPRegisterSet_t &regs, 
+	                 const EHPMemoryReader_t &read_memory, uint64_t &cfa) const;
+	void apply_rule(const CFATable_t &table, const EHPRegisterRule_t &rule, const EHPRegisterSet_t &callee, const uint64_t cfa, 
+	                const EHPMemoryReader_t &read_memory, EHPRegisterSet_t &caller) const;
+
+	public:
+
+	unwinder_impl_t(const EHFrameParser_t &p_parser, const EHPArchitecture_t arch, const EHPEndianness_t memory_endian);
+
+	virtual bool step(EHPRegisterSet_t& regs, uint64_t& cfa, const EHPMemoryReader_t& read_memory) const;
+	virtual void unwind(const EHPRegisterSet_t& initial, const EHPMemoryReader_t& read_memory, EHPFrameVector_t& frames, size_t max_frames) const;
+};
+
+}
+#endif
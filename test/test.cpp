@@ -18,6 +18,18 @@
 
 #include <ehp.hpp>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 #include <assert.h>
 
 using namespace std;
@@ -52,6 +64,1560 @@ void print_lps(const EHFrameParser_t* ehp)
 	cout<<dec;
 }
 
+void print_errors(const EHFrameParser_t* ehp)
+{
+	const auto errors=ehp->getParseErrors();
+	cout<<hex;
+	for(const auto &err : *errors)
+	{
+		cout<<"Skipped malformed "<<(err.kind==PARSE_ERROR_CIE ? "CIE" : err.kind==PARSE_ERROR_FDE ? "FDE" : "record")
+		    <<" at 0x"<<err.position<<" (length=0x"<<err.length<<")"<<endl;
+	}
+	cout<<dec;
+}
+
+void require(const bool ok, const string &what)
+{
+	if(ok)
+		return;
+	cout<<"FAILED: "<<what<<endl;
+	abort();
+}
+
+// encode pads programs out with DW_CFA_nop, so compare them without it.
+EHProgramInstructionByteVector_t without_padding(EHProgramInstructionByteVector_t program)
+{
+	while(!program.empty() && program.back()==0)
+		program.pop_back();
+	return program;
+}
+
+bool same_call_sites(const EHPModelLSDA_t &a, const EHPModelLSDA_t &b)
+{
+	if(a.call_sites.size()!=b.call_sites.size())
+		return false;
+	for(auto i=size_t(0); i < a.call_sites.size(); i++)
+	{
+		const auto &x=a.call_sites[i];
+		const auto &y=b.call_sites[i];
+		if(x.start!=y.start || x.end!=y.end || x.landing_pad!=y.landing_pad || x.actions!=y.actions)
+			return false;
+	}
+	return true;
+}
+
+// the FDEs cover the same code with the same CFA programs and exception tables.  encodings may differ.
+bool same_semantics(const EHPSectionModel_t &a, const EHPSectionModel_t &b)
+{
+	if(a.fdes.size()!=b.fdes.size())
+		return false;
+	for(auto i=size_t(0); i < a.fdes.size(); i++)
+	{
+		const auto &x=a.fdes[i];
+		const auto &y=b.fdes[i];
+		const auto &x_cie=a.cies.at(x.cie);
+		const auto &y_cie=b.cies.at(y.cie);
+		if(x.start!=y.start || x.end!=y.end || x.has_lsda!=y.has_lsda || without_padding(x.program)!=without_padding(y.program))
+			return false;
+		if(x_cie.code_alignment_factor!=y_cie.code_alignment_factor || x_cie.data_alignment_factor!=y_cie.data_alignment_factor ||
+		   x_cie.return_register!=y_cie.return_register || x_cie.personality!=y_cie.personality || 
+		   without_padding(x_cie.program)!=without_padding(y_cie.program))
+			return false;
+		if(x.has_lsda && (x.lsda.landing_pad_base!=y.lsda.landing_pad_base || x.lsda.type_table!=y.lsda.type_table || 
+		   x.lsda.exception_specs!=y.lsda.exception_specs || !same_call_sites(x.lsda, y.lsda)))
+			return false;
+	}
+	return true;
+}
+
+// the same records with the same encodings.
+bool same_model(const EHPSectionModel_t &a, const EHPSectionModel_t &b)
+{
+	if(!same_semantics(a,b) || a.cies.size()!=b.cies.size())
+		return false;
+	for(auto i=size_t(0); i < a.cies.size(); i++)
+	{
+		const auto &x=a.cies[i];
+		const auto &y=b.cies[i];
+		if(x.version!=y.version || x.augmentation!=y.augmentation || x.personality_encoding!=y.personality_encoding || 
+		   x.lsda_encoding!=y.lsda_encoding || x.fde_encoding!=y.fde_encoding)
+			return false;
+	}
+	for(auto i=size_t(0); i < a.fdes.size(); i++)
+	{
+		const auto &x=a.fdes[i];
+		const auto &y=b.fdes[i];
+		if(x.cie!=y.cie)
+			return false;
+		if(x.has_lsda && (x.lsda.landing_pad_base_encoding!=y.lsda.landing_pad_base_encoding || 
+		   x.lsda.call_site_encoding!=y.lsda.call_site_encoding || x.lsda.type_table_encoding!=y.lsda.type_table_encoding))
+			return false;
+	}
+	return true;
+}
+
+unique_ptr<const EHFrameParser_t> parse_sections(const EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, const EHPEncodedSections_t &sections)
+{
+	return EHFrameParser_t::factory(model.ptrsize, model.is_be ? BIG : LITTLE,
+		sections.eh_frame, addresses.eh_frame_addr, 
+		sections.eh_frame_hdr, addresses.eh_frame_hdr_addr, 
+		sections.gcc_except_table, addresses.gcc_except_table_addr);
+}
+
+size_t count_issues(const EHPSearchTableIssueVector_t &issues, const EHPSearchTableIssueKind_t kind)
+{
+	return count_if(issues.begin(), issues.end(), [&](const EHPSearchTableIssue_t &i) { return i.kind==kind; });
+}
+
+void check_search_table(const EHFrameParser_t* ehp, const EHPSectionModel_t &model, const EHPSectionAddresses_t &addresses, const string &eh_frame_hdr)
+{
+	const auto endian = model.is_be ? BIG : LITTLE;
+	auto table=EHPSearchTable_t();
+	auto issues=EHPSearchTableIssueVector_t();
+	require(!EHFrameParser_t::readSearchTable(model.ptrsize, endian, eh_frame_hdr, addresses.eh_frame_hdr_addr, table), "read the encoded search table");
+	ehp->checkSearchTable(table, issues);
+	require(issues.empty(), "the encoded search table matches the FDEs");
+	const auto &fdes=*ehp->getFDEs();
+	require(table.size()==fdes.size(), "the search table has an entry per FDE");
+	for(auto i=size_t(0); i < table.size(); i++)
+	{
+		// FDEs with the same start may be listed in either order.
+		const auto fde=ehp->findFDEByPosition(table[i].fde_address);
+		require(table[i].initial_location==fdes[i]->getStartAddress() && fde!=nullptr && fde->getStartAddress()==table[i].initial_location, 
+			"search table entries name the FDEs in address order");
+	}
+	if(table.size() < 2)
+		return;
+
+	// drop the first entry and swap the next two, then read the damage back from a header.
+	auto damaged=EHPSearchTable_t(table.begin()+1, table.end());
+	swap(damaged[0], damaged[1]);
+	auto damaged_hdr=string();
+	require(!EHFrameParser_t::encodeSearchTable(model.ptrsize, endian, damaged, addresses.eh_frame_addr, addresses.eh_frame_hdr_addr, damaged_hdr), "encode a damaged search table");
+	require(!EHFrameParser_t::readSearchTable(model.ptrsize, endian, damaged_hdr, addresses.eh_frame_hdr_addr, table), "read a damaged search table");
+	issues.clear();
+	ehp->checkSearchTable(table, issues);
+	require(count_issues(issues, SEARCH_TABLE_MISSING)==1 && issues.back().index==0, "a dropped entry is missing");
+	require(count_issues(issues, SEARCH_TABLE_MISORDERED)==1, "swapped entries are misordered");
+	require(count_issues(issues, SEARCH_TABLE_EXTRA)==0, "nothing is extra");
+}
+
+// every FDE is found by its position, among the FDEs sharing its personality, and among those sharing its LSDA.
+void check_fde_lookups(const EHFrameParser_t* ehp)
+{
+	auto personalities=set<uint64_t>();
+	for(const auto fde : *ehp->getFDEs())
+	{
+		require(ehp->findFDEByPosition(fde->getPosition())==fde, "find an FDE by its position");
+		const auto personality=fde->getCIE().getPersonality();
+		const auto same_personality=ehp->findFDEsByPersonality(personality);
+		require(same_personality!=nullptr, "find FDEs by personality");
+		const auto at_start=equal_range(same_personality->begin(), same_personality->end(), fde, 
+			[](const FDEContents_t* a, const FDEContents_t* b) { return a->getStartAddress() < b->getStartAddress(); });
+		require(find(at_start.first, at_start.second, fde)!=at_start.second, "find an FDE by its personality, in address order");
+		if(personalities.insert(personality).second)
+			require(all_of(same_personality->begin(), same_personality->end(), 
+				[&](const FDEContents_t* other) { return other->getCIE().getPersonality()==personality; }), "FDEs found by personality have it");
+		if(fde->getLSDAAddress()==0)
+			continue;
+		const auto sharing=ehp->findFDEsByLSDA(fde->getLSDAAddress());
+		require(sharing!=nullptr && find(sharing->begin(), sharing->end(), fde)!=sharing->end(), "find an FDE by its LSDA");
+	}
+}
+
+// every call site is found at its start.
+void check_call_sites(const EHFrameParser_t* ehp)
+{
+	for(const auto fde : *ehp->getFDEs())
+	{
+		for(const auto cs : *fde->getLSDA()->getCallSites())
+		{
+			const auto pc=cs->getCallSiteAddress();
+			if(pc >= cs->getCallSiteEndAddress())
+				continue;
+			const auto found=ehp->findCallSite(pc);
+			require(found!=nullptr && found->start_addr <= pc && pc < found->end_addr, "find a call site at its start");
+		}
+	}
+}
+
+// write an image, load it back, and check that it answers as the parser does.
+void check_image(const EHFrameParser_t* ehp)
+{
+	auto filename=string("test.img.XXXXXX");
+	const auto fd=mkstemp(&filename[0]);
+	require(fd >= 0, "create an image file");
+	close(fd);
+	require(!ehp->writeImage(filename, "test"), "write an image");
+	auto loaded=EHFrameParser_t::loadImage(filename, "test");
+	require(loaded!=nullptr, "load the image");
+	require(!EHFrameParser_t::loadImage(filename, "other"), "an image is only loaded for its key");
+	unlink(filename.c_str());
+
+	auto parsed_text=string();
+	auto loaded_text=string();
+	ehp->print(*OutputSink_t::factory(parsed_text));
+	loaded->print(*OutputSink_t::factory(loaded_text));
+	require(parsed_text==loaded_text, "the image prints as the parser does");
+
+	// the same image through a sealed memfd.
+	const auto published=ehp->publishImage("test");
+	require(published >= 0, "publish an image");
+	const auto seals=fcntl(published, F_GET_SEALS);
+	const auto all_seals=F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL;
+	require(seals >= 0 && (seals & all_seals)==all_seals, "a published image is sealed");
+	require(write(published, "x", 1) < 0 && ftruncate(published, 0)!=0, "a published image cannot be changed");
+	auto mapped=EHFrameParser_t::loadImage(published, "test");
+	require(mapped!=nullptr, "load a published image");
+	require(!EHFrameParser_t::loadImage(published, "other"), "a published image is only loaded for its key");
+	auto mapped_text=string();
+	mapped->print(*OutputSink_t::factory(mapped_text));
+	require(parsed_text==mapped_text, "a published image prints as the parser does");
+	close(published);
+}
+
+// encode the parsed sections, parse them again, and check that nothing was lost.
+void check_encode(const EHFrameParser_t* ehp)
+{
+	auto model=EHPSectionModel_t();
+	ehp->getModel(model);
+	if(model.fdes.empty())
+		return;
+
+	// somewhere past the code, close enough for pc-relative pointers.
+	const auto code_end=max_element(model.fdes.begin(), model.fdes.end(), 
+		[](const EHPModelFDE_t &a, const EHPModelFDE_t &b) { return a.end < b.end; })->end;
+	const auto base=(code_end+0xfff) & ~uint64_t(0xfff);
+	const auto addresses=EHPSectionAddresses_t({base+0x100000, base, base+0x200000});
+
+	auto sections=EHPEncodedSections_t();
+	require(!EHFrameParser_t::encode(model, addresses, sections), "encode the model");
+	const auto encoded=parse_sections(model, addresses, sections);
+	auto encoded_model=EHPSectionModel_t();
+	encoded->getModel(encoded_model);
+	require(same_model(model, encoded_model), "encode then parse gives back the model");
+
+	auto compacted_model=model;
+	auto compacted=EHPEncodedSections_t();
+	require(!EHFrameParser_t::compact(compacted_model, addresses, compacted), "compact the model");
+	require(compacted.eh_frame.size() <= sections.eh_frame.size(), "compacting does not grow .eh_frame");
+	const auto compacted_parser=parse_sections(compacted_model, addresses, compacted);
+	auto reparsed_model=EHPSectionModel_t();
+	compacted_parser->getModel(reparsed_model);
+	require(same_model(compacted_model, reparsed_model), "compacted sections parse as the compacted model");
+	require(same_semantics(model, reparsed_model), "compacting keeps the FDEs' meaning");
+
+	auto eh_frame=sections.eh_frame;
+	auto gcc_except_table=sections.gcc_except_table;
+	auto errors=EHPPatchErrorVector_t();
+	const auto identity=EHPAddressMap_t([](const uint64_t addr) { return addr; });
+	require(!encoded->patchAddresses(identity, eh_frame, gcc_except_table, errors), "patch with an identity map");
+	require(errors.empty() && eh_frame==sections.eh_frame && gcc_except_table==sections.gcc_except_table, "an identity patch changes nothing");
+
+	check_search_table(encoded.get(), model, addresses, sections.eh_frame_hdr);
+}
+
+// x86-64 DWARF register numbers.
+static const uint32_t X86_64_RBP=6;
+static const uint32_t X86_64_RSP=7;
+static const uint32_t X86_64_RA=16;
+
+// addresses for hand-built sections, below the code the synthetic FDEs cover.
+static const auto SYNTHETIC_ADDRESSES=EHPSectionAddresses_t({0x100000, 0x200000, 0x300000});
+
+// x86-64 FDEs i=0..programs.size()-1 covering [0x1000+0x100*i, +0x100) with programs[i], under one CIE 
+// that starts each frame with CFA=rsp+8 and the return address at CFA-8.
+EHPSectionModel_t x86_64_model(const vector<EHProgramInstructionByteVector_t> &programs)
+{
+	auto cie=EHPModelCIE_t();
+	cie.version=1;
+	cie.augmentation="zR";
+	cie.code_alignment_factor=1;
+	cie.data_alignment_factor=-8;
+	cie.return_register=X86_64_RA;
+	cie.personality_encoding=0xff;	// DW_EH_PE_omit
+	cie.personality=0;
+	cie.lsda_encoding=0xff;
+	cie.fde_encoding=0x1b;		// DW_EH_PE_pcrel|DW_EH_PE_sdata4
+	cie.program={0x0c, X86_64_RSP, 8, 0x80|X86_64_RA, 1};	// def_cfa rsp+8, offset ra at CFA-8
+
+	auto model=EHPSectionModel_t();
+	model.ptrsize=8;
+	model.is_be=false;
+	model.cies.push_back(cie);
+	for(auto i=size_t(0); i < programs.size(); i++)
+	{
+		auto fde=EHPModelFDE_t();
+		fde.cie=0;
+		fde.start=0x1000+0x100*i;
+		fde.end=fde.start+0x100;
+		fde.program=programs[i];
+		fde.has_lsda=false;
+		model.fdes.push_back(fde);
+	}
+	return model;
+}
+
+EHPEncodedSections_t encode_model(const EHPSectionModel_t &model)
+{
+	auto sections=EHPEncodedSections_t();
+	require(!EHFrameParser_t::encode(model, SYNTHETIC_ADDRESSES, sections), "encode a hand-built model");
+	return sections;
+}
+
+unique_ptr<const EHFrameParser_t> parse_eh_frame(const string &eh_frame, const EHPParseMode_t parse_mode=PARSE_STRICT)
+{
+	return EHFrameParser_t::factory(8, LITTLE, eh_frame, SYNTHETIC_ADDRESSES.eh_frame_addr, "", SYNTHETIC_ADDRESSES.eh_frame_hdr_addr, 
+		"", SYNTHETIC_ADDRESSES.gcc_except_table_addr, parse_mode);
+}
+
+// give FDE i an LSDA with landing pads relative to base (0 for the FDE's start) and absolute type_info pointers.
+void add_lsda(EHPSectionModel_t &model, const size_t i, const uint64_t base, const vector<EHPModelCallSite_t> &call_sites, 
+	const vector<uint64_t> &type_table=vector<uint64_t>())
+{
+	auto &fde=model.fdes.at(i);
+	auto &cie=model.cies.at(fde.cie);
+	cie.augmentation="zLR";
+	cie.lsda_encoding=0x1b;			// DW_EH_PE_pcrel|DW_EH_PE_sdata4
+	fde.has_lsda=true;
+	fde.lsda=EHPModelLSDA_t();
+	fde.lsda.landing_pad_base_encoding = base==0 ? 0xff : 0x00;	// DW_EH_PE_omit or DW_EH_PE_absptr
+	fde.lsda.landing_pad_base=base;
+	fde.lsda.call_site_encoding=0x01;	// DW_EH_PE_uleb128
+	fde.lsda.type_table_encoding = type_table.empty() ? 0xff : 0x00;
+	fde.lsda.call_sites=call_sites;
+	fde.lsda.type_table=type_table;
+}
+
+// a parse that stops at a record running off the section keeps the records before it.
+void check_truncated_eh_frame()
+{
+	const auto sections=encode_model(x86_64_model({{}}));
+
+	// replace the zero terminator with a length that runs off the end.
+	auto eh_frame=sections.eh_frame;
+	const auto bad_record=eh_frame.size()-4;
+	eh_frame[bad_record]=0x40;
+	const auto ehp=parse_eh_frame(eh_frame);
+	require(ehp->getCIEs()->size()==1 && ehp->getFDEs()->size()==1, "records before a truncated one are listed");
+	require(ehp->findFDE(0x1000)==ehp->getFDEs()->at(0), "an FDE before a truncated record is found");
+	const auto &errors=*ehp->getParseErrors();
+	require(errors.size()==1 && errors[0].kind==PARSE_ERROR_LENGTH && errors[0].position==SYNTHETIC_ADDRESSES.eh_frame_addr+bad_record && 
+		errors[0].length==0x40, "a truncated record is reported");
+}
+
+// a lenient parse skips a damaged CIE and FDE and keeps the records around them.
+void check_damaged_eh_frame()
+{
+	auto model=x86_64_model({{}, {}, {}});
+	model.cies.push_back(model.cies[0]);	// not used by any FDE
+	const auto sections=encode_model(model);
+	const auto base=SYNTHETIC_ADDRESSES.eh_frame_addr;
+	const auto bad_cie=sections.cie_addresses[1];
+	const auto bad_fde=sections.fde_addresses[1];
+
+	// an unknown CIE version, an FDE whose CIE pointer points before the section, and a 
+	// terminator replaced by a length that runs off the end.
+	auto eh_frame=sections.eh_frame;
+	eh_frame[bad_cie-base+8]=99;
+	eh_frame[bad_fde-base+7]=char(0xff);
+	const auto bad_record=eh_frame.size()-4;
+	eh_frame[bad_record]=0x40;
+
+	const auto strict=parse_eh_frame(eh_frame);
+	const auto &strict_errors=*strict->getParseErrors();
+	require(strict->getCIEs()->size()==1 && strict->getFDEs()->empty(), "a strict parse keeps the records before the first error");
+	require(strict_errors.size()==1 && strict_errors[0].kind==PARSE_ERROR_CIE && strict_errors[0].position==bad_cie, "a strict parse stops at the first error");
+
+	const auto lenient=parse_eh_frame(eh_frame, PARSE_LENIENT);
+	const auto &fdes=*lenient->getFDEs();
+	require(lenient->getCIEs()->size()==1 && fdes.size()==2, "a lenient parse keeps the good records");
+	require(fdes[0]->getStartAddress()==0x1000 && fdes[1]->getStartAddress()==0x1200, "a lenient parse skips the damaged FDE");
+	require(lenient->findFDE(0x1100)==nullptr && lenient->findFDE(0x1200)==fdes[1], "a lenient parse finds the FDEs after a damaged one");
+	const auto &errors=*lenient->getParseErrors();
+	require(errors.size()==3, "a lenient parse reports each damaged record");
+	require(errors[0].kind==PARSE_ERROR_CIE && errors[0].position==bad_cie, "a damaged CIE is reported");
+	require(errors[1].kind==PARSE_ERROR_FDE && errors[1].position==bad_fde, "a damaged FDE is reported");
+	require(errors[2].kind==PARSE_ERROR_LENGTH && errors[2].position==base+bad_record, "a truncated record is reported");
+}
+
+// little-endian memory of 8-byte words at base, for the unwinder.
+EHPMemoryReader_t stack_reader(const uint64_t base, const vector<uint64_t> &words)
+{
+	return [base, words](const uint64_t addr, uint8_t* buffer, const size_t size) -> bool
+	{
+		if(addr < base || addr+size > base+8*words.size())
+			return true;
+		for(auto i=size_t(0); i < size; i++)
+		{
+			const auto byte_addr=addr+i-base;
+			buffer[i]=uint8_t(words[byte_addr/8] >> (8*(byte_addr%8)));
+		}
+		return false;
+	};
+}
+
+EHPRegisterSet_t x86_64_registers(const uint64_t pc, const uint64_t rsp)
+{
+	auto regs=EHPRegisterSet_t();
+	regs.pc=pc;
+	regs.pc_is_return_address=false;
+	regs.regs[X86_64_RSP]=rsp;
+	regs.valid.set(X86_64_RSP);
+	return regs;
+}
+
+// walk a synthetic stack through a signal frame to an outermost frame, and into a loop.
+void check_unwinder()
+{
+	auto model=x86_64_model({
+		{0x40|0x10, 0x0e, 16, 0x80|X86_64_RBP, 2},	// after 0x10 bytes, CFA=rsp+16 and rbp at CFA-16
+		{},						// a signal trampoline
+		{0x07, X86_64_RA},				// RA undefined, never reached
+		{},
+		{0x07, X86_64_RA},				// RA undefined, the outermost frame
+		{0x0e, 0}					// CFA=rsp, so the CFA never moves
+		});
+	model.cies.push_back(model.cies[0]);
+	model.cies[1].augmentation="zRS";
+	model.fdes[1].cie=1;
+	const auto sections=encode_model(model);
+	const auto ehp=parse_eh_frame(sections.eh_frame);
+	const auto unwinder=Unwinder_t::factory(*ehp, ARCH_X86_64, LITTLE);
+
+	// the signal frame's saved pc, 0x1300, is where it was interrupted, so it is looked up in 
+	// 0x1300's FDE rather than 0x12ff's.
+	const auto stack=stack_reader(0x7000, {0xabc, 0x1180, 0x1300, 0x1410});
+	auto regs=x86_64_registers(0x1010, 0x7000);
+	auto cfa=uint64_t(0);
+	require(!unwinder->step(regs, cfa, stack), "step out of a frame");
+	require(cfa==0x7010 && regs.pc==0x1180 && regs.pc_is_return_address, "a step finds the CFA and the offset-saved return address");
+	require(regs.valid[X86_64_RSP] && regs.regs[X86_64_RSP]==0x7010, "the caller's stack pointer is the CFA");
+	require(regs.valid[X86_64_RBP] && regs.regs[X86_64_RBP]==0xabc, "a step restores an offset-saved register");
+
+	auto frames=EHPFrameVector_t();
+	unwinder->unwind(x86_64_registers(0x1010, 0x7000), stack, frames, 16);
+	require(frames.size()==4, "the walk ends at an undefined return address");
+	require(frames[0].pc==0x1010 && frames[0].cfa==0x7010, "the innermost frame");
+	require(frames[1].pc==0x1180 && frames[1].cfa==0x7018, "the signal frame");
+	require(frames[2].pc==0x1300 && frames[2].cfa==0x7020, "the interrupted frame is looked up at its own pc");
+	require(frames[3].pc==0x1410 && frames[3].cfa==0, "the outermost frame has no CFA");
+
+	unwinder->unwind(x86_64_registers(0x1500, 0x7008), stack_reader(0x7000, {0x1510, 0}), frames, 16);
+	require(frames.size()==2 && frames[0].cfa==0x7008 && frames[1].cfa==0x7008, "the walk stops when the CFA does not move up");
+
+	unwinder->unwind(x86_64_registers(0x1010, 0x7000), stack, frames, 2);
+	require(frames.size()==2, "the walk stops at max_frames");
+}
+
+bool has_cfa(const EHPCFARow_t* row, const EHPCFARuleType_t type, const uint32_t reg, const int64_t offset)
+{
+	return row!=nullptr && row->cfa.type==type && row->cfa.reg==reg && row->cfa.offset==offset;
+}
+
+bool has_rule(const CFATable_t &table, const EHPCFARow_t* row, const uint32_t reg, const EHPRegisterRuleType_t type, const int64_t operand)
+{
+	const auto rule=table.findRegisterRule(*row, reg);
+	return rule!=nullptr && rule->type==type && rule->operand==operand;
+}
+
+// evaluate hand-built CFA programs row by row.
+void check_cfa_rows()
+{
+	const auto X86_64_RBX=uint32_t(3);
+	const auto X86_64_R12=uint32_t(12);
+	auto model=x86_64_model({
+		{
+			0x41,				// 0x1001
+			0x0e, 16, 0x80|X86_64_RBP, 2,	// CFA=rsp+16, rbp at CFA-16
+			0x41,				// 0x1002
+			0x0a,				// remember_state
+			0x12, X86_64_RBP, 0x7e,		// def_cfa_sf: CFA=rbp+(-2*-8)
+			0x11, X86_64_RBX, 0x03,		// offset_extended_sf: rbx at CFA+3*-8
+			0x15, X86_64_R12, 0x7f,		// val_offset_sf: r12=CFA+(-1*-8)
+			0x41,				// 0x1003
+			0x0b,				// restore_state
+			0x01, 0xef, 0xbe, 0xad, 0xde,	// set_loc, patched below to 0x1010
+			0x0e, 8,			// CFA=rsp+8
+			0xc0|X86_64_RBP			// restore rbp to the CIE's rule, none
+		},
+		{
+			0x41,
+			0x0f, 2, 0x77, 8,		// def_cfa_expression: DW_OP_breg7 8
+			0x0d, X86_64_RBP		// def_cfa_register is meaningless for an expression
+		}
+		});
+	auto eh_frame=encode_model(model).eh_frame;
+
+	// set_loc's operand is pc-relative, like the FDE's addresses.
+	const auto set_loc=eh_frame.find(string("\x0b\x01\xef\xbe\xad\xde"));
+	require(set_loc!=string::npos, "find the set_loc operand");
+	const auto operand_addr=SYNTHETIC_ADDRESSES.eh_frame_addr+set_loc+2;
+	const auto operand=uint32_t(0x1010-operand_addr);
+	for(auto i=0; i < 4; i++)
+		eh_frame[set_loc+2+i]=char(operand >> (8*i));
+
+	const auto ehp=parse_eh_frame(eh_frame);
+	const auto &table=*ehp->getFDEs()->at(0)->getCFATable();
+	require(table.isComplete(), "a well-formed program evaluates completely");
+	require(has_cfa(table.findRow(0x1000), CFA_RULE_REG_OFFSET, X86_64_RSP, 8) && table.findRow(0x1000)->rule_count==1 && 
+		has_rule(table, table.findRow(0x1000), X86_64_RA, REG_RULE_OFFSET, -8), "the CIE's initial rules start the FDE");
+	require(has_cfa(table.findRow(0x1001), CFA_RULE_REG_OFFSET, X86_64_RSP, 16) && 
+		has_rule(table, table.findRow(0x1001), X86_64_RBP, REG_RULE_OFFSET, -16), "def_cfa_offset and offset");
+	const auto row2=table.findRow(0x1002);
+	require(has_cfa(row2, CFA_RULE_REG_OFFSET, X86_64_RBP, 16), "def_cfa_sf is scaled by the data alignment factor");
+	require(has_rule(table, row2, X86_64_RBX, REG_RULE_OFFSET, -24), "offset_extended_sf is scaled by the data alignment factor");
+	require(has_rule(table, row2, X86_64_R12, REG_RULE_VAL_OFFSET, 8), "val_offset_sf is scaled by the data alignment factor");
+	for(const auto pc : {uint64_t(0x1003), uint64_t(0x100f)})
+	{
+		const auto row=table.findRow(pc);
+		require(has_cfa(row, CFA_RULE_REG_OFFSET, X86_64_RSP, 16) && has_rule(table, row, X86_64_RBP, REG_RULE_OFFSET, -16) && 
+			table.findRegisterRule(*row, X86_64_RBX)==nullptr && table.findRegisterRule(*row, X86_64_R12)==nullptr, 
+			"restore_state returns to the remembered rules");
+	}
+	for(const auto pc : {uint64_t(0x1010), uint64_t(0x10ff)})
+	{
+		const auto row=table.findRow(pc);
+		require(has_cfa(row, CFA_RULE_REG_OFFSET, X86_64_RSP, 8) && row->rule_count==1, "set_loc moves to its pc-relative target");
+	}
+	require(table.findRow(0x1100)==nullptr, "rows end with the FDE");
+
+	const auto &expression_table=*ehp->getFDEs()->at(1)->getCFATable();
+	require(!expression_table.isComplete(), "def_cfa_register on an expression makes the table incomplete");
+	require(has_cfa(expression_table.findRow(0x1101), CFA_RULE_EXPRESSION, 0, 0) && expression_table.getExpressions()->size()==1, 
+		"def_cfa_register leaves an expression rule alone");
+}
+
+// the FDE's program changes the CFA before its first advance, as a PLT's or a .cold part's does.
+bool redefines_initial_cfa(const FDEContents_t* fde)
+{
+	for(const auto insn : *fde->getProgram().getInstructions())
+	{
+		auto pc=fde->getStartAddress();
+		if(insn->advance(pc, fde->getCIE().getCAF()))
+			return false;
+		if(get<0>(insn->decode()).compare(0, 7, "def_cfa")==0)
+			return true;
+	}
+	return false;
+}
+
+// every FDE's program evaluates, and on x86-64 the CFA is rsp+8 on entry unless the FDE says otherwise.
+void check_cfa_tables(const EHFrameParser_t* ehp)
+{
+	for(const auto fde : *ehp->getFDEs())
+	{
+		const auto table=fde->getCFATable();
+		require(table->isComplete(), "evaluate an FDE's CFA program");
+		if(fde->getCIE().getReturnRegister()!=X86_64_RA || fde->getStartAddress()==fde->getEndAddress() || redefines_initial_cfa(fde))
+			continue;
+		require(has_cfa(table->findRow(fde->getStartAddress()), CFA_RULE_REG_OFFSET, X86_64_RSP, 8), "CFA=rsp+8 at an x86-64 FDE's start");
+	}
+}
+
+// a CFA program setting the CFA to a DWARF expression.
+EHProgramInstructionByteVector_t cfa_expression(const EHProgramInstructionByteVector_t &expression)
+{
+	auto program=EHProgramInstructionByteVector_t({0x0f, uint8_t(expression.size())});	// def_cfa_expression
+	program.insert(program.end(), expression.begin(), expression.end());
+	return program;
+}
+
+// compile and evaluate DWARF expressions as CFA rules, through the unwinder.
+void check_expressions()
+{
+	const auto lit0=uint8_t(0x30), lit1=uint8_t(0x31), lit3=uint8_t(0x33), breg7=uint8_t(0x77);
+	const auto deref=uint8_t(0x06), dup=uint8_t(0x12), drop=uint8_t(0x13), swap_=uint8_t(0x16), minus=uint8_t(0x1c);
+	const auto plus_uconst=uint8_t(0x23), skip=uint8_t(0x2f), bra=uint8_t(0x28);
+	auto deep=EHProgramInstructionByteVector_t(63, lit0);
+	deep.insert(deep.end(), {breg7, 0x30});
+	auto too_deep=EHProgramInstructionByteVector_t(64, lit0);
+	too_deep.insert(too_deep.end(), {breg7, 0x30});
+	const auto model=x86_64_model({
+		cfa_expression({breg7, 0x10, deref}),					// [rsp+0x10]
+		cfa_expression({lit1, bra, 5, 0, breg7, 0x10, skip, 2, 0, breg7, 0x20}),	// taken forward: rsp+0x20
+		cfa_expression({lit0, bra, 5, 0, breg7, 0x10, skip, 2, 0, breg7, 0x20}),	// not taken, skip forward: rsp+0x10
+		cfa_expression({breg7, 0, lit3,						// acc=rsp, n=3
+			swap_, plus_uconst, 8, swap_, lit1, minus, dup, bra, 0xf6, 0xff,	// acc+=8 until --n is 0
+			drop}),								// rsp+0x18
+		cfa_expression(deep),							// 64 entries: rsp+0x30
+		cfa_expression(too_deep),						// 65 entries
+		cfa_expression({breg7, 0x10, skip, 0xfd, 0xff}),			// skip to itself forever
+		cfa_expression({lit1, bra, 1, 0, breg7, 0x10})				// a branch into an op
+		});
+	const auto ehp=parse_eh_frame(encode_model(model).eh_frame);
+	const auto unwinder=Unwinder_t::factory(*ehp, ARCH_X86_64, LITTLE);
+	const auto stack=stack_reader(0x7000, {1, 1, 0x7040, 1, 1, 1, 1, 1});
+	const auto &fdes=*ehp->getFDEs();
+	const auto cfa_of=[&](const size_t i, uint64_t &cfa) -> bool
+	{
+		auto regs=x86_64_registers(fdes.at(i)->getStartAddress(), 0x7000);
+		return unwinder->step(regs, cfa, stack);
+	};
+	const auto compiled=[&](const size_t i) -> const EHPExpressionOpVector_t&
+	{
+		return fdes.at(i)->getCFATable()->getCompiledExpressions()->at(0);
+	};
+
+	auto cfa=uint64_t(0);
+	require(!cfa_of(0, cfa) && cfa==0x7040, "DW_OP_breg and DW_OP_deref");
+	const auto &branches=compiled(1);
+	require(branches.size()==5 && branches[1].operand1==4 && branches[3].operand1==5, "branch targets resolve to op indexes");
+	require(!cfa_of(1, cfa) && cfa==0x7020, "DW_OP_bra forward when taken");
+	require(!cfa_of(2, cfa) && cfa==0x7010, "DW_OP_bra falls through, DW_OP_skip forward to the end");
+	require(compiled(3).size()==10 && compiled(3)[8].operand1==2, "a backward branch resolves to an op index");
+	require(!cfa_of(3, cfa) && cfa==0x7018, "a loop with a backward DW_OP_bra");
+	require(!cfa_of(4, cfa) && cfa==0x7030, "the stack holds 64 entries");
+	require(cfa_of(5, cfa), "the stack does not hold 65 entries");
+	require(cfa_of(6, cfa), "a runaway loop is stopped");
+	require(compiled(7).empty() && cfa_of(7, cfa), "a branch into the middle of an op does not compile");
+}
+
+// pcs to sample an FDE at: the first and last pc of each of its CFA rows.
+vector<uint64_t> sample_pcs(const FDEContents_t* fde)
+{
+	auto pcs=vector<uint64_t>();
+	for(const auto &row : *fde->getCFATable()->getRows())
+	{
+		pcs.push_back(row.start_addr);
+		pcs.push_back(row.end_addr-1);
+	}
+	return pcs;
+}
+
+// a fixed-width unwind entry says what the FDE's row says, unless it defers to the row.
+void check_unwind_table(const EHFrameParser_t* ehp)
+{
+	const auto &table=*ehp->getUnwindTable();
+	for(auto i=size_t(1); i < table.size(); i++)
+		require(table[i-1].start_addr < table[i].start_addr, "unwind entries are sorted");
+
+	for(const auto fde : *ehp->getFDEs())
+	{
+		const auto &cfa_table=*fde->getCFATable();
+		const auto ra_reg=uint32_t(fde->getCIE().getReturnRegister());
+		if(ehp->findFDE(fde->getEndAddress())==nullptr)
+			require(ehp->findUnwindEntry(fde->getEndAddress())==nullptr, "no unwind entry past an FDE's end");
+		for(const auto pc : sample_pcs(fde))
+		{
+			const auto entry=ehp->findUnwindEntry(pc);
+			require(entry!=nullptr && entry->start_addr <= pc, "find the unwind entry for a covered pc");
+			if(ehp->findFDE(pc)!=fde || (entry->flags & UNWIND_NEEDS_DWARF))
+				continue;
+			const auto row=cfa_table.findRow(pc);
+			require(has_cfa(row, CFA_RULE_REG_OFFSET, entry->cfa_reg, entry->cfa_offset), "an unwind entry has its row's CFA");
+			const auto ra=cfa_table.findRegisterRule(*row, ra_reg);
+			if(entry->flags & UNWIND_RA_AT_CFA)
+				require(has_rule(cfa_table, row, ra_reg, REG_RULE_OFFSET, entry->ra_offset), "an unwind entry has its row's return address slot");
+			else if(entry->flags & UNWIND_RA_UNDEFINED)
+				require(has_rule(cfa_table, row, ra_reg, REG_RULE_UNDEFINED, 0), "an unwind entry's return address is undefined as in its row");
+			else
+				require(ra==nullptr || ra->type==REG_RULE_SAME_VALUE, "an unwind entry's return address is in its register as in its row");
+			if(ra_reg!=X86_64_RA)
+				continue;
+			const auto fp=cfa_table.findRegisterRule(*row, X86_64_RBP);
+			if(entry->flags & UNWIND_FP_AT_CFA)
+				require(has_rule(cfa_table, row, X86_64_RBP, REG_RULE_OFFSET, entry->fp_offset), "an unwind entry has its row's frame pointer slot");
+			else
+				require(fp==nullptr || fp->type==REG_RULE_SAME_VALUE, "an unwind entry's frame pointer is unchanged as in its row");
+		}
+	}
+}
+
+// the CFA offset table's change point at or before pc agrees with the covering FDE's row.
+void check_cfa_offset_table(const EHFrameParser_t* ehp)
+{
+	const auto &table=*ehp->getCFAOffsetTable();
+	for(auto i=size_t(1); i < table.size(); i++)
+		require(table[i-1].addr < table[i].addr, "CFA offset entries are sorted");
+
+	const auto find_entry=[&](const uint64_t pc) -> const EHPCFAOffsetEntry_t*
+	{
+		const auto it=upper_bound(table.begin(), table.end(), pc, 
+			[](const uint64_t pc, const EHPCFAOffsetEntry_t &entry) { return pc < entry.addr; });
+		return it==table.begin() ? nullptr : &*prev(it);
+	};
+	for(const auto fde : *ehp->getFDEs())
+	{
+		auto pcs=sample_pcs(fde);
+		pcs.push_back(fde->getEndAddress());
+		for(const auto pc : pcs)
+		{
+			const auto covering=ehp->findFDE(pc);
+			const auto row = covering==nullptr ? nullptr : covering->getCFATable()->findRow(pc);
+			const auto entry=find_entry(pc);
+			if(row==nullptr)
+			{
+				require(entry==nullptr || entry->type==CFA_RULE_UNDEFINED, "no CFA where no row covers a pc");
+				continue;
+			}
+			require(entry!=nullptr && entry->type==row->cfa.type, "a CFA offset entry has its row's rule type");
+			if(row->cfa.type==CFA_RULE_REG_OFFSET)
+				require(entry->cfa_reg==row->cfa.reg && entry->cfa_offset==row->cfa.offset, "a CFA offset entry has its row's CFA");
+			else
+				require(entry->cfa_reg==0 && entry->cfa_offset==0, "a CFA offset entry for an expression is zero");
+		}
+	}
+}
+
+bool same_summary(const EHPFrameSummary_t &a, const EHPFrameSummary_t &b)
+{
+	if(a.max_frame_size!=b.max_frame_size || a.uses_frame_pointer!=b.uses_frame_pointer || a.has_remember_restore!=b.has_remember_restore || 
+	   a.has_expressions!=b.has_expressions || a.is_complete!=b.is_complete || a.saved_registers.size()!=b.saved_registers.size())
+		return false;
+	for(auto i=size_t(0); i < a.saved_registers.size(); i++)
+		if(a.saved_registers[i].reg!=b.saved_registers[i].reg || a.saved_registers[i].cfa_offset!=b.saved_registers[i].cfa_offset)
+			return false;
+	return true;
+}
+
+// summarize hand-built frames in one pass, with a single chunk for a few FDEs and several for many.
+void check_frame_summaries()
+{
+	const auto X86_64_RBX=uint32_t(3);
+	const auto programs=vector<EHProgramInstructionByteVector_t>({
+		{0x41, 0x0e, 16, 0x80|X86_64_RBP, 2, 0x41, 0x0d, X86_64_RBP, 0x41, 0x0a, 0x0c, X86_64_RSP, 8, 0x41, 0x0b},
+		{},
+		{0x0f, 2, 0x77, 8, 0x80|X86_64_RBX, 3}
+		});
+	const auto expected=vector<EHPFrameSummary_t>({
+		{16, true, true, false, true, {{X86_64_RBP, -16}}},
+		{8, false, false, false, true, {}},
+		{0, false, false, true, true, {{X86_64_RBX, -24}}}
+		});
+
+	for(const auto count : {programs.size(), size_t(1024)})
+	{
+		auto fde_programs=vector<EHProgramInstructionByteVector_t>();
+		for(auto i=size_t(0); i < count; i++)
+			fde_programs.push_back(programs[i%programs.size()]);
+		const auto ehp=parse_eh_frame(encode_model(x86_64_model(fde_programs)).eh_frame);
+		ehp->computeFrameSummaries();
+		const auto &fdes=*ehp->getFDEs();
+		require(fdes.size()==count, "parse the FDEs to summarize");
+		for(auto i=size_t(0); i < count; i++)
+			require(same_summary(fdes[i]->getFrameSummary(), expected[i%programs.size()]), "summarize a frame");
+	}
+}
+
+// the parallel pass gives each FDE the summary it computes on its own.
+void check_frame_summaries(const EHFrameParser_t* ehp, const string &filename)
+{
+	ehp->computeFrameSummaries();
+	const auto one_by_one=EHFrameParser_t::factory(filename);
+	const auto &fdes=*ehp->getFDEs();
+	const auto &other_fdes=*one_by_one->getFDEs();
+	require(fdes.size()==other_fdes.size(), "parse the same FDEs again");
+	for(auto i=size_t(0); i < fdes.size(); i++)
+		require(same_summary(fdes[i]->getFrameSummary(), other_fdes[i]->getFrameSummary()), "the frame summary pass matches summaries computed one by one");
+}
+
+// the graph's nodes and edges are the call site index's call sites and landing pads, both ways.
+void check_exception_graph(const EHFrameParser_t* ehp)
+{
+	const auto &index=*ehp->getCallSiteIndex();
+	const auto &graph=*ehp->getExceptionGraph();
+	const auto &pads=graph.landing_pads;
+	require(graph.call_site_starts.size()==index.size() && graph.call_site_ends.size()==index.size() && 
+		graph.edge_offsets.size()==index.size()+1 && graph.pad_offsets.size()==pads.size()+1, "the graph has a node per call site and landing pad");
+	require(adjacent_find(pads.begin(), pads.end(), greater_equal<uint64_t>())==pads.end(), "landing pads are sorted and unique");
+	require(graph.edge_targets.size()==graph.edge_kinds.size() && graph.filter_offsets.size()==graph.edge_targets.size()+1 && 
+		graph.pad_sources.size()==graph.edge_targets.size(), "every edge has a kind, filters and a reverse edge");
+
+	for(auto i=size_t(0); i < index.size(); i++)
+	{
+		const auto &entry=index[i];
+		require(graph.call_site_starts[i]==entry.start_addr && graph.call_site_ends[i]==entry.end_addr, "a call site node has its call site's range");
+		const auto edges=graph.edge_offsets[i+1]-graph.edge_offsets[i];
+		if(entry.landing_pad_addr==0)
+		{
+			require(edges==0, "a call site without a landing pad has no edge");
+			continue;
+		}
+		require(edges==1, "a call site with a landing pad has one edge");
+		const auto e=graph.edge_offsets[i];
+		const auto target=graph.edge_targets[e];
+		require(target < pads.size() && pads[target]==entry.landing_pad_addr, "an edge goes to its call site's landing pad");
+
+		auto filters=vector<int64_t>();
+		auto kinds=uint8_t(0);
+		for(const auto action : *entry.call_site->getActionTable())
+		{
+			filters.push_back(action->getAction());
+			kinds |= action->getAction()==0 ? EDGE_CLEANUP : action->getAction() > 0 ? EDGE_CATCH : EDGE_EXCEPTION_SPEC;
+		}
+		require(filters==vector<int64_t>(graph.type_filters.begin()+graph.filter_offsets[e], graph.type_filters.begin()+graph.filter_offsets[e+1]), 
+			"an edge has its call site's type filters");
+		require(graph.edge_kinds[e]==(kinds==0 ? EDGE_CLEANUP : kinds), "an edge's kind follows its type filters");
+
+		const auto sources_begin=graph.pad_sources.begin()+graph.pad_offsets[target];
+		const auto sources_end=graph.pad_sources.begin()+graph.pad_offsets[target+1];
+		require(binary_search(sources_begin, sources_end, uint32_t(i)), "a landing pad lists the call sites reaching it");
+	}
+	for(auto j=size_t(0); j < pads.size(); j++)
+	{
+		require(graph.pad_offsets[j] < graph.pad_offsets[j+1], "every landing pad is reached");
+		require(is_sorted(graph.pad_sources.begin()+graph.pad_offsets[j], graph.pad_sources.begin()+graph.pad_offsets[j+1]), "a landing pad's sources are in order");
+	}
+}
+
+// landing pads outside their own functions, shared between functions.
+void check_exception_graph_order()
+{
+	auto model=x86_64_model({{}, {}});
+	add_lsda(model, 0, 0x1000, {{0x1010, 0x1020, 0x1150, {0}}});
+	add_lsda(model, 1, 0x1000, {{0x1110, 0x1120, 0x1050, {}}, {0x1130, 0x1140, 0x1150, {0}}, {0x1140, 0x1150, 0, {}}});
+	const auto sections=encode_model(model);
+	const auto ehp=parse_sections(model, SYNTHETIC_ADDRESSES, sections);
+	check_exception_graph(ehp.get());
+
+	const auto &graph=*ehp->getExceptionGraph();
+	require(graph.landing_pads==vector<uint64_t>({0x1050, 0x1150}), "landing pads are sorted across functions");
+	require(graph.edge_offsets==vector<uint32_t>({0, 1, 2, 3, 3}) && graph.edge_targets==vector<uint32_t>({1, 0, 1}), "edges go to landing pads in other functions");
+	require(graph.pad_offsets==vector<uint32_t>({0, 1, 3}) && graph.pad_sources==vector<uint32_t>({1, 0, 2}), "a shared landing pad has both sources");
+}
+
+// every catch clause of every call site is listed under its type, and nothing else is.
+void check_catch_index(const EHFrameParser_t* ehp)
+{
+	const auto &catches=*ehp->getCatchIndex();
+	for(const auto &entry : *ehp->getCallSiteIndex())
+	{
+		const auto &type_table=*entry.fde->getLSDA()->getTypeTable();
+		for(const auto action : *entry.call_site->getActionTable())
+		{
+			const auto filter=action->getAction();
+			if(filter <= 0 || uint64_t(filter) > type_table.size())
+				continue;
+			const auto sites=ehp->findCatchSites(type_table[filter-1]->getTypeInfoPointer());
+			require(sites!=nullptr && any_of(sites->begin(), sites->end(), [&](const EHPCatchSite_t &site) 
+				{ 
+					return site.call_site==entry.call_site && site.call_site_addr==entry.start_addr && site.landing_pad_addr==entry.landing_pad_addr; 
+				}), "a catch clause is listed under its type");
+		}
+	}
+	for(const auto &type_sites : catches)
+	{
+		const auto &sites=type_sites.second;
+		require(ehp->findCatchSites(type_sites.first)==&sites, "find the catch sites of a type");
+		require(is_sorted(sites.begin(), sites.end(), [](const EHPCatchSite_t &a, const EHPCatchSite_t &b) { return a.call_site_addr < b.call_site_addr; }), 
+			"catch sites are sorted by address");
+		for(const auto &site : sites)
+		{
+			const auto &type_table=*site.fde->getLSDA()->getTypeTable();
+			require(site.type_filter > 0 && uint64_t(site.type_filter) <= type_table.size() && 
+				type_table[site.type_filter-1]->getTypeInfoPointer()==type_sites.first, "a catch site's filter names its type");
+		}
+	}
+	auto missing=uint64_t(1);
+	while(catches.count(missing)!=0)
+		missing++;
+	require(ehp->findCatchSites(missing)==nullptr, "nothing catches a type no call site names");
+}
+
+// catch clauses of hand-built LSDAs, including catch(...) and a type shared by two functions.
+void check_catch_sites()
+{
+	auto model=x86_64_model({{}, {}});
+	add_lsda(model, 0, 0, {{0x1010, 0x1020, 0x1080, {1, 2}}, {0x1020, 0x1030, 0x1090, {0}}}, {0xa000, 0xb000});
+	add_lsda(model, 1, 0, {{0x1110, 0x1120, 0x1180, {1}}, {0x1120, 0x1130, 0x1190, {2, 2}}}, {0xb000, 0});
+	const auto ehp=parse_sections(model, SYNTHETIC_ADDRESSES, encode_model(model));
+	check_catch_index(ehp.get());
+
+	const auto listed=[&](const uint64_t type_info) -> vector<pair<uint64_t, int64_t> >
+	{
+		auto result=vector<pair<uint64_t, int64_t> >();
+		const auto sites=ehp->findCatchSites(type_info);
+		if(sites!=nullptr)
+			for(const auto &site : *sites)
+				result.push_back(make_pair(site.call_site_addr, site.type_filter));
+		return result;
+	};
+	require(ehp->getCatchIndex()->size()==3, "three types are caught");
+	require(listed(0xa000)==vector<pair<uint64_t, int64_t> >({{0x1010, 1}}), "one call site catches a type");
+	require(listed(0xb000)==vector<pair<uint64_t, int64_t> >({{0x1010, 2}, {0x1110, 1}}), "two functions catch a type");
+	require(listed(0)==vector<pair<uint64_t, int64_t> >({{0x1120, 2}}), "catch(...) is listed once under 0");
+}
+
+// sorted, with overlapping and touching ranges merged, as the coverage queries take them.
+EHPAddressRangeVector_t merge_ranges(EHPAddressRangeVector_t ranges)
+{
+	sort(ranges.begin(), ranges.end(), [](const EHPAddressRange_t &a, const EHPAddressRange_t &b) { return a.start < b.start; });
+	auto merged=EHPAddressRangeVector_t();
+	for(const auto &r : ranges)
+	{
+		if(r.start >= r.end)
+			continue;
+		if(merged.size() > 0 && r.start <= merged.back().end)
+			merged.back().end=max(merged.back().end, r.end);
+		else
+			merged.push_back(r);
+	}
+	return merged;
+}
+
+bool same_ranges(const EHPAddressRangeVector_t &a, const EHPAddressRangeVector_t &b)
+{
+	return a.size()==b.size() && equal(a.begin(), a.end(), b.begin(), 
+		[](const EHPAddressRange_t &x, const EHPAddressRange_t &y) { return x.start==y.start && x.end==y.end; });
+}
+
+// the gaps and the FDE ranges clipped to the executable ranges tile them exactly, and the 
+// coverage map sets a bit for each covered byte and no others.
+void check_coverage(const EHFrameParser_t* ehp, const EHPAddressRangeVector_t &ranges)
+{
+	const auto merged=merge_ranges(ranges);
+	auto covered=EHPAddressRangeVector_t();
+	for(const auto fde : *ehp->getFDEs())
+		for(const auto &r : merged)
+			if(max(fde->getStartAddress(), r.start) < min(fde->getEndAddress(), r.end))
+				covered.push_back({max(fde->getStartAddress(), r.start), min(fde->getEndAddress(), r.end)});
+	covered=merge_ranges(covered);
+
+	auto gaps=EHPAddressRangeVector_t();
+	ehp->getCoverageGaps(ranges, gaps);
+	require(same_ranges(gaps, merge_ranges(gaps)), "coverage gaps are sorted, disjoint and not empty");
+
+	auto pieces=covered;
+	pieces.insert(pieces.end(), gaps.begin(), gaps.end());
+	sort(pieces.begin(), pieces.end(), [](const EHPAddressRange_t &a, const EHPAddressRange_t &b) { return a.start < b.start; });
+	for(auto i=size_t(1); i < pieces.size(); i++)
+		require(pieces[i-1].end <= pieces[i].start, "no coverage gap overlaps an FDE");
+	require(same_ranges(merge_ranges(pieces), merged), "the coverage gaps and the FDEs tile the executable ranges");
+
+	auto map=EHPCoverageMap_t();
+	ehp->getCoverageMap(ranges, map);
+	require(same_ranges(map.ranges, merged), "the coverage map is over the executable ranges");
+	auto bits_set=uint64_t(0);
+	for(const auto word : map.bits)
+		bits_set+=__builtin_popcountll(word);
+	auto covered_bytes=uint64_t(0);
+	for(const auto &r : covered)
+	{
+		covered_bytes+=r.end-r.start;
+		require(map.isCovered(r.start) && map.isCovered(r.end-1), "the coverage map covers each FDE");
+	}
+	require(bits_set==covered_bytes, "the coverage map sets one bit per covered byte");
+	for(const auto &g : gaps)
+		require(!map.isCovered(g.start) && !map.isCovered(g.end-1), "the coverage map leaves the gaps out");
+}
+
+// coverage of hand-built FDEs over unsorted, touching and empty executable ranges.
+void check_coverage()
+{
+	auto model=x86_64_model({{}, {}, {}, {}});
+	model.fdes[1].end=0x1180;
+	const auto sections=encode_model(model);
+	const auto ranges=EHPAddressRangeVector_t({{0x1300, 0x1500}, {0x0f00, 0x1080}, {0x2000, 0x2000}, {0x1080, 0x1200}});
+	const auto ehp=EHFrameParser_t::factory(8, LITTLE, 
+		sections.eh_frame, SYNTHETIC_ADDRESSES.eh_frame_addr, 
+		sections.eh_frame_hdr, SYNTHETIC_ADDRESSES.eh_frame_hdr_addr, 
+		sections.gcc_except_table, SYNTHETIC_ADDRESSES.gcc_except_table_addr, 
+		PARSE_STRICT, ranges);
+	require(same_ranges(*ehp->getExecutableRanges(), ranges), "the parser keeps the executable ranges it was given");
+	check_coverage(ehp.get(), ranges);
+
+	auto gaps=EHPAddressRangeVector_t();
+	ehp->getCoverageGaps(ranges, gaps);
+	require(same_ranges(gaps, {{0x0f00, 0x1000}, {0x1180, 0x1200}, {0x1400, 0x1500}}), "find the coverage gaps");
+
+	auto map=EHPCoverageMap_t();
+	ehp->getCoverageMap(ranges, map);
+	const auto covered=vector<uint64_t>({0x1000, 0x117f, 0x1300, 0x13ff});
+	const auto uncovered=vector<uint64_t>({0x0eff, 0x0fff, 0x1180, 0x1200, 0x1280, 0x1400, 0x14ff, 0x1500});
+	require(all_of(covered.begin(), covered.end(), [&](const uint64_t addr) { return map.isCovered(addr); }), "addresses in FDEs are covered");
+	require(none_of(uncovered.begin(), uncovered.end(), [&](const uint64_t addr) { return map.isCovered(addr); }), 
+		"addresses outside the FDEs or the executable ranges are not");
+}
+
+// hand-built headers, through the generic decoder and with the errors readSearchTable must catch.
+void check_read_search_table()
+{
+	const auto header=[](const EHPEndianness_t endian, const uint8_t version, const uint8_t table_encoding, const uint32_t count, 
+		const vector<uint64_t> &words) -> string
+	{
+		const auto put=[&](string &out, const uint64_t value, const size_t size)
+		{
+			for(auto i=size_t(0); i < size; i++)
+				out.push_back(char(value >> (8*(endian==BIG ? size-1-i : i))));
+		};
+		auto hdr=string();
+		hdr.push_back(char(version));
+		hdr.push_back(char(0x04));		// eh_frame_ptr: DW_EH_PE_udata8
+		hdr.push_back(char(0x03));		// fde_count: DW_EH_PE_udata4
+		hdr.push_back(char(table_encoding));
+		put(hdr, SYNTHETIC_ADDRESSES.eh_frame_addr, 8);
+		put(hdr, count, 4);
+		for(const auto word : words)
+			put(hdr, word, 8);
+		return hdr;
+	};
+	const auto entries=vector<uint64_t>({0x1000, 0x100018, 0x1100, 0x100030});
+	const auto read=[](const EHPEndianness_t endian, const string &hdr, EHPSearchTable_t &table)
+	{
+		return EHFrameParser_t::readSearchTable(8, endian, hdr, SYNTHETIC_ADDRESSES.eh_frame_hdr_addr, table);
+	};
+
+	for(const auto endian : {LITTLE, BIG})
+	{
+		auto table=EHPSearchTable_t();
+		require(!read(endian, header(endian, 1, 0x00, 2, entries), table), "read an absptr search table");	// DW_EH_PE_absptr
+		require(table.size()==2 && table[0].initial_location==0x1000 && table[0].fde_address==0x100018 && 
+			table[1].initial_location==0x1100 && table[1].fde_address==0x100030, "absptr entries are read as written");
+		require(!read(endian, header(endian, 1, 0x04, 2, entries), table) && table.size()==2 && table[1].fde_address==0x100030, 
+			"read a udata8 search table");
+	}
+
+	auto table=EHPSearchTable_t();
+	require(read(LITTLE, header(LITTLE, 2, 0x00, 2, entries), table), "a version 2 header is rejected");
+	require(read(LITTLE, header(LITTLE, 1, 0xff, 2, entries), table), "a header without a table is reported");
+	require(read(LITTLE, header(LITTLE, 1, 0x00, 1000, entries), table), "a count larger than the section is rejected");
+	require(read(LITTLE, header(LITTLE, 1, 0x00, 3, entries), table), "a table cut short is rejected");
+	require(read(LITTLE, "", table), "an empty section is rejected");
+}
+
+// the symbol join against a symbol by symbol search: an FDE gets the best symbol at its start, 
+// else one containing its start, and a symbol is uncovered if findFDE does not find its address.
+void check_symbol_join(const EHFrameParser_t* ehp)
+{
+	const auto &fdes=*ehp->getFDEs();
+	const auto &join=*ehp->getSymbolJoin();
+	const auto &syms=join.symbols;
+	require(join.fde_symbols.size()==fdes.size(), "the symbol join has a symbol index per FDE");
+	require(is_sorted(syms.begin(), syms.end(), [](const EHPSymbol_t &a, const EHPSymbol_t &b) { return a.address < b.address; }), 
+		"joined symbols are sorted by address");
+	for(const auto &sym : *ehp->getSymbols())
+	{
+		const auto kept=count_if(syms.begin(), syms.end(), [&](const EHPSymbol_t &s) { return s.address==sym.address && s.name==sym.name; });
+		require(kept==1, "each symbol is joined once, without its .dynsym copy");
+	}
+
+	// the best symbol at each address, by binding then sized before unsized.
+	const auto better=[](const EHPSymbol_t &a, const EHPSymbol_t &b) 
+		{ return a.binding < b.binding || (a.binding==b.binding && a.size!=0 && b.size==0); };
+	auto unnamed=vector<uint64_t>();
+	for(auto i=size_t(0); i < fdes.size(); i++)
+	{
+		const auto start=fdes[i]->getStartAddress();
+		const auto at=equal_range(syms.begin(), syms.end(), EHPSymbol_t({"", start, 0, SYMBOL_GLOBAL, false}), 
+			[](const EHPSymbol_t &a, const EHPSymbol_t &b) { return a.address < b.address; });
+		const auto containing=any_of(syms.begin(), at.first, [&](const EHPSymbol_t &s) { return start-s.address < s.size; });
+		const auto sym=join.fde_symbols[i];
+		if(at.first!=at.second)
+			require(sym!=EHP_NO_SYMBOL && syms[sym].address==start && 
+				none_of(at.first, at.second, [&](const EHPSymbol_t &s) { return better(s, syms[sym]); }), "an FDE gets the best symbol at its start");
+		else if(containing)
+			require(sym!=EHP_NO_SYMBOL && syms[sym].address < start && start-syms[sym].address < syms[sym].size, 
+				"an FDE without a symbol at its start gets one containing it");
+		else
+			require(sym==EHP_NO_SYMBOL, "an FDE outside every symbol has none");
+		if(sym==EHP_NO_SYMBOL)
+			unnamed.push_back(i);
+	}
+	require(join.unnamed_fdes==unnamed, "unnamed FDEs are the ones without a symbol");
+
+	auto uncovered=vector<uint64_t>();
+	for(auto i=size_t(0); i < syms.size(); i++)
+		if(ehp->findFDE(syms[i].address)==nullptr)
+			uncovered.push_back(i);
+	require(join.uncovered_symbols==uncovered, "uncovered symbols are the ones no FDE covers");
+
+	auto again=EHPSymbolJoin_t();
+	ehp->joinSymbols(*ehp->getSymbols(), again);
+	require(again.fde_symbols==join.fde_symbols && again.uncovered_symbols==join.uncovered_symbols, "joinSymbols matches getSymbolJoin");
+}
+
+// names for hand-built FDEs: binding and size order at one address, a symbol containing an 
+// FDE's start, a .dynsym copy, and symbols no FDE covers.
+void check_symbol_join()
+{
+	const auto model=x86_64_model({{}, {}, {}, {}, {}});
+	const auto sections=encode_model(model);
+	const auto symbols=EHPSymbolVector_t({
+		{"nofde",    0x2000, 0x10,  SYMBOL_GLOBAL, false},
+		{"local_f",  0x1000, 0x100, SYMBOL_LOCAL,  false},
+		{"dup",      0x1200, 0x100, SYMBOL_GLOBAL, true},
+		{"weak_f",   0x1000, 0x100, SYMBOL_WEAK,   false},
+		{"outer",    0x1080, 0x100, SYMBOL_LOCAL,  false},
+		{"global_f", 0x1000, 0,     SYMBOL_GLOBAL, false},
+		{"dup",      0x1200, 0x100, SYMBOL_GLOBAL, false},
+		{"dyn_only", 0x1400, 0x10,  SYMBOL_WEAK,   true},
+		{"global_g", 0x1000, 0x100, SYMBOL_GLOBAL, false}
+		});
+	const auto ehp=EHFrameParser_t::factory(8, LITTLE, 
+		sections.eh_frame, SYNTHETIC_ADDRESSES.eh_frame_addr, 
+		sections.eh_frame_hdr, SYNTHETIC_ADDRESSES.eh_frame_hdr_addr, 
+		sections.gcc_except_table, SYNTHETIC_ADDRESSES.gcc_except_table_addr, 
+		PARSE_STRICT, EHPAddressRangeVector_t(), symbols);
+	check_symbol_join(ehp.get());
+
+	const auto &join=*ehp->getSymbolJoin();
+	auto names=vector<string>();
+	for(const auto &sym : join.symbols)
+		names.push_back(sym.name);
+	require(names==vector<string>({"global_g", "global_f", "weak_f", "local_f", "outer", "dup", "dyn_only", "nofde"}), 
+		"symbols are ordered by address, binding and size");
+	require(!join.symbols[5].is_dynamic, "the .symtab symbol is kept over its .dynsym copy");
+	require(join.fde_symbols==vector<uint64_t>({0, 4, 5, EHP_NO_SYMBOL, 6}), "FDEs get their symbols");
+	require(join.unnamed_fdes==vector<uint64_t>({3}) && join.uncovered_symbols==vector<uint64_t>({7}), 
+		"an FDE without a symbol and a symbol without an FDE are listed");
+}
+
+// patch hand-built sections with a shift that fits, then with one that widens call site offsets past 
+// their uleb128 bytes and moves an FDE out of reach of its pc-relative sdata4 start.
+void check_patch_overflow()
+{
+	auto model=x86_64_model({{}, {}});
+	add_lsda(model, 0, 0, {{0x1010, 0x1020, 0x1080, {}}});
+	add_lsda(model, 1, 0, {{0x1110, 0x1120, 0, {}}});
+	const auto sections=encode_model(model);
+	const auto ehp=parse_sections(model, SYNTHETIC_ADDRESSES, sections);
+	const auto in_code=[](const uint64_t addr) { return addr >= 0x1000 && addr < 0x1200; };
+
+	auto eh_frame=sections.eh_frame;
+	auto gcc_except_table=sections.gcc_except_table;
+	auto errors=EHPPatchErrorVector_t();
+	const auto shift=EHPAddressMap_t([&](const uint64_t addr) { return in_code(addr) ? addr+0x10 : addr; });
+	require(!ehp->patchAddresses(shift, eh_frame, gcc_except_table, errors) && errors.empty(), "patch with a shift that fits");
+	// the parsed model has the landing pad bases filled in, which move with their FDEs.
+	auto shifted_model=EHPSectionModel_t();
+	ehp->getModel(shifted_model);
+	for(auto &fde : shifted_model.fdes)
+	{
+		fde.start+=0x10;
+		fde.end+=0x10;
+		fde.lsda.landing_pad_base+=0x10;
+		for(auto &cs : fde.lsda.call_sites)
+		{
+			cs.start+=0x10;
+			cs.end+=0x10;
+			cs.landing_pad+= cs.landing_pad==0 ? 0 : 0x10;
+		}
+	}
+	// the search table is not patched, so it is left out.
+	auto patched=EHPEncodedSections_t();
+	patched.eh_frame=eh_frame;
+	patched.gcc_except_table=gcc_except_table;
+	auto patched_model=EHPSectionModel_t();
+	parse_sections(model, SYNTHETIC_ADDRESSES, patched)->getModel(patched_model);
+	require(same_model(shifted_model, patched_model), "patched sections parse back with the shifted addresses");
+
+	// FDE 0 grows 16 times over, FDE 1 moves past 4GB.
+	const auto overflow=EHPAddressMap_t([](const uint64_t addr)
+		{
+			if(addr >= 0x1000 && addr < 0x1100)
+				return 0x1000+(addr-0x1000)*0x10;
+			if(addr >= 0x1100 && addr < 0x1200)
+				return addr+(uint64_t(1)<<32);
+			return addr;
+		});
+	eh_frame=sections.eh_frame;
+	gcc_except_table=sections.gcc_except_table;
+	require(ehp->patchAddresses(overflow, eh_frame, gcc_except_table, errors), "patch with a shift that overflows");
+	const auto &fdes=*ehp->getFDEs();
+	const auto &cs=*fdes[0]->getLSDA()->getCallSites()->at(0);
+	const auto start_pos=cs.getCallSiteAddressPosition();
+	const auto length_pos=cs.getCallSiteEndAddressPosition();
+	const auto fde_pos=fdes[1]->getStartAddressPosition();
+	require(errors.size()==3 &&
+		errors[0].field==PATCH_CALL_SITE_START && errors[0].position==start_pos && errors[0].value==0x100 &&
+		errors[1].field==PATCH_CALL_SITE_LENGTH && errors[1].position==length_pos && errors[1].value==0xf1 &&
+		errors[2].field==PATCH_FDE_START && errors[2].position==fde_pos && errors[2].value==0x100001100, 
+		"an overflowing patch reports the fields that do not fit");
+
+	// fields in error keep their bytes; the landing pad, 0x800 past the start, still fits in two.
+	const auto gcc_offset=[](const uint64_t pos) { return pos-SYNTHETIC_ADDRESSES.gcc_except_table_addr; };
+	const auto fde_offset=fde_pos-SYNTHETIC_ADDRESSES.eh_frame_addr;
+	const auto fde_width=fdes[1]->getEndAddressPosition()-fde_pos;
+	require(gcc_except_table.substr(gcc_offset(start_pos), cs.getLandingPadAddressPosition()-start_pos)==
+		sections.gcc_except_table.substr(gcc_offset(start_pos), cs.getLandingPadAddressPosition()-start_pos) &&
+		eh_frame.substr(fde_offset, fde_width)==sections.eh_frame.substr(fde_offset, fde_width), 
+		"fields that do not fit are left alone");
+	const auto lp_offset=gcc_offset(cs.getLandingPadAddressPosition());
+	require(gcc_except_table.substr(lp_offset, 2)==string("\x80\x10"), "a landing pad that fits is patched");
+}
+
+// a file for the cache to stat, removed by the caller.
+string make_temp_file(const string &contents)
+{
+	auto filename=string("test.cache.XXXXXX");
+	const auto fd=mkstemp(&filename[0]);
+	require(fd >= 0 && write(fd, contents.data(), contents.size())==ssize_t(contents.size()), "create a file to cache");
+	close(fd);
+	return filename;
+}
+
+// a cache over hand-built parsers: hits and misses, one parse for concurrent callers, LRU 
+// eviction by the parsers' memory, replaced files, and failed loads.
+void check_parser_cache()
+{
+	const auto model=x86_64_model({{}, {}, {}});
+	const auto sections=encode_model(model);
+	const auto parser_bytes=parse_sections(model, SYNTHETIC_ADDRESSES, sections)->getMemoryUsage();
+	require(parser_bytes >= sections.eh_frame.size()+sections.eh_frame_hdr.size(), "a parser counts its sections");
+
+	atomic<int> loads(0);
+	auto throwing=string();
+	auto empty=string();
+	const auto loader=EHPParserLoader_t([&](const string &filename) -> unique_ptr<const EHFrameParser_t>
+		{
+			loads++;
+			// long enough for concurrent callers to find the parse in progress.
+			this_thread::sleep_for(chrono::milliseconds(20));
+			if(filename==throwing)
+				throw runtime_error("cannot load " + filename);
+			if(filename==empty)
+				return unique_ptr<const EHFrameParser_t>();
+			return parse_sections(model, SYNTHETIC_ADDRESSES, sections);
+		});
+	const auto a=make_temp_file("a");
+	const auto b=make_temp_file("b");
+	const auto c=make_temp_file("c");
+
+	// room for two parsers, not three.
+	auto cache=EHFrameParserCache_t::factory(parser_bytes*2+parser_bytes/2, loader);
+	const auto first=cache->get(a);
+	require(cache->get(a)==first && loads==1, "a cached parser is handed out again");
+	auto stats=cache->getStats();
+	require(stats.hits==1 && stats.misses==1 && stats.entries==1 && stats.memory_bytes==parser_bytes, "count a hit and a miss");
+
+	auto handles=vector<shared_ptr<const EHFrameParser_t> >(8);
+	auto threads=vector<thread>();
+	for(auto i=size_t(0); i < handles.size(); i++)
+		threads.push_back(thread([&, i]() { handles[i]=cache->get(b); }));
+	for(auto &t : threads)
+		t.join();
+	require(loads==2 && all_of(handles.begin(), handles.end(), [&](const shared_ptr<const EHFrameParser_t> &h) { return h && h==handles[0]; }), 
+		"concurrent callers share one parse");
+	stats=cache->getStats();
+	require(stats.misses==2 && stats.hits==8, "callers that waited for a parse count as hits");
+
+	// a was used more recently than b, so c pushes b out.
+	cache->get(a);
+	cache->get(c);
+	stats=cache->getStats();
+	require(stats.evictions==1 && stats.entries==2 && stats.memory_bytes==parser_bytes*2, "the least recently used parser is evicted");
+	require(cache->get(a)==first && loads==3, "a recently used parser stays");
+	cache->get(b);
+	require(loads==4, "an evicted parser is loaded again");
+
+	// parsers grow as their tables are built, and the cache measures them again on each get.
+	auto growing=EHFrameParserCache_t::factory(parser_bytes*2, loader);
+	growing->get(a);
+	const auto grown=growing->get(b);
+	require(growing->getStats().evictions==0, "two parsers fit");
+	grown->getUnwindTable();
+	grown->getCallSiteIndex();
+	require(grown->getMemoryUsage() > parser_bytes, "building tables adds to a parser's memory");
+	growing->get(b);
+	stats=growing->getStats();
+	require(stats.evictions==1 && stats.entries==1 && stats.memory_bytes==grown->getMemoryUsage(), "a grown parser pushes out the others");
+
+	// a file whose modification time changes is parsed again, replacing the old parser.
+	struct timespec times[2]={{0, UTIME_OMIT}, {1234567, 0}};
+	require(utimensat(AT_FDCWD, a.c_str(), times, 0)==0, "change a file's modification time");
+	const auto loads_before=loads.load();
+	const auto entries_before=cache->getStats().entries;
+	require(cache->get(a)!=first && loads==loads_before+1, "a changed file is parsed again");
+	require(cache->getStats().entries==entries_before, "the stale parser is dropped");
+
+	// failed loads are not cached, so the next caller tries again.
+	const auto fails=[&](const string &filename) -> bool
+	{
+		try
+		{
+			cache->get(filename);
+		}
+		catch(const exception &)
+		{
+			return true;
+		}
+		return false;
+	};
+	throwing=make_temp_file("throwing");
+	empty=make_temp_file("empty");
+	const auto entries=cache->getStats().entries;
+	require(fails(throwing) && fails(throwing) && loads==loads_before+3, "a loader that throws is called again");
+	require(fails(empty) && fails(empty) && loads==loads_before+5, "a loader that returns nothing is called again");
+	require(fails("test.cache.missing") && loads==loads_before+5, "a missing file is not loaded");
+	require(cache->getStats().entries==entries, "failed loads are not cached");
+
+	for(const auto &filename : {a, b, c, throwing, empty})
+		unlink(filename.c_str());
+}
+
+// just enough JSON to read writeJSON's output back.
+struct json_t
+{
+	char kind;			// one of n, b, #, ", [ and {
+	string text;			// a number's digits, a string's contents, or true or false
+	vector<string> keys;		// an object's keys, in order
+	vector<json_t> items;		// an array's elements or an object's values
+
+	const json_t& operator[](const string &key) const
+	{
+		const auto it=find(keys.begin(), keys.end(), key);
+		require(it!=keys.end(), "a JSON object has the member " + key);
+		return items[it-keys.begin()];
+	}
+	uint64_t number() const { require(kind=='#', "a JSON number"); return stoull(text); }
+};
+
+// parse the value at pos and skip the whitespace after it.  returns true if it is malformed.
+bool parse_json(const string &in, size_t &pos, json_t &value)
+{
+	const auto skip_space=[&]() { while(pos < in.size() && isspace(static_cast<unsigned char>(in[pos]))) pos++; };
+	const auto parse_string=[&](string &out) -> bool
+	{
+		for(pos++; pos < in.size() && in[pos]!='"'; pos++)
+		{
+			if(in[pos]!='\\')
+				out.push_back(in[pos]);
+			else if(pos+1 < in.size() && in[pos+1]=='u' && pos+5 < in.size())
+			{
+				out.push_back(char(stoul(in.substr(pos+2, 4), nullptr, 16)));
+				pos+=5;
+			}
+			else if(pos+1 < in.size())
+				out.push_back(in[++pos]);
+		}
+		return pos++ >= in.size();
+	};
+
+	skip_space();
+	if(pos >= in.size())
+		return true;
+	value=json_t();
+	value.kind=in[pos];
+	if(in[pos]=='"')
+	{
+		if(parse_string(value.text))
+			return true;
+	}
+	else if(in[pos]=='[' || in[pos]=='{')
+	{
+		const auto close = in[pos]=='[' ? ']' : '}';
+		pos++;
+		skip_space();
+		if(pos < in.size() && in[pos]==close)
+			pos++;
+		else while(true)
+		{
+			if(close=='}')
+			{
+				skip_space();
+				value.keys.push_back(string());
+				if(pos >= in.size() || in[pos]!='"' || parse_string(value.keys.back()))
+					return true;
+				skip_space();
+				if(pos >= in.size() || in[pos++]!=':')
+					return true;
+			}
+			value.items.push_back(json_t());
+			if(parse_json(in, pos, value.items.back()) || pos >= in.size())
+				return true;
+			if(in[pos++]==close)
+				break;
+			if(in[pos-1]!=',')
+				return true;
+		}
+	}
+	else if(in.compare(pos, 4, "null")==0 || in.compare(pos, 4, "true")==0 || in.compare(pos, 5, "false")==0)
+	{
+		value.kind = in[pos]=='n' ? 'n' : 'b';
+		value.text = in[pos]=='f' ? "false" : in.substr(pos, 4);
+		pos+=value.text.size();
+	}
+	else if(in[pos]=='-' || isdigit(static_cast<unsigned char>(in[pos])))
+	{
+		value.kind='#';
+		const auto start=pos;
+		for(pos++; pos < in.size() && (isdigit(static_cast<unsigned char>(in[pos])) || strchr("+-.eE", in[pos])!=nullptr); pos++)
+			;
+		value.text=in.substr(start, pos-start);
+	}
+	else
+		return true;
+	skip_space();
+	return false;
+}
+
+// a CIE or FDE read back from JSON describes the record it was written from.
+void check_json_record(const json_t &record, const CIEContents_t* cie, const FDEContents_t* fde)
+{
+	require(record.kind=='{' && record["type"].text==(cie!=nullptr ? "cie" : "fde"), "a JSON record has its type");
+	if(cie!=nullptr)
+	{
+		require(record["position"].number()==cie->getPosition() && record["augmentation"].text==cie->getAugmentation() && 
+			record["instructions"].items.size()==cie->getProgram().getInstructions()->size(), "a JSON CIE describes its CIE");
+		return;
+	}
+	require(record["position"].number()==fde->getPosition() && record["start"].number()==fde->getStartAddress() && 
+		record["end"].number()==fde->getEndAddress() && record["cie"].number()==fde->getCIE().getPosition() && 
+		record["lsda_address"].number()==fde->getLSDAAddress() && 
+		record["instructions"].items.size()==fde->getProgram().getInstructions()->size(), "a JSON FDE describes its FDE");
+	if(fde->getLSDAAddress()!=0)
+		require(record["lsda"]["call_sites"].items.size()==fde->getLSDA()->getCallSites()->size() && 
+			record["lsda"]["type_table"].items.size()==fde->getLSDA()->getTypeTable()->size(), "a JSON LSDA lists its call sites and types");
+}
+
+// both JSON formats parse back to one record per CIE and FDE, in order.
+void check_json(const EHFrameParser_t* ehp)
+{
+	const auto &cies=*ehp->getCIEs();
+	const auto &fdes=*ehp->getFDEs();
+
+	auto document=string();
+	ehp->writeJSON(*OutputSink_t::factory(document), JSON_DOCUMENT);
+	auto pos=size_t(0);
+	auto root=json_t();
+	require(!parse_json(document, pos, root) && pos==document.size() && root.kind=='{', "the JSON document is one object");
+	require(root["cies"].items.size()==cies.size() && root["fdes"].items.size()==fdes.size(), "the JSON document has every CIE and FDE");
+	for(auto i=size_t(0); i < cies.size(); i++)
+		check_json_record(root["cies"].items[i], cies[i], nullptr);
+	for(auto i=size_t(0); i < fdes.size(); i++)
+		check_json_record(root["fdes"].items[i], nullptr, fdes[i]);
+
+	auto lines=string();
+	ehp->writeJSON(*OutputSink_t::factory(lines), JSON_LINES);
+	auto count=size_t(0);
+	for(auto start=size_t(0); start < lines.size(); count++)
+	{
+		const auto end=lines.find('\n', start);
+		require(end!=string::npos, "each JSON line ends in a newline");
+		const auto line=lines.substr(start, end-start);
+		auto line_pos=size_t(0);
+		auto record=json_t();
+		require(!parse_json(line, line_pos, record) && line_pos==line.size(), "each JSON line is one value");
+		check_json_record(record, count < cies.size() ? cies[count] : nullptr, count < cies.size() ? nullptr : fdes.at(count-cies.size()));
+		start=end+1;
+	}
+	require(count==cies.size()+fdes.size(), "there is a JSON line per CIE and FDE");
+}
+
+// print's chunked output is each record printed in turn, with one thread or several, and 
+// print() writes the same text to cout.
+void check_print(const EHFrameParser_t* ehp)
+{
+	auto expected=string();
+	{
+		const auto sink=OutputSink_t::factory(expected);
+		for(const auto cie : *ehp->getCIEs())
+			cie->print(*sink, 0);
+		for(const auto fde : *ehp->getFDEs())
+			fde->print(*sink);
+	}
+
+	const auto printed_with=[&](const char* threads) -> string
+	{
+		setenv("EHP_THREADS", threads, 1);
+		auto text=string();
+		ehp->print(*OutputSink_t::factory(text));
+		unsetenv("EHP_THREADS");
+		return text;
+	};
+	require(printed_with("1")==expected, "printing in one chunk prints each record in turn");
+	require(printed_with("4")==expected, "printing in several chunks prints each record in turn");
+
+	ostringstream captured;
+	const auto cout_buffer=cout.rdbuf(captured.rdbuf());
+	ehp->print();
+	cout.rdbuf(cout_buffer);
+	require(captured.str()==expected, "print() writes the same text to cout");
+}
+
+bool same_facts(const EHPFacts_t &a, const EHPFacts_t &b)
+{
+	if(a.schema_version!=b.schema_version || a.relations.size()!=b.relations.size())
+		return false;
+	for(auto r=size_t(0); r < a.relations.size(); r++)
+	{
+		const auto &x=a.relations[r];
+		const auto &y=b.relations[r];
+		if(x.name!=y.name || x.rows!=y.rows || x.columns.size()!=y.columns.size())
+			return false;
+		for(auto c=size_t(0); c < x.columns.size(); c++)
+			if(x.columns[c].values!=y.columns[c].values || x.columns[c].strings!=y.columns[c].strings)
+				return false;
+	}
+	return true;
+}
+
+// every relation has the schema's columns, each with a value per row, and a row per record; 
+// the chunked pass gives the same facts as one chunk, and writeFacts writes them all.
+void check_facts(const EHFrameParser_t* ehp)
+{
+	const auto &cies=*ehp->getCIEs();
+	const auto &fdes=*ehp->getFDEs();
+	auto expected_rows=vector<uint64_t>(FACT_RELATION_COUNT, 0);
+	expected_rows[FACT_CIE]=cies.size();
+	expected_rows[FACT_FDE]=fdes.size();
+	for(const auto cie : cies)
+		expected_rows[FACT_CFA_INSN]+=cie->getProgram().getInstructions()->size();
+	for(const auto fde : fdes)
+	{
+		expected_rows[FACT_CFA_INSN]+=fde->getProgram().getInstructions()->size();
+		if(fde->getLSDAAddress()==0)
+			continue;
+		expected_rows[FACT_LSDA]++;
+		expected_rows[FACT_CALL_SITE]+=fde->getLSDA()->getCallSites()->size();
+		for(const auto cs : *fde->getLSDA()->getCallSites())
+			expected_rows[FACT_CALL_SITE_ACTION]+=cs->getActionTable()->size();
+		expected_rows[FACT_TYPE_ENTRY]+=fde->getLSDA()->getTypeTable()->size();
+	}
+
+	const auto facts_with=[&](const char* threads) -> EHPFacts_t
+	{
+		setenv("EHP_THREADS", threads, 1);
+		auto facts=EHPFacts_t();
+		ehp->getFacts(facts);
+		unsetenv("EHP_THREADS");
+		return facts;
+	};
+	const auto facts=facts_with("1");
+	require(same_facts(facts, facts_with("4")), "facts gathered in several chunks are the same as in one");
+
+	const auto names=vector<string>({"cie", "fde", "cfa_insn", "lsda", "call_site", "call_site_action", "type_entry"});
+	const auto column_counts=vector<size_t>({11, 9, 6, 6, 7, 4, 4});
+	require(facts.schema_version==EHP_FACT_SCHEMA_VERSION && facts.relations.size()==FACT_RELATION_COUNT, "the facts have every relation");
+	for(auto r=size_t(0); r < facts.relations.size(); r++)
+	{
+		const auto &relation=facts.relations[r];
+		require(relation.name==names[r] && relation.columns.size()==column_counts[r], "a relation has its schema's columns");
+		require(relation.rows==expected_rows[r], "a relation has a row per record");
+		for(const auto &column : relation.columns)
+		{
+			const auto is_string = column.type==FACT_STRING;
+			require(column.values.size()==(is_string ? 0 : relation.rows) && column.strings.size()==(is_string ? relation.rows : 0), 
+				"a column has a value per row");
+		}
+	}
+	const auto &fde_facts=facts.relations[FACT_FDE];
+	for(auto i=size_t(0); i < fdes.size(); i++)
+		require(fde_facts.columns[0].values[i]==fdes[i]->getPosition() && fde_facts.columns[3].values[i]==fdes[i]->getStartAddress(), 
+			"fde facts are in FDE order");
+
+	auto directory=string("test.facts.XXXXXX");
+	require(mkdtemp(&directory[0])!=nullptr, "create a facts directory");
+	require(!ehp->writeFacts(directory), "write the facts");
+	auto files=vector<string>({"schema_version"});
+	for(const auto &relation : facts.relations)
+	{
+		ifstream in(directory + "/" + relation.name + ".facts");
+		auto rows=uint64_t(0);
+		for(auto line=string(); getline(in, line); rows++)
+			require(size_t(count(line.begin(), line.end(), '\t'))==relation.columns.size()-1, "a written fact has a field per column");
+		require(rows==relation.rows, "a relation's file has a line per row");
+		files.push_back(relation.name);
+	}
+	ifstream version_in(directory + "/schema_version.facts");
+	auto version=uint32_t(0);
+	require(bool(version_in >> version) && version==EHP_FACT_SCHEMA_VERSION, "the schema version is written");
+	for(const auto &file : files)
+		unlink((directory + "/" + file + ".facts").c_str());
+	rmdir(directory.c_str());
+}
+
 int main(int argc, char* argv[])
 {
 
@@ -60,13 +1626,45 @@ int main(int argc, char* argv[])
 		usage(argc,argv);
 	}
 
+	check_truncated_eh_frame();
+	check_damaged_eh_frame();
+	check_unwinder();
+	check_cfa_rows();
+	check_expressions();
+	check_frame_summaries();
+	check_exception_graph_order();
+	check_catch_sites();
+	check_coverage();
+	check_read_search_table();
+	check_symbol_join();
+	check_patch_overflow();
+	check_parser_cache();
+
+	// set once the strict parse has returned without errors.
+	auto strict_ok=false;
 	try
 	{
 		auto ehp = EHFrameParser_t::factory(argv[1]);
+		strict_ok=ehp->getParseErrors()->empty();
 		ehp->print();
 
 
 		print_lps(ehp.get());
+		check_fde_lookups(ehp.get());
+		check_cfa_tables(ehp.get());
+		check_unwind_table(ehp.get());
+		check_cfa_offset_table(ehp.get());
+		check_frame_summaries(ehp.get(), argv[1]);
+		check_call_sites(ehp.get());
+		check_exception_graph(ehp.get());
+		check_catch_index(ehp.get());
+		check_coverage(ehp.get(), *ehp->getExecutableRanges());
+		check_json(ehp.get());
+		check_print(ehp.get());
+		check_facts(ehp.get());
+		check_image(ehp.get());
+		check_encode(ehp.get());
+		check_symbol_join(EHFrameParser_t::factory(argv[1], PARSE_STRICT, true).get());
 	}
 	catch(const exception& e )
 	{
@@ -79,5 +1677,23 @@ int main(int argc, char* argv[])
 		abort();
 	};
 
+	// again leniently, reporting what had to be skipped.  where the strict parse works, nothing should be.
+	try
+	{
+		auto ehp = EHFrameParser_t::factory(argv[1], PARSE_LENIENT);
+		print_errors(ehp.get());
+		require(!strict_ok || ehp->getParseErrors()->empty(), "a lenient parse skips nothing a clean strict parse kept");
+	}
+	catch(const exception& e )
+	{
+		cout <<" libehp threw an exception in lenient mode, this may or may not be an error depending on the input file" << endl;
+		cout << e.what() << endl;
+	}
+	catch(...)
+	{
+		cout <<" ehp threw an exception of an unknonwn type -- this shouldn't happen " << endl;
+		abort();
+	};
+
 	return 0;
 }
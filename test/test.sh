@@ -34,6 +34,8 @@ function main()
 	./test.exe ./test.exe || cleanup 
 	./test.exe /bin/ls || cleanup 
 	./test.exe /bin/bash || cleanup 
+	# the parallel passes in several chunks, however many hardware threads this host has.
+	EHP_THREADS=4 ./test.exe /bin/bash || cleanup 
 
 	echo "test passed"
 	exit 0